@@ -14,6 +14,7 @@ int main()
   printf("a == a ? %d\n", !differs(a,a));
   printf("a == b ? %d\n", !differs(a,b));
   printf("a == c ? %d\n", !differs(a,c));
+  printf("hash(a) == hash(a) ? %d\n", hash(a) == hash(a));
 
   printf("is b an abstract object? %d\n", is_a(b, abstract_object));
   printf("Does b inherit from abstract object? %d\n",
@@ -1,5 +1,6 @@
 # include <stdio.h>
 # include <math.h>
+# include <time.h>
 # include "../iterator.h"
 
 struct time_iterator {
@@ -14,7 +15,9 @@ static void * time_iterator_display(const void * _self, FILE * fp);
 union iterator_value time_iterator_next(void * _self);
 union iterator_value time_iterator_prev(void * _self);
 union iterator_value time_iterator_set(void * _self, union iterator_value val);
-union iterator_value time_iterator_step(void * _self, double val);
+union iterator_value time_iterator_dt(void * _self, double val);
+int time_iterator_next_batch(void * _self, union iterator_value * buffer,
+                             int n);
 
 static void * time_iterator_constructor(void * _self, va_list * args)
 {
@@ -29,6 +32,8 @@ static void * time_iterator_constructor(void * _self, va_list * args)
   self->next = time_iterator_next;
   self->prev = time_iterator_prev;
   self->set = time_iterator_set;
+  self->get = iterator_get;
+  self->next_batch = time_iterator_next_batch;
 
   struct time_iterator * tself = _self;
   tself->t0 = 0.0;
@@ -122,11 +127,38 @@ union iterator_value time_iterator_dt(void * _self, double val)
   return self->val;
 }
 
+int time_iterator_next_batch(void * _self, union iterator_value * buffer,
+                             int n)
+{
+  struct time_iterator * self = _self;
+  const double t0 = self->t0, dt = self->dt;
+  const long int step = self->step;
+  for(int j = 0; j < n; ++j) buffer[j].d = t0 + dt*((double) (step + j));
+  self->step += n;
+  iterator_set(self, (union iterator_value) (t0 + dt*((double) self->step)));
+  return n;
+}
+
+/* next for an iterator over the even numbers */
+union iterator_value next_even(void * _self)
+{
+  struct iterator * self = _self;
+  self->val.i += 2;
+  return self->val;
+}
+
+double seconds()
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + 1e-9*t.tv_nsec;
+}
+
 int main() {
   /* Standard for loop */
   new(it, iterator, INT);
 
-  for(set(it, (union iterator_value) 10); get(it).i < 20; next(it))
+  for(put(it, (union iterator_value) 10); get(it).i < 20; next(it))
     printf("i = %d\n", get(it).i);
 
   delete(it);
@@ -136,14 +168,14 @@ int main() {
   time_iterator_dt(time, 0.01);
   display(time, stderr);
 
-  for(double t = set(time, (union iterator_value) 5.0).d;
+  for(double t = put(time, (union iterator_value) 5.0).d;
       t < 10.0; t = next(time).d) {
     printf("%f  %f  %f\n", t, cos(t), sin(t));
   }
 
   printf("\n");
 
-  for(double t = set(time, (union iterator_value) 5.0).d;
+  for(double t = put(time, (union iterator_value) 5.0).d;
       t > 0.0; t = prev(time).d) {
     printf("%f  %f  %f\n", t, cos(t), sin(t));
   }
@@ -152,5 +184,80 @@ int main() {
   display(s, stderr);
   delete(s);
 
+  /* Batches against single steps */
+  const int steps = 10000000;
+  union iterator_value buffer[256];
+  double sum_each = 0.0, sum_batch = 0.0;
+  double start = seconds();
+  for(double t = put(time, (union iterator_value) 0.0).d; get(time).d < 1e5;
+      t = next(time).d)
+    sum_each += t;
+  fprintf(stderr, "10^7 time steps with next: %.1f ms\n",
+          1e3*(seconds() - start));
+  start = seconds();
+  for(put(time, (union iterator_value) 0.0); get(time).d < 1e5; ) {
+    const int m = next_batch(time, buffer, 256);
+    for(int j = 0; j < m && buffer[j].d < 1e5; ++j) sum_batch += buffer[j].d;
+  }
+  fprintf(stderr, "10^7 time steps with next_batch: %.1f ms\n",
+          1e3*(seconds() - start));
+  printf("Same times? %d\n", sum_each == sum_batch);
+
+  new(count, iterator, INT);
+  long int total_each = 0, total_batch = 0;
+  start = seconds();
+  for(put(count, (union iterator_value) 0); get(count).i < steps; next(count))
+    total_each += get(count).i;
+  fprintf(stderr, "10^7 integers with next: %.1f ms\n",
+          1e3*(seconds() - start));
+  start = seconds();
+  for(put(count, (union iterator_value) 0); get(count).i < steps; ) {
+    const int m = next_batch(count, buffer, 256);
+    for(int j = 0; j < m && buffer[j].i < steps; ++j)
+      total_batch += buffer[j].i;
+  }
+  fprintf(stderr, "10^7 integers with next_batch: %.1f ms\n",
+          1e3*(seconds() - start));
+  put(count, (union iterator_value) 'a');
+  ((struct iterator *) count)->val_type = CHAR;
+  const int m = iterator_next_batch_each(count, buffer, 3);
+  printf("Same integers? %d, letters: %d %c%c%c %c\n",
+         total_each == total_batch, m, buffer[0].c, buffer[1].c,
+         buffer[2].c, get(count).c);
+  delete(count);
+
+  /* A subclass with its own next */
+  new(evens, iterator, INT);
+  evens->next = next_even;
+  put(evens, (union iterator_value) 0);
+  next_batch(evens, buffer, 4);
+  printf("Evens: %d %d %d %d, then %d\n", buffer[0].i, buffer[1].i,
+         buffer[2].i, buffer[3].i, get(evens).i);
+  delete(evens);
+
+  /* Arrays */
+  double x[10];
+  for(int i = 0; i < 10; ++i) x[i] = i + 1;
+  new(a, array_iterator, x, 10, sizeof(double));
+  double total = 0.0;
+  for(double * p = get(a).p; p; p = next(a).p) total += *p;
+  printf("Array: %g", total);
+  for(double * p = prev(a).p; p; p = prev(a).p) total -= *p;
+  printf(" %g, x[7] = %g", total,
+         *(double *) put(a, (union iterator_value) 7).p);
+  printf(", x[10]? %d", put(a, (union iterator_value) 10).p != NULL);
+  put(a, (union iterator_value) 4);
+  const int batch = next_batch(a, buffer, 256);
+  printf(", batch: %d from %g\n", batch, *(double *) buffer[0].p);
+
+  /* The even elements, as 5 runs of 1 with the first every other element */
+  struct array_iterator * even = (void *) a;
+  array_iterator_runs(even, x, sizeof(double), 1, 2*sizeof(double), 5, 1);
+  for_each_element(double, p, even) *p = -*p;
+  array_iterator_runs(even, x, sizeof(double), 10, 0, 1, 10);
+  for_each_element(double, p, a) printf("%g ", *p);
+  printf("\n");
+  delete(a);
+
   delete(time);
 }
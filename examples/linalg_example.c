@@ -0,0 +1,93 @@
+# include <stdio.h>
+# include <time.h>
+# include "../linalg.h"
+
+/* Largest absolute element of A X - B */
+real residual(const void * A, const void * X, const void * B)
+{
+  struct matrix * AX = matrix_dot(A, X);
+  const struct matrix * b = B;
+  real r = 0;
+  for(int i = 0; i < AX->rows*AX->cols; ++i)
+    if(fabs(AX->dat[i] - b->dat[i]) > r) r = fabs(AX->dat[i] - b->dat[i]);
+  delete(AX);
+  return r;
+}
+
+double seconds()
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + 1e-9*t.tv_nsec;
+}
+
+int main()
+{
+  /* A small system */
+  new(A, matrix);
+  matrix_set_dim(A, 3, 3);
+  real a[9] = {2, 1, 1, 4, -6, 0, -2, 7, 2};
+  for(int i = 0; i < 9; ++i) A->dat[i] = a[i];
+  new(b, vector);
+  vector_set_dim(b, 3);
+  b->dat[0] = 5; b->dat[1] = -2; b->dat[2] = 9;
+  Object x = matrix_solve(A, b);
+  printf("A = \n"); matrix_print(A, stdout);
+  printf("b = "); vector_print(b, stdout); printf("\n");
+  printf("x = "); vector_print(x, stdout); printf("\n");
+  printf("det A = %f\n", matrix_determinant(A));
+  delete(x);
+
+  /* A larger system with many right-hand sides, reusing the factorization */
+  int n = 300, nrhs = 20;
+  new(M, matrix);
+  matrix_set_dim(M, n, n);
+  new(B, matrix);
+  matrix_set_dim(B, n, nrhs);
+  srand(1);
+  for(int i = 0; i < n*n; ++i) M->dat[i] = rand()/(real) RAND_MAX - 0.5;
+  for(int i = 0; i < n*nrhs; ++i) B->dat[i] = rand()/(real) RAND_MAX - 0.5;
+  Object F = matrix_lu(M);
+  display(F, stdout);
+  Object X = solve(F, B);
+  printf("LU residual (%d right-hand sides): %s\n", nrhs,
+         residual(M, X, B) < 1e-9 ? "ok" : "too large");
+  delete(X);
+
+  /* Symmetric positive definite matrix S = M^T M + n I */
+  Object MT = matrix_transpose(M);
+  struct matrix * S = matrix_dot(MT, M);
+  for(int i = 0; i < n; ++i) S->dat[(n + 1)*i] += n;
+  Object C = matrix_cholesky(S);
+  display(C, stdout);
+  X = solve(C, B);
+  printf("Cholesky residual: %s\n",
+         residual(S, X, B) < 1e-9 ? "ok" : "too large");
+  delete(X);
+  printf("Cholesky of a non-positive matrix: %p\n", matrix_cholesky(A));
+
+  /* Timing */
+  n = 1000;
+  new(T, matrix);
+  matrix_set_dim(T, n, n);
+  for(int i = 0; i < n*n; ++i) T->dat[i] = rand()/(real) RAND_MAX - 0.5;
+  double t0 = seconds();
+  Object G = matrix_lu(T);
+  double t1 = seconds();
+  fprintf(stderr, "LU of a %d x %d matrix: %f s (%.2f GFLOP/s)\n", n, n,
+          t1 - t0, 2.0*n*n*n/3.0/(t1 - t0)*1e-9);
+
+  /* Clean up */
+  delete(A);
+  delete(b);
+  delete(M);
+  delete(B);
+  delete(F);
+  delete(MT);
+  delete(S);
+  delete(C);
+  delete(T);
+  delete(G);
+
+  return 0;
+}
@@ -1,6 +1,15 @@
 # include <stdio.h>
+# include <math.h>
+# include <time.h>
 # include "../list.h"
 
+double seconds()
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + 1e-9*t.tv_nsec;
+}
+
 int main()
 {
   /* Integer list */
@@ -32,6 +41,665 @@ int main()
   list_free(slist);
   free(slist);
 
+  /* Appending 10^7 integers */
+  struct int_list big;
+  list_init(&big, 0);
+  double t = seconds();
+  for(int i = 0; i < 10000000; ++i) list_append(&big, i);
+  fprintf(stderr, "10^7 appends: %.1f ms\n", 1e3*(seconds() - t));
+  long sum = 0;
+  for(int i = 0; i < big.n; ++i) sum += list_read(&big, i);
+  printf("10^7 appends: %d elements, sum %ld, room for %d\n", big.n, sum,
+         big.size);
+  for(int i = 0; i < 9999990; ++i) list_pop(&big, big.n - 1);
+  list_shrink(&big);
+  printf("After popping all but 10 and shrinking: room for %d\n", big.size);
+  list_free(&big);
+
+  /* Pushing and popping in the middle of every kind of list */
+  struct float_list fl;
+  struct double_list dl;
+  struct char_list cl;
+  struct obj_list ol;
+  list_init(&fl, 0);
+  list_init(&dl, 0);
+  list_init(&cl, 0);
+  list_init(&ol, 0);
+  list_reserve(&dl, 100);
+  printf("Reserved: room for %d\n", dl.size);
+  for(int i = 0; i < 26; ++i) {
+    list_append(&fl, 0.5*i);
+    list_push(&dl, dl.n/2, i);
+    list_append(&cl, 'a' + i);
+    list_append(&ol, &fl);
+  }
+  list_pop(&cl, 0);
+  list_push(&cl, 25, '\0');
+  double middle = list_pop(&dl, 13);
+  printf("Floats: %g ... %g, doubles: %g %g ... %g, chars: %s, objects: %d\n",
+         list_read(&fl, 0), list_read(&fl, 25), list_read(&dl, 0), middle,
+         list_read(&dl, 24), cl.element, ol.n);
+  list_free(&fl);
+  list_free(&dl);
+  list_free(&cl);
+  list_free(&ol);
+
+  /* The same random pushes and pops on lists in each mode */
+  struct int_list ml[3];
+  for(int mode = 0; mode < 3; ++mode) list_init(&ml[mode], 0);
+  list_mode(&ml[LIST_DEQUE], LIST_DEQUE);
+  srand(2);
+  int agree = 1;
+  for(int k = 0; k < 20000; ++k) {
+    int r = rand(), n = ml[0].n;
+    int i = r % 4 == 0 ? 0 : r % 4 == 1 ? n : rand() % (n + 1);
+    if(k == 10000) list_mode(&ml[LIST_GAP], LIST_GAP);
+    if(k == 14000) list_mode(&ml[LIST_DEQUE], LIST_GAP);
+    if(k == 18000) list_mode(&ml[LIST_GAP], LIST_DEQUE);
+    if(rand() % 5 < 3 || n == 0)
+      for(int mode = 0; mode < 3; ++mode) list_push(&ml[mode], i, k);
+    else {
+      if(i == n) i--;
+      int val = list_pop(&ml[0], i);
+      agree = agree && list_pop(&ml[1], i) == val && list_pop(&ml[2], i) == val;
+    }
+    for(int j = 0; j < ml[0].n; j += 97)
+      agree = agree && list_read(&ml[1], j) == list_read(&ml[0], j)
+                    && list_read(&ml[2], j) == list_read(&ml[0], j);
+  }
+  list_sort(&ml[0]);
+  list_sort(&ml[1]);
+  list_sort(&ml[2]);
+  printf("Plain, deque and gap lists agree? %d (%d elements), sorted too? %d\n",
+         agree, ml[0].n, !memcmp(ml[0].element, ml[1].element,
+                                 ml[0].n*sizeof(int))
+                         && !memcmp(ml[0].element, ml[2].element,
+                                    ml[0].n*sizeof(int)));
+  for(int mode = 0; mode < 3; ++mode) list_free(&ml[mode]);
+
+  /* A queue of 20000 events, and typing in the middle of a text */
+  for(int mode = 0; mode < 3; ++mode) {
+    struct obj_list queue;
+    struct char_list text;
+    list_init(&queue, 0);
+    list_init(&text, 0);
+    list_mode(&queue, mode);
+    list_mode(&text, mode);
+    t = seconds();
+    for(int i = 0; i < 20000; ++i) list_append(&queue, &queue);
+    for(int i = 0; i < 20000; ++i) {
+      list_pop(&queue, 0);
+      list_append(&queue, &text);
+    }
+    double tq = seconds() - t;
+    t = seconds();
+    for(int i = 0; i < 20000; ++i) list_append(&text, 'a' + i % 26);
+    for(int i = 0; i < 20000; ++i) list_push(&text, 10000 + i, '-');
+    list_append(&text, '\0');
+    double tt = seconds() - t;
+    fprintf(stderr, "Mode %d: queue %.1f ms, text %.1f ms\n", mode, 1e3*tq,
+            1e3*tt);
+    list_linearize(text.element, text.size, &text.at, text.n, text.mode,
+                   sizeof(char));
+    printf("Mode %d: queue of %d, last one %s, text of %d ending in %s\n",
+           mode, queue.n, list_read(&queue, queue.n - 1) == &text ? "text" :
+           "queue", text.n, text.element + text.n - 10);
+    list_free(&queue);
+    list_free(&text);
+  }
+
+  /* Sorting numbers with extreme values, with and without threads */
+  int m = 1000000;
+  struct int_list il, iq;
+  struct float_list fq;
+  struct double_list dq;
+  list_init(&il, m);
+  list_init(&iq, m);
+  list_init(&fl, m);
+  list_init(&fq, m);
+  list_init(&dl, m);
+  list_init(&dq, m);
+  const double special[] = {0.0, -0.0, 1.0/0.0, -1.0/0.0, 0.0/0.0, -(0.0/0.0),
+                            1e-300, -1e300, 2147483647.0, -2147483648.0};
+  srand(1);
+  for(int i = 0; i < m; ++i) {
+    double x = i < 10 ? special[i]
+               : (rand() - RAND_MAX/2)*pow(2.0, rand() % 64 - 32);
+    list_set(&il, i, (int) (i < 10 ? (x > 0 ? 2147483647 : -2147483647 - 1)
+                                    : x/4));
+    list_set(&fl, i, x);
+    list_set(&dl, i, x);
+  }
+  memcpy(iq.element, il.element, m*sizeof(int));
+  memcpy(fq.element, fl.element, m*sizeof(float));
+  memcpy(dq.element, dl.element, m*sizeof(double));
+  qsort(iq.element, m, sizeof(int), int_compare);
+  qsort(fq.element, m, sizeof(float), float_compare);
+  t = seconds();
+  qsort(dq.element, m, sizeof(double), double_compare);
+  fprintf(stderr, "qsort of 10^6 doubles: %.1f ms\n", 1e3*(seconds() - t));
+  for(int threads = 1; threads <= 4; threads *= 4) {
+    list_sort_threads = threads;
+    struct int_list ic = {m, malloc(m*sizeof(int)), m};
+    struct float_list fc = {m, malloc(m*sizeof(float)), m};
+    struct double_list dc = {m, malloc(m*sizeof(double)), m};
+    memcpy(ic.element, il.element, m*sizeof(int));
+    memcpy(fc.element, fl.element, m*sizeof(float));
+    memcpy(dc.element, dl.element, m*sizeof(double));
+    list_sort(&ic);
+    list_sort(&fc);
+    t = seconds();
+    list_sort(&dc);
+    fprintf(stderr, "list_sort of 10^6 doubles with %d threads: %.1f ms\n",
+            threads, 1e3*(seconds() - t));
+    printf("%d threads: ints, floats and doubles sorted as by qsort? "
+           "%d %d %d\n", threads,
+           !memcmp(ic.element, iq.element, m*sizeof(int)),
+           !memcmp(fc.element, fq.element, m*sizeof(float)),
+           !memcmp(dc.element, dq.element, m*sizeof(double)));
+    list_free(&ic);
+    list_free(&fc);
+    list_free(&dc);
+  }
+  printf("Smallest and largest: %d %d, %g %g, %g %g %g\n",
+         list_read(&iq, 0), list_read(&iq, m - 1), list_read(&dq, 1),
+         list_read(&dq, m - 2), list_read(&dq, m/2), list_read(&fq, m - 2),
+         list_read(&fq, 1));
+  list_free(&il);
+  list_free(&iq);
+  list_free(&fl);
+  list_free(&fq);
+  list_free(&dl);
+  list_free(&dq);
+
+  /* 10^7 doubles */
+  list_sort_threads = 0;
+  m = 10000000;
+  list_init(&dl, m);
+  for(int i = 0; i < m; ++i) list_set(&dl, i, rand()/(RAND_MAX + 1.0));
+  t = seconds();
+  list_sort(&dl);
+  fprintf(stderr, "list_sort of 10^7 doubles with %d threads: %.1f ms\n",
+          list_sort_nthreads(m), 1e3*(seconds() - t));
+  int sorted = 1;
+  for(int i = 1; i < m; ++i)
+    sorted = sorted && dl.element[i - 1] <= dl.element[i];
+  printf("10^7 doubles sorted? %d\n", sorted);
+  list_free(&dl);
+
+  /* A million lines in a string list with a pool */
+  m = 1000000;
+  FILE * fp = tmpfile();
+  srand(2);
+  for(int i = 0; i < m; ++i)
+    fprintf(fp, "%d: line of %s\n", rand() % (m/4),
+            i % 3 ? "the file" : "the list");
+  rewind(fp);
+  struct string_list lines;
+  list_init(&lines, 0);
+  t = seconds();
+  int nlines = string_list_read_lines(&lines, fp);
+  fprintf(stderr, "Reading 10^6 lines: %.1f ms\n", 1e3*(seconds() - t));
+  fclose(fp);
+  printf("Lines read: %d, distinct: %zu, blocks: %d\n", nlines,
+         lines.pool->count, lines.pool->nblocks);
+  char ** copy = malloc(m*sizeof(char *));
+  memcpy(copy, lines.element, m*sizeof(char *));
+  t = seconds();
+  qsort(copy, m, sizeof(char *), string_compare);
+  fprintf(stderr, "qsort of 10^6 strings: %.1f ms\n", 1e3*(seconds() - t));
+  t = seconds();
+  list_sort(&lines);
+  fprintf(stderr, "list_sort of 10^6 pooled strings: %.1f ms\n",
+          1e3*(seconds() - t));
+  int same = 1, interned = 1;
+  for(int i = 0; i < m; ++i) {
+    same = same && !strcmp(copy[i], lines.element[i]);
+    if(i && !strcmp(lines.element[i - 1], lines.element[i]))
+      interned = interned && lines.element[i - 1] == lines.element[i];
+  }
+  printf("Sorted as by qsort? %d, equal lines interned? %d\n", same,
+         interned);
+  char probe[64];
+  sprintf(probe, "%s", lines.element[m/2]);
+  printf("Found: %d %d, first: %s, length: %zu\n",
+         string_pool_find(lines.pool, probe) == lines.element[m/2],
+         string_pool_find(lines.pool, "not a line") == NULL,
+         list_read(&lines, 0), string_header(lines.element[0])->length);
+  free(copy);
+  list_free(&lines);
+
+  /* Reductions and searches, checked against loops over list_read */
+  m = 1000000;
+  struct int_list ri;
+  struct float_list rf;
+  struct double_list rd;
+  struct char_list rc;
+  list_init(&ri, 0);
+  list_init(&rf, 0);
+  list_init(&rd, 0);
+  list_init(&rc, 0);
+  list_mode(&ri, LIST_DEQUE);
+  list_mode(&rc, LIST_GAP);
+  srand(3);
+  for(int i = 0; i < m; ++i) {
+    /* Half at the front, so that the deque wraps around */
+    if(i % 2) list_push(&ri, 0, rand() % 2000001 - 1000000);
+    else list_append(&ri, rand() % 2000001 - 1000000);
+    list_append(&rf, (float) rand()/RAND_MAX - 0.5f);
+    list_append(&rd, rand()/(RAND_MAX + 1.0) - 0.25);
+    list_append(&rc, 'a' + rand() % 26);
+  }
+  list_set(&rf, m/3, 0.0f/0.0f);
+  list_push(&rc, m/2, '!');
+  list_pop(&rc, m/4); /* Leaves the gap in the middle */
+  long isum = 0;
+  int ilo = list_read(&ri, 0), ihi = ilo, i_count = 0;
+  double fsum = 0, dsum = 0;
+  float flo = list_read(&rf, 0), fhi = flo;
+  double dlo = list_read(&rd, 0), dhi = dlo;
+  long csum = 0;
+  int c_count = 0;
+  const int ival = list_read(&ri, 2*m/3);
+  t = seconds();
+  for(int i = 0; i < m; ++i) isum += list_read(&ri, i);
+  fprintf(stderr, "Sum of 10^6 ints with list_read: %.2f ms\n",
+          1e3*(seconds() - t));
+  t = seconds();
+  const long isum2 = list_sum(&ri);
+  fprintf(stderr, "Sum of 10^6 ints with list_sum: %.2f ms\n",
+          1e3*(seconds() - t));
+  for(int i = 0; i < m; ++i) {
+    const int x = list_read(&ri, i);
+    const float f = list_read(&rf, i);
+    const double d = list_read(&rd, i);
+    if(x < ilo) ilo = x;
+    if(x > ihi) ihi = x;
+    i_count += x == ival;
+    fsum += f;
+    if(f < flo || flo != flo) flo = f;
+    if(f > fhi || fhi != fhi) fhi = f;
+    dsum += d;
+    if(d < dlo) dlo = d;
+    if(d > dhi) dhi = d;
+    csum += list_read(&rc, i);
+    c_count += list_read(&rc, i) == 'q';
+  }
+  float flo2, fhi2;
+  list_minmax(&rf, &flo2, &fhi2);
+  printf("Sums: %d %d %d %d\n", isum == isum2,
+         isnan(list_sum(&rf)) && isnan(fsum),
+         fabs(list_sum(&rd) - dsum) <= 1e-9*m, csum == list_sum(&rc));
+  printf("Minima and maxima: %d %d %d %d %d %d %d %d\n",
+         list_min(&ri) == ilo, list_max(&ri) == ihi,
+         flo2 == flo, fhi2 == fhi, list_min(&rd) == dlo,
+         list_max(&rd) == dhi, list_min(&rc) == '!', list_max(&rc) == 'z');
+  printf("Counts: %d %d %d %d\n", list_count(&ri, ival) == i_count,
+         list_count(&rc, 'q') == c_count, list_count(&rf, 0.0f/0.0f),
+         list_count(&rd, list_read(&rd, 5)));
+  const int ifound = list_find(&ri, ival);
+  printf("Finds: %d %d %d %d %d %d\n",
+         ifound >= 0 && ifound <= 2*m/3 && list_read(&ri, ifound) == ival,
+         list_find(&ri, 1000001), list_find(&rc, '!'), list_find(&rc, '?'),
+         list_find(&rd, list_read(&rd, m - 1)) == m - 1,
+         list_find(&rf, 0.0f/0.0f));
+  list_free(&ri);
+  list_free(&rf);
+  list_free(&rd);
+  list_free(&rc);
+
+  /* Sorted lists */
+  m = 1000000;
+  list_init(&ri, m);
+  for(int i = 0; i < m; ++i) list_set(&ri, i, rand() % (4*m));
+  list_sort(&ri);
+  list_mode(&ri, LIST_DEQUE);
+  list_push(&ri, 0, -1); /* Wraps around */
+  int bounds = 1, found = 0;
+  for(int probe = -2; probe < 4*m + 2; probe += 37) {
+    const int i = list_lower_bound(&ri, probe);
+    bounds = bounds && (i == 0 || list_read(&ri, i - 1) < probe)
+             && (i == ri.n || list_read(&ri, i) >= probe);
+    const int j = list_bsearch(&ri, probe);
+    found += j >= 0;
+    bounds = bounds && (j < 0 ? i == ri.n || list_read(&ri, i) != probe
+                              : j == i);
+  }
+  t = seconds();
+  for(int r = 0; r < m; ++r) list_bsearch(&ri, rand() % (4*m));
+  fprintf(stderr, "10^6 searches in 10^6 ints: %.1f ms\n",
+          1e3*(seconds() - t));
+  printf("Lower bounds and searches right? %d (%d found)\n", bounds, found);
+  const int distinct = list_unique(&ri);
+  int increasing = 1;
+  for(int i = 1; i < ri.n; ++i)
+    increasing = increasing && ri.element[i - 1] < ri.element[i];
+  printf("Unique: %d elements, increasing? %d\n", distinct, increasing);
+  list_free(&ri);
+
+  /* Sorted insertions into a gap buffer, then a merge of 4 lists */
+  struct int_list part[4], * parts[4], merged;
+  list_init(&merged, 0);
+  for(int p = 0; p < 4; ++p) {
+    list_init(&part[p], 0);
+    list_mode(&part[p], p % 2 ? LIST_GAP : LIST_PLAIN);
+    for(int i = 0; i < 5000; ++i) list_insert_sorted(&part[p], rand() % 1000);
+    parts[p] = &part[p];
+  }
+  list_merge(&merged, parts, 4);
+  int ordered = merged.n == 20000;
+  for(int i = 1; i < merged.n; ++i)
+    ordered = ordered && list_read(&merged, i - 1) <= list_read(&merged, i);
+  for(int p = 0; p < 4; ++p)
+    for(int v = 0; v < 1000; v += 7) {
+      int c = 0;
+      for(int q = 0; q < 4; ++q) c += list_count(&part[q], v);
+      ordered = ordered && list_count(&merged, v) == c;
+    }
+  list_merge(&part[0], parts, 2); /* Into one of the parts */
+  printf("Merged in order? %d, %d elements, first part sorted? %d\n",
+         ordered, merged.n,
+         list_lower_bound(&part[0], 1000) == 10000 && part[0].element[0] == 0);
+  for(int p = 0; p < 4; ++p) list_free(&part[p]);
+  list_free(&merged);
+
+  /* Doubles with NaNs and zeros, and strings with and without a pool */
+  const double oddities[] = {0.0/0.0, -0.0, 0.0, 1.0, -1.0/0.0, 1.0, 2.5};
+  list_init(&rd, 0);
+  for(int i = 0; i < 7; ++i) list_insert_sorted(&rd, oddities[i]);
+  printf("Doubles:");
+  for(int i = 0; i < rd.n; ++i)
+    if(isnan(list_read(&rd, i))) printf(" nan");
+    else printf(" %g", list_read(&rd, i));
+  printf(", -0 at %d, 0 at %d, 3 at %d, unique: %d\n",
+         list_bsearch(&rd, -0.0), list_bsearch(&rd, 0.0),
+         list_bsearch(&rd, 3.0), list_unique(&rd));
+  list_free(&rd);
+  const char * words[] = {"pear", "apple", "fig", "apple", "kiwi", "peach",
+                          "pineapple", "pineapples", "fig"};
+  struct string_list plain, pooled, * both[2] = {&plain, &pooled};
+  list_init(&plain, 0);
+  list_init(&pooled, 0);
+  string_list_use_pool(&pooled);
+  for(int i = 0; i < 9; ++i) {
+    list_insert_sorted(&plain, (char *) words[i]);
+    list_insert_sorted(&pooled, (char *) words[8 - i]);
+  }
+  printf("Strings: %d %d %d %d %d\n", list_bsearch(&plain, "fig"),
+         list_bsearch(&pooled, "pineapple"), list_bsearch(&pooled, "pine"),
+         list_lower_bound(&pooled, "pineapplez"), list_unique(&pooled));
+  list_merge(&pooled, both, 2);
+  for(int i = 0; i < pooled.n; ++i) printf(" %s", list_read(&pooled, i));
+  printf("\n");
+  list_free(&plain);
+  list_free(&pooled);
+  for(int mode = LIST_DEQUE; mode <= LIST_GAP; ++mode) {
+    char z[] = "z";
+    list_init(&pooled, 0);
+    list_mode(&pooled, mode);
+    list_push(&pooled, 0, "y");
+    list_push(&pooled, 0, z); /* Not at the start of the array */
+    string_list_use_pool(&pooled);
+    z[0] = 'Z';
+    FILE * more = tmpfile();
+    fprintf(more, "x\nw\n");
+    rewind(more);
+    string_list_read_lines(&pooled, more);
+    fclose(more);
+    printf("Pool added to a list in mode %d:", mode);
+    for(int i = 0; i < pooled.n; ++i) printf(" %s", list_read(&pooled, i));
+    printf("\n");
+    list_free(&pooled);
+  }
+
+  /* Fixed-width integer lists */
+  struct int8_list flags;
+  struct uint16_list ports;
+  struct uint32_list hashes;
+  struct int64_list stamps;
+  list_init(&flags, 0);
+  list_init(&ports, 0);
+  list_init(&hashes, 0);
+  list_init(&stamps, 0);
+  list_mode(&ports, LIST_DEQUE);
+  for(int i = 0; i < 100000; ++i) {
+    list_append(&flags, (int8_t) (rand() % 256 - 128));
+    list_push(&ports, 0, rand() % 65536);
+    list_append(&hashes, (uint32_t) rand() << 16 ^ rand());
+    list_append(&stamps, (int64_t) (rand() - RAND_MAX/2)*((int64_t) 1 << 31));
+  }
+  list_append(&hashes, UINT32_MAX);
+  list_append(&stamps, INT64_MIN);
+  const int64_t fsum8 = list_sum(&flags);
+  const uint64_t psum = list_sum(&ports);
+  list_sort(&flags);
+  list_sort(&ports);
+  list_sort(&hashes);
+  list_sort(&stamps);
+  int in_order = 1;
+  for(int i = 1; i < 100000; ++i)
+    in_order = in_order && list_read(&flags, i - 1) <= list_read(&flags, i)
+               && list_read(&ports, i - 1) <= list_read(&ports, i)
+               && list_read(&hashes, i - 1) <= list_read(&hashes, i)
+               && list_read(&stamps, i - 1) <= list_read(&stamps, i);
+  printf("Sorted? %d, sums kept? %d %d, ends: %d %d %u %d\n", in_order,
+         list_sum(&flags) == fsum8, list_sum(&ports) == psum,
+         list_read(&flags, 0), list_min(&ports), list_max(&hashes),
+         list_read(&stamps, 0) == INT64_MIN);
+  printf("Found: %d %d, unique flags: %d, sizes: %zu %zu %zu %zu\n",
+         list_bsearch(&hashes, UINT32_MAX) == 100000,
+         list_read(&stamps, list_lower_bound(&stamps, 0)) >= 0,
+         list_unique(&flags), sizeof(*flags.element), sizeof(*ports.element),
+         sizeof(*hashes.element), sizeof(*stamps.element));
+  list_free(&flags);
+  list_free(&ports);
+  list_free(&hashes);
+  list_free(&stamps);
+
+  /* 10^6 sorted 64-bit identifiers, packed */
+  struct packed_list ids;
+  list_init(&ids, 0);
+  int64_t * id = malloc(m*sizeof(int64_t));
+  int64_t next_id = (int64_t) 1 << 40;
+  for(int i = 0; i < m; ++i) {
+    id[i] = next_id += 1 + rand() % 100;
+    list_append(&ids, id[i]);
+  }
+  int same_ids = 1;
+  uint64_t id_sum = 0;
+  for(int i = 0; i < m; ++i) {
+    same_ids = same_ids && list_read(&ids, i) == id[i];
+    id_sum += id[i];
+  }
+  int64_t window[300];
+  packed_list_decode(&ids, m - 300, 300, window);
+  same_ids = same_ids && !memcmp(window, id + m - 300, sizeof(window));
+  t = seconds();
+  int64_t probe_sum = 0;
+  for(int r = 0; r < m; ++r) probe_sum += list_read(&ids, rand() % m);
+  fprintf(stderr, "10^6 random reads from a packed list: %.1f ms\n",
+          1e3*(seconds() - t));
+  printf("Packed: same values? %d, sum right? %d, %.2f bytes per id\n",
+         same_ids, (uint64_t) list_sum(&ids) == id_sum,
+         (double) packed_list_bytes(&ids)/m);
+  list_free(&ids);
+  free(id);
+
+  /* Saving and mapping */
+  char path[] = "/tmp/list_exampleXXXXXX";
+  close(mkstemp(path));
+  m = 10000000;
+  list_init(&dl, 0);
+  list_mode(&dl, LIST_DEQUE);
+  for(int i = 0; i < m; ++i) list_push(&dl, i % 2 ? 0 : dl.n, i);
+  const double dl_sum = list_sum(&dl);
+  t = seconds();
+  const int saved = list_save(&dl, path) != NULL;
+  fprintf(stderr, "Saving 10^7 doubles: %.1f ms\n", 1e3*(seconds() - t));
+  struct double_list mapped;
+  t = seconds();
+  const int was_mapped = list_map(&mapped, path, LIST_MAP_READONLY) != NULL;
+  fprintf(stderr, "Mapping 10^7 doubles: %.3f ms\n", 1e3*(seconds() - t));
+  int same_doubles = was_mapped && mapped.n == m;
+  for(int i = 0; i < m && same_doubles; ++i)
+    same_doubles = list_read(&mapped, i) == list_read(&dl, i);
+  printf("Saved? %d, mapped? %d, same? %d, sum: %d\n", saved, was_mapped,
+         same_doubles, list_sum(&mapped) == dl_sum);
+  list_free(&mapped);
+  list_free(&dl);
+
+  /* Copy-on-write: changes stay in memory, and the file does not change */
+  list_map(&mapped, path, LIST_MAP_PRIVATE);
+  list_set(&mapped, 0, -1.0);
+  const double first = list_read(&mapped, 0);
+  list_append(&mapped, 1.0); /* Copies the list out of the mapping */
+  list_sort(&mapped);
+  printf("Private: %g %g %d, ", first, list_read(&mapped, 0), mapped.n);
+  list_free(&mapped);
+  list_map(&mapped, path, LIST_MAP_READONLY);
+  printf("file: %.0f %.0f %d\n", list_read(&mapped, 0), list_read(&mapped, 1),
+         mapped.n);
+  list_free(&mapped);
+  struct int64_list wrong;
+  printf("Mapped as int64s? %d\n",
+         list_map(&wrong, path, LIST_MAP_READONLY) != NULL);
+  struct uint16_list small_ints, small_copy;
+  list_init(&small_ints, 0);
+  for(int i = 0; i < 1000; ++i) list_append(&small_ints, i*i);
+  list_save(&small_ints, path);
+  list_map(&small_copy, path, LIST_MAP_PRIVATE);
+  printf("uint16s: %d %d\n", small_copy.n,
+         list_sum(&small_copy) == list_sum(&small_ints));
+  list_free(&small_ints);
+  list_free(&small_copy);
+  remove(path);
+
+  /* Bulk operations, against the same edits on a plain array */
+  int * ref = malloc(1000000*sizeof(int)), ref_n = 0, block[500];
+  struct int_list bulk, cut;
+  int bulk_same = 1;
+  for(int mode = LIST_PLAIN; mode <= LIST_GAP; ++mode) {
+    list_init(&bulk, 0);
+    list_init(&cut, 0);
+    list_mode(&bulk, mode);
+    list_mode(&cut, mode);
+    ref_n = 0;
+    for(int r = 0; r < 1000; ++r) {
+      const int i = rand() % (ref_n + 1), k = rand() % 500;
+      for(int j = 0; j < k; ++j) block[j] = rand();
+      if(r % 2 || ref_n < k) { /* Insert, at the end one time in five */
+        const int at = r % 5 ? i : ref_n;
+        list_insert_range(&bulk, at, block, k);
+        memmove(ref + at + k, ref + at, (ref_n - at)*sizeof(int));
+        memcpy(ref + at, block, k*sizeof(int));
+        ref_n += k;
+      }
+      else { /* Erase k elements, or fill them with r */
+        const int at = i < ref_n - k ? i : ref_n - k;
+        if(r % 4) {
+          list_erase_range(&bulk, at, k);
+          memmove(ref + at, ref + at + k, (ref_n - at - k)*sizeof(int));
+          ref_n -= k;
+        }
+        else {
+          list_fill(&bulk, at, k, r);
+          for(int j = at; j < at + k; ++j) ref[j] = r;
+        }
+      }
+      if(mode == LIST_DEQUE) list_push(&bulk, 0, list_pop(&bulk, bulk.n - 1));
+      if(mode == LIST_DEQUE && ref_n) {
+        const int last = ref[ref_n - 1];
+        memmove(ref + 1, ref, (ref_n - 1)*sizeof(int));
+        ref[0] = last;
+      }
+    }
+    bulk_same = bulk_same && bulk.n == ref_n;
+    for(int i = 0; i < ref_n && bulk_same; ++i)
+      bulk_same = list_read(&bulk, i) == ref[i];
+    list_slice(&bulk, &cut, ref_n/3, ref_n/3);
+    bulk_same = bulk_same && cut.n == ref_n/3;
+    for(int i = 0; i < cut.n && bulk_same; ++i)
+      bulk_same = list_read(&cut, i) == ref[ref_n/3 + i];
+    list_extend(&cut, block, 100);
+    bulk_same = bulk_same && cut.n == ref_n/3 + 100
+                && list_read(&cut, cut.n - 1) == block[99];
+    list_free(&bulk);
+    list_free(&cut);
+  }
+  printf("Bulk edits in all modes match? %d\n", bulk_same);
+  free(ref);
+
+  struct string_list fruits, fruit_part;
+  char * word[] = {"apple", "banana", "cherry", "date"};
+  char fig[] = "fig";
+  list_init(&fruits, 0);
+  list_init(&fruit_part, 0);
+  string_list_use_pool(&fruits);
+  list_extend(&fruits, word, 4);
+  list_insert_range(&fruits, 1, word + 2, 2);
+  list_fill(&fruits, 0, 1, fig);
+  fig[0] = 'F'; /* The pool keeps its own copy */
+  list_erase_range(&fruits, 4, 1);
+  list_slice(&fruits, &fruit_part, 1, 4);
+  for(int i = 0; i < fruit_part.n; ++i)
+    printf("%s%s", list_read(&fruit_part, i), i < fruit_part.n - 1 ? " " : "");
+  printf(" (%s)\n", list_read(&fruits, 0));
+  list_free(&fruit_part);
+  list_free(&fruits);
+
+  struct uint8_list bytes;
+  list_init(&bytes, 1000);
+  list_fill(&bytes, 0, 1000, 7);
+  list_erase_range(&bytes, 100, 800);
+  struct packed_list more_ids;
+  list_init(&more_ids, 0);
+  int64_t some_id[1000];
+  for(int i = 0; i < 1000; ++i) some_id[i] = 3*i;
+  list_extend(&more_ids, some_id, 300);
+  list_extend(&more_ids, some_id + 300, 700);
+  printf("Bytes: %d %d, packed ids: %d %d\n", bytes.n, (int) list_sum(&bytes),
+         more_ids.n, list_read(&more_ids, 999) == 2997);
+  list_free(&bytes);
+  list_free(&more_ids);
+
+  /* Inserting 10^3 elements at the front of a list of 10^6 */
+  m = 1000000;
+  int * front = calloc(1000, sizeof(int));
+  list_init(&bulk, m);
+  t = seconds();
+  for(int i = 0; i < 1000; ++i) list_push(&bulk, 0, front[i]);
+  fprintf(stderr, "10^3 pushes at the front: %.1f ms\n", 1e3*(seconds() - t));
+  list_free(&bulk);
+  list_init(&bulk, m);
+  t = seconds();
+  list_insert_range(&bulk, 0, front, 1000);
+  fprintf(stderr, "One insert_range of 10^3: %.1f ms\n", 1e3*(seconds() - t));
+  list_free(&bulk);
+  free(front);
+
+  /* Iterators over the runs of a list */
+  int iterated_right = 1;
+  for(int mode = LIST_PLAIN; mode <= LIST_GAP; ++mode) {
+    list_init(&bulk, 0);
+    list_mode(&bulk, mode);
+    for(int i = 0; i < 1000; ++i) list_push(&bulk, i % 3 ? bulk.n/2 : 0, i);
+    long int by_next = 0, by_run = 0, backwards = 0;
+    void * it = list_iterator_of(&bulk);
+    for(int * x = get(it).p; x; x = next(it).p) by_next += *x;
+    for(int * x = prev(it).p; x; x = prev(it).p) backwards += *x;
+    put(it, (union iterator_value) 0);
+    for_each_element(int, x, it) by_run += *x;
+    int same_order = 1;
+    for(int i = 0; i < bulk.n && same_order; ++i)
+      same_order = *(int *) put(it, (union iterator_value) i).p
+                   == list_read(&bulk, i);
+    iterated_right = iterated_right && same_order && by_next == list_sum(&bulk)
+                     && by_run == by_next && backwards == by_next;
+    delete(it);
+    list_free(&bulk);
+  }
+  printf("Iterators over lists in all modes right? %d\n", iterated_right);
+
   return 0;
 }
 
@@ -0,0 +1,87 @@
+# include <stdio.h>
+# define MAPPED_TILE_BYTES 4096 /* Tiny tiles, to exercise the tiling */
+# include "../mapped_matrix.h"
+
+int main()
+{
+  /* Two matrices in memory */
+  new(A, matrix);
+  matrix_set_dim(A, 150, 120);
+  new(B, matrix);
+  matrix_set_dim(B, 120, 90);
+  srand(1);
+  for(int i = 0; i < A->rows*A->cols; ++i) A->dat[i] = rand()/(real) RAND_MAX;
+  for(int i = 0; i < B->rows*B->cols; ++i) B->dat[i] = rand()/(real) RAND_MAX;
+
+  /* Save them and map them back */
+  Object fA = matrix_to_file(A, "mapped_A.mat");
+  Object fB = matrix_to_file(B, "mapped_B.mat");
+  delete(fA);
+  new(mA, mapped_matrix, "mapped_A.mat", MAPPED_READ_ONLY);
+  display(mA, stdout);
+  printf("A(1, 2) = %f, mapped A(1, 2) = %f\n",
+         A->dat[A->ld + 2], ((struct matrix *) mA)->dat[A->ld + 2]);
+
+  /* Tiled products, in memory and on disk */
+  struct matrix * C = matrix_dot(A, B);
+  struct matrix * D = mapped_matrix_dot(mA, fB, NULL);
+  struct matrix * E = mapped_matrix_dot(mA, fB, "mapped_C.mat");
+  display(E, stdout);
+  real error = 0;
+  for(int i = 0; i < C->rows*C->cols; ++i) {
+    if(fabs(C->dat[i] - D->dat[i]) > error) error = fabs(C->dat[i] - D->dat[i]);
+    if(fabs(C->dat[i] - E->dat[i]) > error) error = fabs(C->dat[i] - E->dat[i]);
+  }
+  printf("Tiled products agree with matrix_dot? %d\n", error < 1e-10);
+
+  /* A copy-on-write operand keeps its changes through the product (its rows
+     fill whole pages, so that the product drops the pages it is done with) */
+  new(W, matrix);
+  matrix_set_dim(W, 64, 1024);
+  for(int i = 0; i < W->rows*W->cols; ++i) W->dat[i] = 1.0;
+  delete(matrix_to_file(W, "mapped_W.mat"));
+  new(I, matrix);
+  matrix_set_dim(I, 64, 64);
+  for(int i = 0; i < I->rows; ++i) I->dat[I->ld*i + i] = 1.0;
+  new(cW, mapped_matrix, "mapped_W.mat", MAPPED_COPY_ON_WRITE);
+  struct matrix * mW = (struct matrix *) cW;
+  for(int i = 0; i < mW->rows*mW->cols; ++i) mW->dat[i] = 2.0;
+  struct matrix * F = mapped_matrix_dot(I, cW, NULL);
+  int wrong = 0;
+  for(int i = 0; i < F->rows*F->cols; ++i) wrong += F->dat[i] != 2.0;
+  printf("Copy-on-write product: %d wrong, operand still changed? %d\n",
+         wrong, mW->dat[0] == 2.0 && mW->dat[mW->rows*mW->cols - 1] == 2.0);
+  delete(F);
+  delete(cW);
+  delete(I);
+  delete(W);
+  remove("mapped_W.mat");
+
+  /* A block of a matrix */
+  new(V, matrix_view, A, 10, 10, 3, 4);
+  Object fV = matrix_to_file(V, "mapped_V.mat");
+  printf("Block saved from a view: \n"); matrix_print(fV, stdout);
+  matrix_print(V, stdout);
+
+  /* A file that is not a matrix */
+  new(bad, mapped_matrix, "examples/mapped_matrix_example.c", MAPPED_READ_ONLY);
+  display(bad, stdout);
+
+  /* Clean up */
+  delete(A);
+  delete(B);
+  delete(C);
+  delete(D);
+  delete(E);
+  delete(V);
+  delete(fB);
+  delete(fV);
+  delete(mA);
+  delete(bad);
+  remove("mapped_A.mat");
+  remove("mapped_B.mat");
+  remove("mapped_C.mat");
+  remove("mapped_V.mat");
+
+  return 0;
+}
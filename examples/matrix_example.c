@@ -1,12 +1,22 @@
 # include <stdio.h>
+# include <time.h>
 # include "../vector.h"
 # include "../matrix.h"
 
 # define init_object(obj) void * obj = NULL;
 # define set_object(obj, value) delete(obj); obj = value;
 
+double seconds()
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + 1e-9*t.tv_nsec;
+}
+
 int main()
 {
+  double t;
+
   /* Matrix [v] from vector v */
   new(v, vector);
   vector_set_dim(v, 3);
@@ -47,6 +57,158 @@ int main()
   set_object(B, matrix_dot(M, v)); vector_print(B, stdout); printf("\n");
   delete(B);
 
+  /* Views of blocks of M and A (no copies involved) */
+  new(V, matrix_view, M, 1, 1, 2, 2);
+  new(W, matrix_view, A, 0, 1, 2, 2);
+  display(V, stdout);
+  printf("V = \n"); matrix_print(V, stdout);
+  printf("W = \n"); matrix_print(W, stdout);
+  init_object(D);
+  printf("V + W = \n");
+  set_object(D, matrix_add(V, W)); matrix_print(D, stdout);
+  printf("V W = \n");
+  set_object(D, matrix_dot(V, W)); matrix_print(D, stdout);
+  printf("W^T = \n");
+  set_object(D, matrix_transpose(W)); matrix_print(D, stdout);
+  set_object(D, clone(V));
+  printf("V == copy of V? %d (same hash: %d)\n", !differs(V, D),
+         hash(V) == hash(D));
+  struct matrix * Vm = _V;
+  Vm->dat[Vm->ld*1 + 1] = -4.0; /* Writes through to M */
+  printf("M after setting V(1, 1) = -4: \n"); matrix_print(M, stdout);
+  delete(D);
+  delete(V);
+  delete(W);
+
+  /* Sparse matrices: the 1D Laplacian with n = 100000 */
+  int n = 100000, nt = 0;
+  int * row = malloc(3*n*sizeof(int));
+  int * col = malloc(3*n*sizeof(int));
+  real * val = malloc(3*n*sizeof(real));
+  for(int i = 0; i < n; ++i) {
+    row[nt] = i; col[nt] = i; val[nt++] = 2.0;
+    if(i > 0) {row[nt] = i; col[nt] = i - 1; val[nt++] = -1.0;}
+    if(i < n - 1) {row[nt] = i; col[nt] = i + 1; val[nt++] = -1.0;}
+  }
+  Object L = csr_from_triplets(n, n, nt, row, col, val);
+  display(L, stdout);
+  new(ones, vector);
+  vector_set_dim(ones, n);
+  for(int i = 0; i < n; ++i) ones->dat[i] = 1.0;
+  struct vector * Lones = matrix_dot(L, ones);
+  real sum = 0;
+  for(int i = 0; i < n; ++i) sum += Lones->dat[i];
+  printf("L 1 = (%g, %g, ..., %g), sum = %g\n",
+         Lones->dat[0], Lones->dat[1], Lones->dat[n - 1], sum);
+  delete(Lones);
+  delete(ones);
+  delete(L);
+  free(row);
+  free(col);
+  free(val);
+
+  /* Conversions between dense and sparse storage */
+  Object S = csr_from_matrix(M);
+  Object ST = csr_transpose(S);
+  init_object(C);
+  printf("M from CSR = \n");
+  set_object(C, csr_to_matrix(S)); matrix_print(C, stdout);
+  printf("M^T from CSR = \n");
+  set_object(C, csr_to_matrix(ST)); matrix_print(C, stdout);
+  printf("S A = \n");
+  set_object(C, matrix_dot(S, A)); matrix_print(C, stdout);
+  printf("A S = \n");
+  set_object(C, matrix_dot(A, S)); matrix_print(C, stdout);
+  printf("S v = ");
+  set_object(C, matrix_dot(S, v)); vector_print(C, stdout); printf("\n");
+  delete(C);
+  delete(S);
+  delete(ST);
+
+  /* Handing arrays over between lists, vectors and matrices */
+  struct double_list x;
+  list_init(&x, 0);
+  list_mode(&x, LIST_DEQUE);
+  for(int i = 0; i < 6; ++i) list_push(&x, 0, 5 - i); /* 0 1 2 3 4 5 */
+  double * x_array = x.element;
+  struct matrix * X = matrix_adopt_list(&x, 2, 3);
+  printf("X from list (no copy? %d, list empty? %d) = \n",
+         X->dat == x_array, x.n == 0 && x.element == NULL);
+  matrix_print(X, stdout);
+  struct vector * xv = vector_borrow_matrix(X);
+  xv->dat[5] = 50.0;
+  printf("Borrowed as a vector: "); vector_print(xv, stdout);
+  printf(", X(1, 2) = %g\n", X->dat[5]);
+  delete(xv);
+  list_borrow_matrix(&x, X);
+  list_sort(&x);
+  list_set(&x, 0, -1.0);
+  printf("List borrowing X: %g ... %g, X(0, 0) = %g\n", list_read(&x, 0),
+         list_read(&x, 5), X->dat[0]);
+  list_append(&x, 6.0); /* Copies the array */
+  list_set(&x, 1, 10.0);
+  printf("After growing: X(0, 1) = %g, list: %d elements\n", X->dat[1], x.n);
+  list_free(&x);
+  list_init(&x, 0);
+  list_adopt_matrix(&x, X);
+  printf("List adopting X: %d elements, X is %d x %d, sum %g\n", x.n,
+         X->rows, X->cols, list_sum(&x));
+  struct vector * y = vector_adopt_list(&x);
+  struct matrix * Y = matrix_adopt_vector(y, 3, 2);
+  printf("Y = \n");
+  matrix_print(Y, stdout);
+  new(Yv, matrix_view, Y, 0, 0, 2, 1);
+  printf("Refused: %d %d %d\n", matrix_adopt_vector(y, 2, 2) == NULL,
+         matrix_borrow_list(&x, 1, 1) == NULL,
+         vector_adopt_matrix(Yv) == NULL);
+  delete(Yv);
+  struct vector * z = vector_adopt_matrix(Y);
+  new(w, vector);
+  list_borrow_vector(&x, z);
+  list_adopt_vector(&x, w); /* Releases the borrowed array, takes w's */
+  printf("z: dim %d, first %g, list: %d elements\n", z->dim, z->dat[0], x.n);
+  list_free(&x);
+  delete(w);
+  delete(z);
+  delete(y);
+  delete(Y);
+  delete(X);
+  list_init(&x, 1000000);
+  t = seconds();
+  struct matrix * big = matrix_adopt_list(&x, 1000, 1000);
+  fprintf(stderr, "Adopting 10^6 elements: %.3f ms\n", 1e3*(seconds() - t));
+  t = seconds();
+  struct vector * big_v = vector_borrow_matrix(big);
+  struct matrix * big_copy = vector_to_matrix(big_v);
+  fprintf(stderr, "Copying them with vector_to_matrix: %.3f ms\n",
+          1e3*(seconds() - t));
+  delete(big_copy);
+  delete(big_v);
+  delete(big);
+
+  /* Rows, columns and blocks */
+  new(G, matrix);
+  matrix_set_dim(G, 4, 5);
+  for(int i = 0; i < 4; ++i)
+    for(int j = 0; j < 5; ++j) G->dat[G->ld*i + j] = 10*i + j;
+  real row_sum = 0.0, column_sum = 0.0, block_sum = 0.0;
+  void * row_it = matrix_row_iterator(G, 2);
+  void * column_it = matrix_column_iterator(G, 3);
+  new(block_it, matrix_iterator, G, 1, 1, 2, 3);
+  for(real * g = get(row_it).p; g; g = next(row_it).p) row_sum += *g;
+  for_each_element(real, g, column_it) column_sum += *g;
+  for_each_element(real, g, block_it) block_sum += *g;
+  printf("Row 2: %g, column 3: %g, block: %g", row_sum, column_sum, block_sum);
+  put(block_it, (union iterator_value) 4);
+  printf(", its element 4: %g", *(real *) get(block_it).p);
+  new(outside, matrix_iterator, G, 3, 3, 2, 2);
+  printf(", outside: %d\n", get(outside).p != NULL);
+  delete(outside);
+  delete(block_it);
+  delete(column_it);
+  delete(row_it);
+  delete(G);
+
   /* Clean up */
   delete(v);
   delete(mv);
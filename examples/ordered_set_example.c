@@ -0,0 +1,186 @@
+# include <stdio.h>
+# include <time.h>
+# include "../ordered_set.h"
+# include "../vector.h"
+
+double seconds()
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + 1e-9*t.tv_nsec;
+}
+
+/* Order vectors by their first component... */
+double first_component(const void * v)
+{
+  const struct vector * self = v;
+  return self->dat[0];
+}
+
+/* ...or compare them by their norm */
+int compare_norms(const void * a, const void * b)
+{
+  real x = vector_norm(a), y = vector_norm(b);
+  return (x > y) - (x < y);
+}
+
+/* Do the leaves hold the n elements of the set in increasing order, and does
+   every node but the root hold at least ORDERED_SET_MIN entries? */
+int check_node(const struct ordered_set * S, const struct btree_node * node,
+               int depth, int * count)
+{
+  if(node != S->root && node->n < ORDERED_SET_MIN) return 0;
+  if(node->leaf) {
+    *count += node->n;
+    for(int i = 1; i < node->n; ++i)
+      if(ordered_compare(S, &node->entry[i - 1], &node->entry[i]) >= 0)
+        return 0;
+    return depth == S->height;
+  }
+  for(int i = 0; i < node->n; ++i)
+    if(!check_node(S, node->child[i], depth + 1, count)) return 0;
+  return 1;
+}
+
+int check(const void * _S)
+{
+  const struct ordered_set * S = _S;
+  const struct set * sS = _S;
+  int count = 0;
+  if(!check_node(S, S->root, 0, &count) || count != sS->nelements) return 0;
+  count = 0;
+  for(const struct btree_node * leaf = S->first; leaf; leaf = leaf->next) {
+    count += leaf->n;
+    if(leaf->next && ordered_compare(S, &leaf->entry[leaf->n - 1],
+                                     &leaf->next->entry[0]) >= 0) return 0;
+  }
+  return count == sS->nelements;
+}
+
+int main()
+{
+  /* 2000 vectors, ordered by first component, with random inserts and drops */
+  int n = 2000;
+  struct vector ** v = malloc(n*sizeof(struct vector *));
+  int * in = calloc(n, sizeof(int));
+  for(int i = 0; i < n; ++i) {
+    v[i] = new_object(vector, NULL);
+    vector_set_dim(v[i], 2);
+    v[i]->dat[0] = i/2; /* Pairs of vectors with the same key */
+    v[i]->dat[1] = 0.5*i;
+  }
+  struct set * S = new_object(ordered_set, first_component);
+  int ok = 1;
+  srand(1);
+  for(int k = 0; k < 200000; ++k) {
+    int i = rand() % n;
+    if(rand() % 3) {insert(S, v[i]); in[i] = 1;}
+    else {drop(S, v[i]); in[i] = 0;}
+    if(k % 1000 == 0) ok = ok && check(S);
+    ok = ok && contains(S, v[i]) == in[i];
+  }
+  int count = 0;
+  for(int i = 0; i < n; ++i) count += in[i];
+  printf("Random inserts and drops: tree ok? %d, %d elements (expected %d)\n",
+         ok && check(S), S->nelements, count);
+  display(S, stdout);
+
+  /* Queries */
+  for(int i = 0; i < n; ++i) insert(S, v[i]);
+  printf("min: %g, max: %g\n", first_component(ordered_set_min(S)),
+         first_component(ordered_set_max(S)));
+  /* Elements that are not in the set work as well */
+  struct vector * a = new_object(vector, NULL), * b = new_object(vector, NULL);
+  vector_set_dim(a, 1);
+  vector_set_dim(b, 1);
+  a->dat[0] = 4.5;
+  b->dat[0] = 9.5;
+  printf("Keys before and after 4.5: %g %g\n",
+         first_component(ordered_set_predecessor(S, a)),
+         first_component(ordered_set_successor(S, a)));
+  printf("Predecessor of min: %p\n", ordered_set_predecessor(S, v[0]));
+
+  /* Range scans */
+  new(it, range_iterator, S, a, b);
+  printf("Keys from 4.5 to 9.5:");
+  for(Object e = get(it).p; e; e = next(it).p)
+    printf(" %g", first_component(e));
+  printf("\nBackwards:");
+  put(it, (union iterator_value) (void *) b);
+  for(Object e = prev(it).p; e; e = prev(it).p)
+    printf(" %g", first_component(e));
+  printf("\n");
+  delete(it);
+  delete(a);
+  delete(b);
+  struct range_iterator * kr = ordered_set_key_range(S, 100.0, 102.0);
+  count = 0;
+  for(Object e = get(kr).p; e; e = next(kr).p) count++;
+  printf("Elements with keys from 100 to 102: %d\n", count);
+  delete(kr);
+
+  /* Set functions work as usual */
+  Object C = clone(S);
+  printf("Clone equal? %d, tree ok? %d\n", equal(S, C), check(C));
+  drop(C, v[0]);
+  printf("After dropping v[0] from the clone: equal? %d\n", equal(S, C));
+  struct set * H = new_object(hash_set, NULL);
+  for(int i = 0; i < n; i += 2) insert(H, v[i]);
+  set_difference_in_place(C, H);
+  printf("Clone minus even vectors: %d elements, tree ok? %d\n",
+         ((struct set *) C)->nelements, check(C));
+  delete(H);
+  delete(C);
+
+  /* Ordering by a comparison function: vectors with the same norm are the
+     same element */
+  struct set * T = new_object(ordered_set, NULL, compare_norms);
+  for(int i = 0; i < 10; ++i) insert(T, v[i]);
+  insert(T, v[0]);
+  printf("Ordered by norm: %d elements, smallest norm %g\n", T->nelements,
+         vector_norm(ordered_set_min(T)));
+  delete(T);
+
+  /* Bulk loading and scanning 10^6 sorted elements */
+  int m = 1000000;
+  struct vector ** w = malloc(m*sizeof(struct vector *));
+  for(int i = 0; i < m; ++i) {
+    w[i] = new_object(vector, NULL);
+    vector_set_dim(w[i], 1);
+    w[i]->dat[0] = i;
+  }
+  struct set * L = new_object(ordered_set, first_component);
+  double t = seconds();
+  ordered_set_load(L, (void * const *) w, m);
+  fprintf(stderr, "Bulk load of 10^6 elements: %.1f ms\n",
+          1e3*(seconds() - t));
+  struct set * I = new_object(ordered_set, first_component);
+  t = seconds();
+  for(int i = 0; i < m; ++i) insert(I, w[i]);
+  fprintf(stderr, "10^6 inserts: %.1f ms\n", 1e3*(seconds() - t));
+  printf("Bulk loaded: %d elements, tree ok? %d, equal to inserted? %d\n",
+         L->nelements, check(L), equal(L, I));
+  display(L, stdout);
+  t = seconds();
+  struct range_iterator * r = ordered_set_key_range(L, 250000, 749999);
+  count = 0;
+  for(Object e = get(r).p; e; e = next(r).p) count++;
+  fprintf(stderr, "Range scan of 5 x 10^5 elements: %.1f ms\n",
+          1e3*(seconds() - t));
+  printf("Range from 250000 to 749999: %d elements\n", count);
+  delete(r);
+  t = seconds();
+  for(int i = 0; i < m; ++i) count += contains(L, w[i]);
+  fprintf(stderr, "10^6 lookups: %.1f ms\n", 1e3*(seconds() - t));
+  delete(L);
+  delete(I);
+  for(int i = 0; i < m; ++i) delete(w[i]);
+  free(w);
+
+  delete(S);
+  for(int i = 0; i < n; ++i) delete(v[i]);
+  free(v);
+  free(in);
+
+  return 0;
+}
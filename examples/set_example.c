@@ -1,6 +1,73 @@
 # include <stdio.h>
+# include <time.h>
 # include "../set.h"
 # include "../matrix.h"
+# include "../list.h"
+
+double seconds()
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + 1e-9*t.tv_nsec;
+}
+
+/* Worker threads for the concurrent set test: every thread inserts its share
+   of the objects, waits for the others and then looks up all of them, either
+   in a concurrent set or in a hash set protected by a single mutex */
+struct worker {
+  void * S;
+  Object * obj;
+  int first, last, n, found;
+  pthread_mutex_t * lock;
+  pthread_barrier_t * inserted;
+};
+
+void * worker_run(void * _w)
+{
+  struct worker * w = _w;
+  for(int i = w->first; i < w->last; ++i) {
+    if(w->lock) pthread_mutex_lock(w->lock);
+    insert(w->S, w->obj[i]);
+    if(w->lock) pthread_mutex_unlock(w->lock);
+  }
+  pthread_barrier_wait(w->inserted);
+  w->found = 0;
+  for(int i = w->first; i < w->first + w->n; ++i) {
+    if(w->lock) pthread_mutex_lock(w->lock);
+    w->found += contains(w->S, w->obj[i % w->n]);
+    if(w->lock) pthread_mutex_unlock(w->lock);
+  }
+  return NULL;
+}
+
+/* Run the workers and return the number of lookups that found something */
+int run_workers(void * S, Object * obj, int n, int nthreads,
+                pthread_mutex_t * lock)
+{
+  pthread_t thread[32];
+  struct worker w[32];
+  pthread_barrier_t inserted;
+  pthread_barrier_init(&inserted, NULL, nthreads);
+  for(int k = 0; k < nthreads; ++k) {
+    w[k] = (struct worker) {S, obj, (long) n*k/nthreads,
+                            (long) n*(k + 1)/nthreads, n, 0, lock, &inserted};
+    pthread_create(&thread[k], NULL, worker_run, &w[k]);
+  }
+  int found = 0;
+  for(int k = 0; k < nthreads; ++k) {
+    pthread_join(thread[k], NULL);
+    found += w[k].found;
+  }
+  pthread_barrier_destroy(&inserted);
+  return found;
+}
+
+/* ID of a vector in the bit set test */
+int vector_id(const void * v)
+{
+  const struct vector * self = v;
+  return (int) self->dat[0];
+}
 
 int main(int argc, char * argv[])
 {
@@ -37,5 +104,362 @@ int main(int argc, char * argv[])
   delete(M);
   delete(v);
 
+  /* Hash sets behave the same, with constant time operations */
+  int n = 100000;
+  struct set * H = new_object(hash_set, NULL);
+  Object * obj = malloc(n*sizeof(Object));
+  for(int i = 0; i < n; ++i) {
+    obj[i] = new_object(abstract_object, NULL);
+    insert(H, obj[i]);
+    insert(H, obj[i]); /* Already there */
+  }
+  Object G = clone(H);
+  printf("\nH elements: %d\n", H->nelements);
+  printf("H == clone of H: %d\n", equal(H, G));
+  for(int i = 0; i < n; i += 2) drop(H, obj[i]);
+  int found = 0;
+  for(int i = 0; i < n; ++i) found += contains(H, obj[i]);
+  printf("H elements after dropping half: %d (found %d)\n", H->nelements,
+         found);
+  printf("H == clone of H: %d\n", equal(H, G));
+  printf("find(H, obj[1]) points to obj[1]: %d\n",
+         ((Object *) H->element)[find(H, obj[1])] == obj[1]);
+  display(H, stdout);
+
+  for(int i = 0; i < n; ++i) delete(obj[i]);
+  free(obj);
+  delete(G);
+  delete(H);
+
+  /* Value sets compare their elements with differs */
+  struct set * S = new_object(value_set, NULL);
+  new(u, vector);
+  vector_set_dim(u, 2);
+  u->dat[0] = 1.0; u->dat[1] = -2.0;
+  struct vector * w = clone(u);
+  insert(S, u);
+  insert(S, w); /* Same value as u */
+  printf("\nS elements after inserting u and a copy: %d\n", S->nelements);
+  w->dat[1] = 2.0;
+  printf("S contains w = (1, 2)? %d\n", contains(S, w));
+  insert(S, w);
+  new(P, set); insert(P, u); insert(P, w);
+  new(Q, set); insert(Q, w); insert(Q, u);
+  printf("P == Q? %d (same hash: %d)\n", !differs(P, Q), hash(P) == hash(Q));
+  Object c = clone(u);
+  drop(S, c);
+  delete(c);
+  printf("S elements after dropping a copy of u: %d\n", S->nelements);
+  delete(P);
+  delete(Q);
+  delete(S);
+  delete(u);
+  delete(w);
+
+  /* Set algebra: X = {x0, x1, x2}, Y = {x1, x2, x3} */
+  Object x[4];
+  new(X, set);
+  new(Y, set);
+  for(int i = 0; i < 4; ++i) {
+    x[i] = new_object(abstract_object, NULL);
+    if(i < 3) insert(X, x[i]);
+    if(i > 0) insert(Y, x[i]);
+  }
+  struct set * R;
+  R = set_union(X, Y);
+  printf("\n|X u Y| = %d\n", R->nelements); delete(R);
+  R = set_intersection(X, Y);
+  printf("|X n Y| = %d\n", R->nelements); delete(R);
+  R = set_difference(X, Y);
+  printf("|X - Y| = %d (x0 in it? %d)\n", R->nelements, contains(R, x[0]));
+  delete(R);
+  R = set_symmetric_difference(X, Y);
+  printf("|X ^ Y| = %d\n", R->nelements); delete(R);
+  set_symmetric_difference_in_place(X, Y);
+  printf("X ^= Y: %d elements, x0 in X? %d, x3 in X? %d\n", X->nelements,
+         contains(X, x[0]), contains(X, x[3]));
+  set_union_in_place(X, Y);
+  printf("X u= Y: %d elements\n", X->nelements);
+  set_intersection_in_place(X, Y);
+  printf("X n= Y: %d elements, X == Y? %d\n", X->nelements, equal(X, Y));
+  set_difference_in_place(X, Y);
+  printf("X -= Y: %d elements\n", X->nelements);
+  for(int i = 0; i < 4; ++i) delete(x[i]);
+  delete(X);
+  delete(Y);
+
+  /* Two hash sets of 10^6 elements sharing half of them */
+  n = 1000000;
+  obj = malloc(3*n/2*sizeof(Object));
+  struct set * HA = new_object(hash_set, NULL);
+  struct set * HB = new_object(hash_set, NULL);
+  hash_set_reserve(HA, n);
+  hash_set_reserve(HB, n);
+  for(int i = 0; i < 3*n/2; ++i) {
+    obj[i] = new_object(abstract_object, NULL);
+    if(i < n) insert(HA, obj[i]);
+    if(i >= n/2) insert(HB, obj[i]);
+  }
+  void * (* operation[4])(const void *, const void *)
+    = {set_union, set_intersection, set_difference, set_symmetric_difference};
+  const char * operation_name[4]
+    = {"union", "intersection", "difference", "symmetric difference"};
+  for(int k = 0; k < 4; ++k) {
+    double t = seconds();
+    R = operation[k](HA, HB);
+    t = seconds() - t;
+    printf("%s of two 10^6 element sets: %d elements\n", operation_name[k],
+           R->nelements);
+    fprintf(stderr, "%s: %.1f ms\n", operation_name[k], 1e3*t);
+    delete(R);
+  }
+  double t = seconds();
+  set_difference_in_place(HA, HB);
+  fprintf(stderr, "difference in place: %.1f ms\n", 1e3*(seconds() - t));
+  printf("HA after removing HB: %d elements\n", HA->nelements);
+  for(int i = 0; i < 3*n/2; ++i) delete(obj[i]);
+  free(obj);
+  delete(HA);
+  delete(HB);
+
+  /* Concurrent sets: 2^18 objects, each inserted by one of 1 to 32 threads
+     and then looked up by all of them, compared with a mutex and a hash set */
+  n = 1 << 18;
+  obj = malloc(n*sizeof(Object));
+  for(int i = 0; i < n; ++i) obj[i] = new_object(abstract_object, NULL);
+  pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+  for(int nthreads = 1; nthreads <= 32; nthreads *= 2) {
+    struct set * CS = new_object(concurrent_set, NULL);
+    double t = seconds();
+    int found = run_workers(CS, obj, n, nthreads, NULL);
+    t = seconds() - t;
+    struct set * LS = new_object(hash_set, NULL);
+    double tl = seconds();
+    run_workers(LS, obj, n, nthreads, &lock);
+    tl = seconds() - tl;
+    printf("%2d threads: %d elements, %d lookups found, equal to locked set: "
+           "%d\n", nthreads, CS->nelements, found, equal(CS, LS));
+    fprintf(stderr, "%2d threads: concurrent set %.1f ms, mutex and hash set "
+            "%.1f ms\n", nthreads, 1e3*t, 1e3*tl);
+    if(nthreads == 32) {
+      for(int i = 0; i < n; i += 2) drop(CS, obj[i]);
+      found = 0;
+      for(int i = 0; i < n; ++i) found += contains(CS, obj[i]);
+      printf("After dropping half: %d elements, %d found\n", CS->nelements,
+             found);
+      R = set_difference(LS, CS);
+      printf("Locked set minus concurrent set: %d elements\n", R->nelements);
+      delete(R);
+      set_difference_in_place(CS, LS);
+      printf("Concurrent set minus locked set: %d elements\n", CS->nelements);
+    }
+    delete(CS);
+    delete(LS);
+  }
+  for(int i = 0; i < n; ++i) delete(obj[i]);
+  free(obj);
+
+  /* Small hash sets keep up to HASH_SET_INLINE elements inside the object;
+     check them against a plain set with random inserts and drops */
+  n = 40;
+  obj = malloc(n*sizeof(Object));
+  for(int i = 0; i < n; ++i) obj[i] = new_object(abstract_object, NULL);
+  struct set * SS = new_object(hash_set, NULL);
+  struct set * PS = new_object(set, NULL);
+  int agree = 1, small = 0;
+  srand(1);
+  for(int k = 0; k < 100000; ++k) {
+    Object o = obj[rand() % (k < 50000 ? HASH_SET_INLINE : n)];
+    if(rand() % 2) {insert(SS, o); insert(PS, o);}
+    else {drop(SS, o); drop(PS, o);}
+    agree = agree && SS->nelements == PS->nelements && equal(SS, PS)
+                  && contains(SS, o) == contains(PS, o);
+    small += ((struct hash_set *) SS)->slot == NULL;
+  }
+  printf("\nSmall hash set agrees with set: %d (small for %d of 100000 "
+         "steps)\n", agree, small);
+  delete(SS);
+  delete(PS);
+
+  /* contains on sets of 8 elements */
+  struct set * small_set = new_object(hash_set, NULL);
+  struct set * plain_set = new_object(set, NULL);
+  for(int i = 0; i < 8; ++i) {
+    insert(small_set, obj[i]);
+    insert(plain_set, obj[i]);
+  }
+  display(small_set, stdout);
+  /* (the best of 5 alternating rounds, so that noise hits both alike) */
+  double best[2] = {1e9, 1e9};
+  int hits[2] = {0, 0};
+  for(int round = 0; round < 10; ++round) {
+    const int k = round % 2;
+    struct set * S8 = k ? plain_set : small_set;
+    double t = seconds();
+    hits[k] = 0;
+    for(int r = 0; r < 1000000; ++r) hits[k] += contains(S8, obj[r % 16]);
+    t = seconds() - t;
+    if(t < best[k]) best[k] = t;
+  }
+  for(int k = 0; k < 2; ++k) {
+    printf("contains in 8 element %s: %d found\n", k ? "set" : "hash set",
+           hits[k]);
+    fprintf(stderr, "contains in 8 element %s: %.1f ns\n",
+            k ? "set" : "hash set", 1e9*best[k]/1000000);
+  }
+  delete(small_set);
+  delete(plain_set);
+  for(int i = 0; i < n; ++i) delete(obj[i]);
+  free(obj);
+
+  /* Bit sets: vectors numbered from 0 to 999 by their first component */
+  n = 1000;
+  struct vector ** vec = malloc(n*sizeof(struct vector *));
+  for(int i = 0; i < n; ++i) {
+    vec[i] = new_object(vector, NULL);
+    vector_set_dim(vec[i], 1);
+    vec[i]->dat[0] = i;
+  }
+  struct set * Even = new_object(bit_set, n, vector_id);
+  struct set * Third = new_object(bit_set, n, vector_id);
+  for(int i = 0; i < n; ++i) {
+    if(i % 2 == 0) insert(Even, vec[i]);
+    if(i % 3 == 0) insert(Third, vec[i]);
+  }
+  printf("Even: %d elements, contains 10? %d, contains 11? %d\n",
+         Even->nelements, contains(Even, vec[10]), contains(Even, vec[11]));
+  R = set_intersection(Even, Third);
+  printf("Multiples of 6: %d\n", R->nelements);
+  set_difference_in_place(Even, R);
+  printf("Even but not multiples of 3: %d, contains 6? %d, contains 8? %d\n",
+         Even->nelements, contains(Even, vec[6]), contains(Even, vec[8]));
+  set_union_in_place(Even, R);
+  struct set * E = clone(Even);
+  drop(Even, vec[0]);
+  printf("Even again: %d elements, equal to clone? %d\n", E->nelements,
+         equal(Even, E));
+  insert(Even, vec[0]);
+  printf("Equal to clone after putting 0 back? %d\n", equal(Even, E));
+  delete(E);
+  delete(R);
+  delete(Even);
+  delete(Third);
+  for(int i = 0; i < n; ++i) delete(vec[i]);
+  free(vec);
+
+  /* Bloom filters: 10^6 lookups, 90% of them misses, on a set of 10^6 */
+  n = 1000000;
+  obj = malloc(2*n*sizeof(Object));
+  for(int i = 0; i < 2*n; ++i) obj[i] = new_object(abstract_object);
+  struct set * F = new_object(hash_set, NULL);
+  struct set * U = new_object(hash_set, NULL);
+  set_attach_filter(F, 0.01, NULL);
+  for(int i = 0; i < n; ++i) {insert(F, obj[i]); insert(U, obj[i]);}
+  int false_negatives = 0;
+  for(int i = 0; i < n; ++i) false_negatives += !contains(F, obj[i]);
+  printf("Filtered set: %d elements, false negatives: %d\n", F->nelements,
+         false_negatives);
+  F->filter->hits = F->filter->misses = F->filter->false_positives = 0;
+  for(int k = 0; k < 2; ++k) {
+    struct set * S = k ? U : F;
+    double t = seconds();
+    int found = 0;
+    for(int r = 0; r < n; ++r)
+      found += contains(S, obj[r % 10 == 0 ? r : n + r]);
+    fprintf(stderr, "10^6 lookups (90%% misses) %s filter: %.1f ms\n",
+            k ? "without" : "with", 1e3*(seconds() - t));
+    printf("Found %s filter: %d\n", k ? "without" : "with", found);
+  }
+  struct bloom_filter * bf = F->filter;
+  double rate = (double) bf->false_positives/(bf->misses + bf->false_positives);
+  printf("False positive rate below 2%%? %d, rebuilds: %ld\n", rate < 0.02,
+         bf->rebuilds);
+  fprintf(stderr, "Filter hits: %ld, misses: %ld, false positives: %ld "
+          "(%.2f%%)\n", bf->hits, bf->misses, bf->false_positives, 100*rate);
+  /* Dropping elements keeps the answers right */
+  for(int i = 0; i < n; i += 2) drop(F, obj[i]);
+  int wrong = 0;
+  for(int i = 0; i < n; ++i) wrong += contains(F, obj[i]) != (i % 2);
+  printf("Wrong answers after dropping half: %d\n", wrong);
+  delete(F);
+  delete(U);
+
+  /* A plain set with a filter, grown by union */
+  struct set * PF = new_object(set, NULL);
+  set_attach_filter(PF, 0.001, NULL);
+  struct set * QF = new_object(hash_set, NULL);
+  for(int i = 0; i < 3000; ++i) insert(i < 1000 ? PF : QF, obj[i]);
+  set_union_in_place(PF, QF);
+  wrong = 0;
+  for(int i = 0; i < 6000; ++i) wrong += contains(PF, obj[i]) != (i < 3000);
+  printf("Plain set with filter: %d elements, wrong answers: %d\n",
+         PF->nelements, wrong);
+  delete(PF);
+  delete(QF);
+
+  /* Building sets of 10^6 elements from 1.5 x 10^6 objects at once */
+  Object * many = malloc((n + n/2)*sizeof(Object));
+  for(int i = 0; i < n + n/2; ++i) many[i] = obj[i < n ? i : i - n];
+  t = seconds();
+  struct set * B1 = set_from_array(set, many, n + n/2);
+  fprintf(stderr, "Set from 1.5 x 10^6 objects: %.1f ms\n",
+          1e3*(seconds() - t));
+  t = seconds();
+  struct set * B2 = set_from_array(hash_set, many, n + n/2);
+  fprintf(stderr, "Hash set from 1.5 x 10^6 objects: %.1f ms\n",
+          1e3*(seconds() - t));
+  t = seconds();
+  struct set * B3 = clone(B1);
+  fprintf(stderr, "Clone of a set of 10^6 elements: %.1f ms\n",
+          1e3*(seconds() - t));
+  printf("Built from array: %d and %d elements, equal? %d, clone equal? %d\n",
+         B1->nelements, B2->nelements, equal(B1, B2), equal(B3, B2));
+  struct set * one = new_object(hash_set, NULL);
+  insert(one, obj[0]);
+  set_intersection_in_place(B2, one);
+  set_intersection_in_place(B3, one);
+  delete(one);
+  set_shrink(B2);
+  set_shrink(B3);
+  printf("After dropping all but one: %d and %d elements, room for %d and %d, "
+         "small? %d\n", B2->nelements, B3->nelements,
+         B2->element_capacity, B3->element_capacity,
+         ((struct hash_set *) B2)->slot == NULL);
+  set_insert_many(B3, obj, 10);
+  set_insert_many(B2, obj, 100);
+  printf("After inserting again: %d and %d elements, still sets? %d\n",
+         B3->nelements, B2->nelements, contains(B3, obj[9])
+         && !contains(B3, obj[10]) && contains(B2, obj[99]));
+  struct obj_list list = {n/2, many + n, n/2};
+  struct set * B4 = set_from_list(value_set, &list);
+  printf("Value set from a list with %d objects: %d elements\n", list.n,
+         B4->nelements);
+  struct obj_list gap_list;
+  list_init(&gap_list, 0);
+  list_mode(&gap_list, LIST_GAP);
+  for(int i = 0; i < 8; ++i) list_push(&gap_list, 0, obj[i]);
+  struct set * B5 = set_from_list(hash_set, &gap_list);
+  printf("Hash set from a gap buffer with 8 objects: %d elements, right? %d\n",
+         B5->nelements, contains(B5, obj[0]) && contains(B5, obj[7]));
+  delete(B5);
+  list_free(&gap_list);
+  printf("Bit set from an array? %d\n",
+         set_from_array(bit_set, many, n) != NULL);
+  int visited = 0, in_B4 = 1;
+  new(it, set_iterator, B4);
+  for(Object e = get(it).p; e; e = next(it).p, ++visited)
+    in_B4 = in_B4 && contains(B4, e);
+  put(it, (union iterator_value) 0);
+  for_each_element(void *, e, it) in_B4 = in_B4 && contains(B4, *e);
+  printf("Iterating: %d elements, all in the set? %d\n", visited, in_B4);
+  delete(it);
+  delete(B1);
+  delete(B2);
+  delete(B3);
+  delete(B4);
+  free(many);
+  for(int i = 0; i < 2*n; ++i) delete(obj[i]);
+  free(obj);
+
   return 0;
 }
@@ -0,0 +1,135 @@
+# include <stdio.h>
+# include <time.h>
+# include "../matrix.h"
+# include "../small_matrix.h"
+
+double seconds()
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + 1e-9*t.tv_nsec;
+}
+
+/* Fill a batch with random numbers plus a multiple of the identity */
+void fill(struct matrix_batch * A)
+{
+  for(int b = 0; b < A->count; ++b)
+    for(int i = 0; i < A->n; ++i)
+      for(int j = 0; j < A->n; ++j)
+        *batch_element(A, b, i, j) = rand()/(real) RAND_MAX + (i == j)*A->n;
+  return;
+}
+
+/* Largest difference between matrix b of a batch and a matrix */
+real difference(struct matrix_batch * A, int b, struct matrix * M)
+{
+  real d = 0;
+  for(int i = 0; i < A->n; ++i)
+    for(int j = 0; j < A->n; ++j)
+      d = fmax(d, fabs(*batch_element(A, b, i, j) - M->dat[M->ld*i + j]));
+  return d;
+}
+
+/* Matrix b of a batch as an ordinary matrix */
+void * to_matrix(struct matrix_batch * A, int b)
+{
+  new(M, matrix);
+  matrix_set_dim(M, A->n, A->n);
+  for(int i = 0; i < A->n; ++i)
+    for(int j = 0; j < A->n; ++j)
+      M->dat[M->ld*i + j] = *batch_element(A, b, i, j);
+  return M;
+}
+
+int main()
+{
+  srand(1);
+  int sizes[4] = {2, 3, 4, 6};
+
+  /* Check the kernels for every size and layout */
+  for(int s = 0; s < 4; ++s)
+    for(int layout = 0; layout < 2; ++layout) {
+      int n = sizes[s], count = 37;
+      new(A, matrix_batch, n, count, layout);
+      new(B, matrix_batch, n, count, layout);
+      fill(A);
+      fill(B);
+      struct matrix_batch * C = batch_dot(A, B);
+      struct matrix_batch * T = batch_transpose(A);
+      struct matrix_batch * I = batch_inverse(A);
+      struct matrix_batch * AI = batch_dot(A, I);
+      real * det = malloc(count*sizeof(real));
+      batch_determinant(A, det);
+      real x[6*37], y[6*37];
+      for(int i = 0; i < n*count; ++i) x[i] = i;
+      batch_matvec(A, x, y);
+      real error = 0;
+      for(int b = 0; b < count; ++b) {
+        struct matrix * a = to_matrix(A, b);
+        struct matrix * bm = to_matrix(B, b);
+        struct matrix * ab = matrix_dot(a, bm);
+        struct matrix * at = matrix_transpose(a);
+        error = fmax(error, difference(C, b, ab));
+        error = fmax(error, difference(T, b, at));
+        for(int i = 0; i < n; ++i) {
+          real yi = 0, yb;
+          for(int j = 0; j < n; ++j)
+            yi += a->dat[n*i + j]*x[layout ? count*j + b : n*b + j];
+          yb = y[layout ? count*i + b : n*b + i];
+          error = fmax(error, fabs(yi - yb));
+          for(int j = 0; j < n; ++j)
+            error = fmax(error, fabs(*batch_element(AI, b, i, j) - (i == j)));
+        }
+        /* Determinant from the product of the LU pivots of a */
+        for(int c = 0; c < n; ++c)
+          for(int r = c + 1; r < n; ++r)
+            for(int j = c + 1; j < n; ++j)
+              a->dat[n*r + j] -= a->dat[n*r + c]/a->dat[n*c + c]
+                                 *a->dat[n*c + j];
+        real d = 1;
+        for(int c = 0; c < n; ++c) d *= a->dat[n*c + c];
+        error = fmax(error, fabs(d - det[b])/fabs(d));
+        delete(a); delete(bm); delete(ab); delete(at);
+      }
+      printf("n = %d, %s layout: %s\n", n,
+             layout ? "interleaved" : "contiguous",
+             error < 1e-10 ? "ok" : "wrong");
+      free(det);
+      delete(A); delete(B); delete(C); delete(T); delete(I); delete(AI);
+    }
+
+  /* Throughput: looped matrix_dot against batches */
+  new(S, matrix_batch, 3, 1, SMALL_MATRIX_CONTIGUOUS);
+  display(S, stdout);
+  delete(S);
+  for(int s = 1; s < 3; ++s) {
+    int n = sizes[s], count = 100000;
+    struct matrix ** a = malloc(count*sizeof(struct matrix *));
+    for(int b = 0; b < count; ++b) {
+      a[b] = new_object(matrix, NULL);
+      matrix_set_dim(a[b], n, n);
+      for(int i = 0; i < n*n; ++i) a[b]->dat[i] = rand()/(real) RAND_MAX;
+    }
+    double t0 = seconds();
+    for(int b = 0; b < count; ++b) delete(matrix_dot(a[b], a[b]));
+    double t1 = seconds();
+    fprintf(stderr, "%d x %d matrix_dot: %.3g matrices per second\n", n, n,
+            count/(t1 - t0));
+    for(int b = 0; b < count; ++b) delete(a[b]);
+    free(a);
+
+    for(int layout = 0; layout < 2; ++layout) {
+      new(A, matrix_batch, n, count, layout);
+      fill(A);
+      t0 = seconds();
+      struct matrix_batch * C = batch_dot(A, A);
+      t1 = seconds();
+      fprintf(stderr, "%d x %d batch_dot (%s): %.3g matrices per second\n",
+              n, n, layout ? "interleaved" : "contiguous", count/(t1 - t0));
+      delete(A);
+      delete(C);
+    }
+  }
+
+  return 0;
+}
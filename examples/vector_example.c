@@ -24,6 +24,11 @@ int main()
   w->dat[2] = -5;
   printf("\nw = "); vector_print(w, stdout); printf("\n");
   display(w, stdout);
+  printf("v == w? %d\n", !differs(v, w));
+  struct vector * u = clone(v);
+  printf("v == clone of v? %d (same hash: %d)\n", !differs(v, u),
+         hash(v) == hash(u));
+  delete(u);
 
   /* Vector operations */
   printf("\nv + w = "); vector_print(vptr = vector_add(v,w), stdout);
@@ -43,6 +48,27 @@ int main()
   free(vptr);
   printf("\n");
 
+  /* A view of an array */
+  real x[4] = {1.0, 2.0, 3.0, 4.0};
+  struct vector * xv = new_object(vector_view, x + 1, 3);
+  xv->dat[0] = 20.0;
+  vector_set_dim(xv, 10); /* Does nothing to views */
+  printf("x[1..3] = "); vector_print(xv, stdout);
+  printf(", x[1] = %g, dim %d\n", x[1], xv->dim);
+  vector_print(vptr = clone(xv), stdout); /* An ordinary vector */
+  printf(" is %s\n", is_a(vptr, vector) ? "a vector" : "a view");
+  delete(vptr);
+
+  /* Iterating over the elements */
+  real sum = 0.0;
+  new(it, vector_iterator, xv);
+  for(real * xi = get(it).p; xi; xi = next(it).p) sum += *xi;
+  put(it, (union iterator_value) 0);
+  for_each_element(real, xi, it) *xi *= 2.0;
+  printf("Sum %g, doubled: ", sum); vector_print(xv, stdout); printf("\n");
+  delete(it);
+  delete(xv);
+
   /* Clean up */
   delete(v);
   delete(w);
@@ -1,5 +1,6 @@
 # ifndef ITERATOR_H
 # define ITERATOR_H
+# include <stddef.h>
 # include "object.h"
 
 # ifndef VARIABLE_TYPE
@@ -24,6 +25,7 @@ struct iterator {
   union iterator_value (* prev)(void * _self);
   union iterator_value (* set)(void * _self, union iterator_value val);
   union iterator_value (* get)(void * _self);
+  int (* next_batch)(void * _self, union iterator_value * buffer, int n);
 };
 
 static void * iterator_constructor(void * _self, va_list * args);
@@ -35,6 +37,9 @@ union iterator_value iterator_prev(void * _self);
 variable_type iterator_type(const void * _self);
 union iterator_value iterator_set(void * _self, union iterator_value val);
 union iterator_value iterator_get(void * _self);
+int iterator_next_batch(void * _self, union iterator_value * buffer, int n);
+int iterator_next_batch_each(void * _self, union iterator_value * buffer,
+                             int n);
 
 static const Class _iterator
   = {sizeof(struct iterator), "iterator", &_abstract_object,
@@ -62,6 +67,7 @@ static void * iterator_constructor(void * _self, va_list * args)
   self->prev = iterator_prev;
   self->set = iterator_set;
   self->get = iterator_get;
+  self->next_batch = iterator_next_batch;
 
   return _self;
 }
@@ -180,6 +186,44 @@ union iterator_value iterator_get(void * _self)
   return self->val;
 }
 
+int iterator_next_batch_each(void * _self, union iterator_value * buffer,
+                             int n)
+{
+  struct iterator * self = _self;
+  for(int j = 0; j < n; ++j) {
+    buffer[j] = self->get ? self->get(_self) : self->val;
+    self->next(_self);
+  }
+  return n;
+}
+
+int iterator_next_batch(void * _self, union iterator_value * buffer, int n)
+{
+  struct iterator * self = _self;
+  if(self->next != iterator_next || self->get != iterator_get)
+    return iterator_next_batch_each(_self, buffer, n); /* Some subclass */
+  switch(self->val_type) {
+    case INT:
+      for(int j = 0; j < n; ++j) buffer[j].i = self->val.i++;
+      break;
+    case CHAR:
+      for(int j = 0; j < n; ++j) buffer[j].c = self->val.c++;
+      break;
+    case FLOAT:
+      for(int j = 0; j < n; ++j, self->val.f += 1.0f) buffer[j].f = self->val.f;
+      break;
+    case DOUBLE:
+      for(int j = 0; j < n; ++j, self->val.d += 1.0) buffer[j].d = self->val.d;
+      break;
+    case STRING:
+      for(int j = 0; j < n; ++j) buffer[j].s = self->val.s++;
+      break;
+    case POINTER:
+      for(int j = 0; j < n; ++j) buffer[j].p = self->val.p++;
+  }
+  return n;
+}
+
 union iterator_value next(void * _self)
 {
   if(inherits_from(_self, iterator)) {
@@ -198,7 +242,7 @@ union iterator_value prev(void * _self)
   return (union iterator_value) NULL;
 }
 
-union iterator_value set(void * _self, union iterator_value val)
+union iterator_value put(void * _self, union iterator_value val)
 {
   if(inherits_from(_self, iterator)) {
     struct iterator * self = _self;
@@ -216,4 +260,160 @@ union iterator_value get(void * _self)
   return (union iterator_value) NULL;
 }
 
+int next_batch(void * _self, union iterator_value * buffer, int n)
+{
+  if(inherits_from(_self, iterator)) {
+    struct iterator * self = _self;
+    if(self->next_batch) return self->next_batch(_self, buffer, n);
+    return iterator_next_batch_each(_self, buffer, n);
+  }
+  return 0;
+}
+
+struct array_iterator {
+  const struct iterator _; /* This item must come first */
+  char * at, * end; /* Current element, and the end of its run */
+  char * first; /* First element of the first run */
+  ptrdiff_t step, jump; /* Bytes between elements, and between runs */
+  int length, last; /* Elements in every run but the last, and in the last */
+  int run, runs; /* Current run (-1 or runs out of the array), and how many */
+  int indirect; /* Are the values the pointers kept in the array? */
+};
+
+static void * array_iterator_constructor(void * _self, va_list * args);
+
+static const Class _array_iterator
+  = {sizeof(struct array_iterator), "array iterator", &_iterator,
+     array_iterator_constructor, NULL};
+
+const void * array_iterator = &_array_iterator;
+
+union iterator_value array_iterator_next(void * _self);
+union iterator_value array_iterator_prev(void * _self);
+union iterator_value array_iterator_put(void * _self, union iterator_value val);
+int array_iterator_next_batch(void * _self, union iterator_value * buffer,
+                              int n);
+
+# define for_each_element(T, x, it) \
+  for(struct array_iterator * _##x = (void *) (it); _##x->at; \
+      array_iterator_seek_run(_##x, _##x->run + 1)) \
+    for(T * x = (T *) _##x->at; (char *) x != _##x->end; \
+        x = (T *) ((char *) x + _##x->step))
+
+/* Current element, or NULL if we are out of the array */
+union iterator_value array_iterator_update(struct array_iterator * self)
+{
+  struct iterator * it = (struct iterator *) self;
+  if(!self->at) it->val.p = NULL;
+  else it->val.p = self->indirect ? *(void **) self->at : self->at;
+  return it->val;
+}
+
+/* Move to the first element of run r */
+union iterator_value array_iterator_seek_run(struct array_iterator * self,
+                                             int r)
+{
+  self->run = r < 0 ? -1 : r > self->runs ? self->runs : r;
+  self->at = self->end = NULL;
+  if(self->run >= 0 && self->run < self->runs) {
+    const int n = self->run == self->runs - 1 ? self->last : self->length;
+    self->at = self->first + self->run*self->jump;
+    self->end = self->at + n*self->step;
+  }
+  return array_iterator_update(self);
+}
+
+/* Lay out the runs and move to the first element */
+void array_iterator_runs(void * _self, void * first, ptrdiff_t step,
+                         int length, ptrdiff_t jump, int runs, int last)
+{
+  struct array_iterator * self = _self;
+  self->first = first;
+  self->step = step;
+  self->length = length;
+  self->jump = jump;
+  self->runs = first && length > 0 && last > 0 ? runs : 0;
+  self->last = last;
+  array_iterator_seek_run(self, 0);
+  return;
+}
+
+static void * array_iterator_constructor(void * _self, va_list * args)
+{
+  struct abstract_object * obj = abstract_object_constructor(_self, args);
+  obj->clone = NULL;
+  struct iterator * it = _self;
+  it->val_type = POINTER;
+  it->next = array_iterator_next;
+  it->prev = array_iterator_prev;
+  it->set = array_iterator_put;
+  it->get = iterator_get;
+  it->next_batch = array_iterator_next_batch;
+  struct array_iterator * self = _self;
+  self->indirect = 0;
+  if(is_a(_self, array_iterator)) { /* Subclasses take other arguments */
+    void * first = va_arg(*args, void *);
+    const int n = va_arg(*args, int);
+    const size_t width = va_arg(*args, size_t);
+    array_iterator_runs(self, first, width, n, 0, 1, n);
+  }
+  return _self;
+}
+
+union iterator_value array_iterator_next(void * _self)
+{
+  struct array_iterator * self = _self;
+  if(!self->at || (self->at += self->step) == self->end)
+    return array_iterator_seek_run(self, self->run + 1);
+  return array_iterator_update(self);
+}
+
+union iterator_value array_iterator_prev(void * _self)
+{
+  struct array_iterator * self = _self;
+  if(self->at && self->at != self->first + self->run*self->jump) {
+    self->at -= self->step;
+    return array_iterator_update(self);
+  }
+  array_iterator_seek_run(self, self->run - 1);
+  if(self->at) self->at = self->end - self->step;
+  return array_iterator_update(self);
+}
+
+/* Move to the element with index val.i */
+union iterator_value array_iterator_put(void * _self, union iterator_value val)
+{
+  struct array_iterator * self = _self;
+  if(val.i < 0) return array_iterator_seek_run(self, -1);
+  int r = self->length ? val.i/self->length : 0;
+  if(r >= self->runs) r = self->runs - 1;
+  array_iterator_seek_run(self, r < 0 ? 0 : r);
+  const int k = val.i - r*self->length;
+  if(!self->at || k >= (self->end - self->at)/self->step)
+    return array_iterator_seek_run(self, self->runs);
+  self->at += k*self->step;
+  return array_iterator_update(self);
+}
+
+int array_iterator_next_batch(void * _self, union iterator_value * buffer,
+                              int n)
+{
+  struct array_iterator * self = _self;
+  int m = 0;
+  while(m < n && self->at) {
+    const ptrdiff_t step = self->step;
+    char * at = self->at;
+    int k = (self->end - at)/step;
+    if(k > n - m) k = n - m;
+    if(self->indirect)
+      for(int j = 0; j < k; ++j) buffer[m + j].p = *(void **) (at + j*step);
+    else for(int j = 0; j < k; ++j) buffer[m + j].p = at + j*step;
+    m += k;
+    self->at = at + k*step;
+    if(self->at == self->end) array_iterator_seek_run(self, self->run + 1);
+  }
+  array_iterator_update(self);
+  return m;
+}
+
 # endif
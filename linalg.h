@@ -0,0 +1,425 @@
+# ifndef LINALG_H
+# define LINALG_H
+# include <stdio.h>
+# include <stdlib.h>
+# include <stdarg.h>
+# include <math.h>
+# include "object.h"
+# include "vector.h"
+# include "matrix.h"
+
+/*** Factorization object definitions ***/
+struct factorization {
+  const struct abstract_object _; /* This item must come first */
+  struct matrix * factor; /* Packed triangular factors */
+  void * (* solve)(const void * self, const void * b);
+};
+
+static void * factorization_constructor(void * _self, va_list * args);
+static void * factorization_destructor(void * _self);
+static void * factorization_display(const void * _self, FILE * fp);
+
+static const Class _factorization
+  = {sizeof(struct factorization), "factorization", &_abstract_object,
+     factorization_constructor, factorization_destructor};
+
+const void * factorization = &_factorization;
+
+struct lu_factorization {
+  const struct factorization _; /* This item must come first */
+  int * pivot; /* Row i of U came from row pivot[i] of A */
+  int sign; /* Sign of the permutation */
+};
+
+static void * lu_factorization_constructor(void * _self, va_list * args);
+static void * lu_factorization_destructor(void * _self);
+static void * lu_factorization_clone(const void * _self);
+
+static const Class _lu_factorization
+  = {sizeof(struct lu_factorization), "lu factors", &_factorization,
+     lu_factorization_constructor, lu_factorization_destructor};
+
+const void * lu_factorization = &_lu_factorization;
+
+struct cholesky_factorization {
+  const struct factorization _; /* This item must come first */
+};
+
+static void * cholesky_factorization_constructor(void * _self, va_list * args);
+static void * cholesky_factorization_clone(const void * _self);
+
+static const Class _cholesky_factorization
+  = {sizeof(struct cholesky_factorization), "cholesky factor",
+     &_factorization, cholesky_factorization_constructor,
+     factorization_destructor};
+
+const void * cholesky_factorization = &_cholesky_factorization;
+
+/*** Linear algebra operations ***/
+void lower_solve(int n, int nrhs, const real * L, int ldl, int unit,
+                 real * B, int ldb);
+void upper_solve(int n, int nrhs, const real * U, int ldu, real * B, int ldb);
+void * matrix_lu(const void * _A);
+void * matrix_cholesky(const void * _A);
+void * lu_solve(const void * _F, const void * _b);
+void * cholesky_solve(const void * _F, const void * _b);
+void * solve(const void * _F, const void * _b);
+void * matrix_solve(const void * _A, const void * _b);
+real matrix_determinant(const void * _A);
+
+/*** Function definitions ***/
+static void * factorization_constructor(void * _self, va_list * args)
+{
+  struct abstract_object * obj = abstract_object_constructor(_self, args);
+  obj->display = factorization_display;
+  struct factorization * self = _self;
+  self->factor = NULL;
+  self->solve = NULL;
+  return _self;
+}
+
+static void * factorization_destructor(void * _self)
+{
+  struct factorization * self = _self;
+  delete(self->factor);
+  return NULL;
+}
+
+static void * factorization_display(const void * _self, FILE * fp)
+{
+  abstract_object_display(_self, fp);
+
+  if(inherits_from(_self, factorization)) {
+    const struct factorization * self = _self;
+    if(self->factor)
+      fprintf(fp, "dim: %d x %d\n", self->factor->rows, self->factor->cols);
+  }
+  return NULL;
+}
+
+static void * lu_factorization_constructor(void * _self, va_list * args)
+{
+  struct abstract_object * obj = factorization_constructor(_self, args);
+  obj->clone = lu_factorization_clone;
+  struct factorization * fself = _self;
+  fself->solve = lu_solve;
+  struct lu_factorization * self = _self;
+  self->pivot = NULL;
+  self->sign = 1;
+  return _self;
+}
+
+static void * lu_factorization_destructor(void * _self)
+{
+  struct lu_factorization * self = _self;
+  free(self->pivot);
+  return factorization_destructor(_self);
+}
+
+static void * lu_factorization_clone(const void * _self)
+{
+  if(inherits_from(_self, lu_factorization)) {
+    const struct factorization * fself = _self;
+    const struct lu_factorization * self = _self;
+    new(F, lu_factorization);
+    struct factorization * fF = _F;
+    fF->factor = clone(fself->factor);
+    int n = fself->factor ? fself->factor->rows : 0;
+    F->pivot = malloc((n > 0 ? n : 1)*sizeof(int));
+    for(int i = 0; i < n; ++i) F->pivot[i] = self->pivot[i];
+    F->sign = self->sign;
+    return F;
+  }
+  return NULL;
+}
+
+static void * cholesky_factorization_constructor(void * _self, va_list * args)
+{
+  struct abstract_object * obj = factorization_constructor(_self, args);
+  obj->clone = cholesky_factorization_clone;
+  struct factorization * self = _self;
+  self->solve = cholesky_solve;
+  return _self;
+}
+
+static void * cholesky_factorization_clone(const void * _self)
+{
+  if(inherits_from(_self, cholesky_factorization)) {
+    const struct factorization * self = _self;
+    new(F, cholesky_factorization);
+    struct factorization * fF = _F;
+    fF->factor = clone(self->factor);
+    return F;
+  }
+  return NULL;
+}
+
+# ifndef LINALG_BLOCK
+# define LINALG_BLOCK 64
+# endif
+
+/* Solve L X = B by forward substitution */
+void lower_solve(int n, int nrhs, const real * L, int ldl, int unit,
+                 real * B, int ldb)
+{
+  for(int ib = 0; ib < n; ib += LINALG_BLOCK) {
+    const int nb = n - ib < LINALG_BLOCK ? n - ib : LINALG_BLOCK;
+    /* Diagonal block */
+    for(int i = ib; i < ib + nb; ++i) {
+      real * bi = B + (long int) ldb*i;
+      for(int p = ib; p < i; ++p) {
+        const real l = L[(long int) ldl*i + p];
+        const real * bp = B + (long int) ldb*p;
+        for(int c = 0; c < nrhs; ++c) bi[c] -= l*bp[c];
+      }
+      if(!unit) {
+        const real d = L[(long int) ldl*i + i];
+        for(int c = 0; c < nrhs; ++c) bi[c] /= d;
+      }
+    }
+    /* Update the rows below the block */
+    matrix_gemm(n - ib - nb, nrhs, nb, -1,
+                L + (long int) ldl*(ib + nb) + ib, ldl,
+                B + (long int) ldb*ib, ldb,
+                1, B + (long int) ldb*(ib + nb), ldb);
+  }
+  return;
+}
+
+/* Solve U X = B by back substitution */
+void upper_solve(int n, int nrhs, const real * U, int ldu, real * B, int ldb)
+{
+  for(int ie = n; ie > 0; ie -= LINALG_BLOCK) {
+    const int ib = ie - LINALG_BLOCK > 0 ? ie - LINALG_BLOCK : 0;
+    /* Diagonal block */
+    for(int i = ie - 1; i >= ib; --i) {
+      real * bi = B + (long int) ldb*i;
+      for(int p = i + 1; p < ie; ++p) {
+        const real u = U[(long int) ldu*i + p];
+        const real * bp = B + (long int) ldb*p;
+        for(int c = 0; c < nrhs; ++c) bi[c] -= u*bp[c];
+      }
+      const real d = U[(long int) ldu*i + i];
+      for(int c = 0; c < nrhs; ++c) bi[c] /= d;
+    }
+    /* Update the rows above the block */
+    matrix_gemm(ib, nrhs, ie - ib, -1, U + ib, ldu,
+                B + (long int) ldb*ib, ldb, 1, B, ldb);
+  }
+  return;
+}
+
+void * matrix_lu(const void * _A)
+{
+  const struct matrix * A = _A;
+  if(!inherits_from(A, matrix) || A->rows != A->cols) return NULL;
+
+  const int n = A->rows;
+  const long int lda = n;
+  new(F, lu_factorization);
+  struct factorization * fF = _F;
+  fF->factor = clone(A);
+  F->pivot = malloc((n > 0 ? n : 1)*sizeof(int));
+  for(int i = 0; i < n; ++i) F->pivot[i] = i;
+  real * a = fF->factor->dat;
+
+  for(int jb = 0; jb < n; jb += LINALG_BLOCK) {
+    const int nb = n - jb < LINALG_BLOCK ? n - jb : LINALG_BLOCK;
+
+    /* Factorize the panel (columns jb to jb + nb - 1) */
+    for(int c = jb; c < jb + nb; ++c) {
+      int p = c;
+      for(int r = c + 1; r < n; ++r)
+        if(fabs(a[lda*r + c]) > fabs(a[lda*p + c])) p = r;
+      if(a[lda*p + c] == 0) {
+        delete(F);
+        return NULL;
+      }
+      if(p != c) {
+        for(int j = 0; j < n; ++j) {
+          real tmp = a[lda*c + j];
+          a[lda*c + j] = a[lda*p + j];
+          a[lda*p + j] = tmp;
+        }
+        int tmp = F->pivot[c]; F->pivot[c] = F->pivot[p]; F->pivot[p] = tmp;
+        F->sign = -F->sign;
+      }
+      const real d = a[lda*c + c];
+      for(int r = c + 1; r < n; ++r) {
+        real * ar = a + lda*r;
+        const real l = ar[c] /= d;
+        const real * ac = a + lda*c;
+        for(int j = c + 1; j < jb + nb; ++j) ar[j] -= l*ac[j];
+      }
+    }
+
+    /* U12 = L11^-1 A12 */
+    lower_solve(nb, n - jb - nb, a + lda*jb + jb, n, 1,
+                a + lda*jb + jb + nb, n);
+
+    /* A22 -= L21 U12 */
+    matrix_gemm(n - jb - nb, n - jb - nb, nb, -1,
+                a + lda*(jb + nb) + jb, n,
+                a + lda*jb + jb + nb, n,
+                1, a + lda*(jb + nb) + jb + nb, n);
+  }
+
+  return F;
+}
+
+void * matrix_cholesky(const void * _A)
+{
+  const struct matrix * A = _A;
+  if(!inherits_from(A, matrix) || A->rows != A->cols) return NULL;
+
+  const int n = A->rows;
+  const long int lda = n;
+  new(F, cholesky_factorization);
+  struct factorization * fF = _F;
+  fF->factor = clone(A);
+  real * a = fF->factor->dat;
+  real * w = malloc(((long int) LINALG_BLOCK*n + 1)*sizeof(real));
+
+  for(int jb = 0; jb < n; jb += LINALG_BLOCK) {
+    const int nb = n - jb < LINALG_BLOCK ? n - jb : LINALG_BLOCK;
+    const int m = n - jb - nb; /* Rows below the diagonal block */
+
+    /* L11 */
+    for(int c = jb; c < jb + nb; ++c) {
+      if(!(a[lda*c + c] > 0)) {
+        free(w);
+        delete(F);
+        return NULL;
+      }
+      const real d = a[lda*c + c] = sqrt(a[lda*c + c]);
+      for(int r = c + 1; r < jb + nb; ++r) a[lda*r + c] /= d;
+      for(int r = c + 1; r < jb + nb; ++r)
+        for(int s = c + 1; s <= r; ++s)
+          a[lda*r + s] -= a[lda*r + c]*a[lda*s + c];
+    }
+
+    /* L21 = A21 L11^-T, one row at a time */
+    for(int r = jb + nb; r < n; ++r) {
+      real * ar = a + lda*r;
+      for(int c = jb; c < jb + nb; ++c) {
+        const real * ac = a + lda*c;
+        real x = ar[c];
+        for(int p = jb; p < c; ++p) x -= ar[p]*ac[p];
+        ar[c] = x/ac[c];
+      }
+    }
+
+    /* A22 -= L21 L21^T (lower triangle only) */
+    for(int r = 0; r < m; ++r)
+      for(int c = 0; c < nb; ++c)
+        w[(long int) m*c + r] = a[lda*(jb + nb + r) + jb + c];
+    for(int rb = 0; rb < m; rb += LINALG_BLOCK) {
+      const int mb = m - rb < LINALG_BLOCK ? m - rb : LINALG_BLOCK;
+      matrix_gemm(mb, rb + mb, nb, -1,
+                  a + lda*(jb + nb + rb) + jb, n, w, m,
+                  1, a + lda*(jb + nb + rb) + jb + nb, n);
+    }
+  }
+  free(w);
+
+  /* Mirror L into the upper triangle */
+  for(int i = 0; i < n; ++i)
+    for(int j = i + 1; j < n; ++j) a[lda*i + j] = a[lda*j + i];
+
+  return F;
+}
+
+/* Copy b (vector or matrix) into a new object, permuting its rows */
+void * linalg_rhs(const void * _b, int n, const int * pivot, real ** x,
+                  int * nrhs)
+{
+  const struct matrix * B = _b;
+  const struct vector * u = _b;
+  if(inherits_from(B, matrix) && B->rows == n) {
+    new(X, matrix);
+    matrix_set_dim(X, B->rows, B->cols);
+    for(int i = 0; i < n; ++i) {
+      const real * bi = B->dat + (long int) B->ld*(pivot ? pivot[i] : i);
+      for(int c = 0; c < B->cols; ++c) X->dat[(long int) X->cols*i + c] = bi[c];
+    }
+    *x = X->dat;
+    *nrhs = X->cols;
+    return X;
+  } else if(inherits_from(u, vector) && u->dim == n) {
+    new(v, vector);
+    vector_set_dim(v, n);
+    for(int i = 0; i < n; ++i) v->dat[i] = u->dat[pivot ? pivot[i] : i];
+    *x = v->dat;
+    *nrhs = 1;
+    return v;
+  }
+  return NULL;
+}
+
+void * lu_solve(const void * _F, const void * _b)
+{
+  if(!inherits_from(_F, lu_factorization)) return NULL;
+  const struct factorization * F = _F;
+  const struct lu_factorization * LU = _F;
+  const int n = F->factor->rows;
+  real * x;
+  int nrhs;
+  void * X = linalg_rhs(_b, n, LU->pivot, &x, &nrhs);
+  if(X) {
+    lower_solve(n, nrhs, F->factor->dat, n, 1, x, nrhs);
+    upper_solve(n, nrhs, F->factor->dat, n, x, nrhs);
+  }
+  return X;
+}
+
+void * cholesky_solve(const void * _F, const void * _b)
+{
+  if(!inherits_from(_F, cholesky_factorization)) return NULL;
+  const struct factorization * F = _F;
+  const int n = F->factor->rows;
+  real * x;
+  int nrhs;
+  void * X = linalg_rhs(_b, n, NULL, &x, &nrhs);
+  if(X) {
+    lower_solve(n, nrhs, F->factor->dat, n, 0, x, nrhs);
+    upper_solve(n, nrhs, F->factor->dat, n, x, nrhs);
+  }
+  return X;
+}
+
+/* Solve using any factorization */
+void * solve(const void * _F, const void * _b)
+{
+  if(inherits_from(_F, factorization)) {
+    const struct factorization * F = _F;
+    if(F->solve && F->factor) return F->solve(_F, _b);
+  }
+  return NULL;
+}
+
+/* Solve A x = b in one go */
+void * matrix_solve(const void * _A, const void * _b)
+{
+  void * F = matrix_lu(_A);
+  if(F) {
+    void * x = lu_solve(F, _b);
+    delete(F);
+    return x;
+  }
+  return NULL;
+}
+
+/* Determinant (product of the pivots) */
+real matrix_determinant(const void * _A)
+{
+  const struct matrix * A = _A;
+  if(!inherits_from(A, matrix) || A->rows != A->cols) return real_val(0.0);
+  struct lu_factorization * F = matrix_lu(A);
+  if(F == NULL) return real_val(0.0); /* Singular matrix */
+  const struct factorization * fF = (struct factorization *) F;
+  real det = F->sign;
+  for(int i = 0; i < A->rows; ++i) det *= fF->factor->dat[(A->rows + 1)*i];
+  delete(F);
+  return det;
+}
+# endif
@@ -3,48 +3,594 @@
 
 # include <stdio.h>
 # include <stdlib.h>
+# include <stdint.h>
 # include <string.h>
+# include <limits.h>
+# include <math.h>
+# include <pthread.h>
+# include <unistd.h>
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include "iterator.h"
 
-struct int_list { int n; int * element; int size; };
-struct float_list { int n; float * element; int size; };
-struct double_list { int n; double * element; int size; };
-struct char_list { int n; char * element; int size; };
-struct string_list { int n; char ** element; int size; };
-struct obj_list { int n; void ** element; int size; };
+/* Who the array of elements of a list belongs to: the list itself, a mapping
+   of a list file (see list_map), or somebody else, such as a vector that the
+   list borrows it from (see matrix.h) */
+enum list_owner {LIST_OWNED, LIST_MAPPED, LIST_BORROWED};
+
+struct list_storage {
+  int owner; /* LIST_OWNED (0), LIST_MAPPED or LIST_BORROWED */
+  void * base; /* Start of the mapping (the header of the file) */
+  size_t length; /* and its length in bytes */
+};
+
+struct int_list { int n; int * element; int size; int mode; int at;
+                  struct list_storage storage; };
+struct float_list { int n; float * element; int size; int mode; int at;
+                    struct list_storage storage; };
+struct double_list { int n; double * element; int size; int mode; int at;
+                     struct list_storage storage; };
+struct char_list { int n; char * element; int size; int mode; int at;
+                   struct list_storage storage; };
+struct string_list { int n; char ** element; int size; int mode; int at;
+                      struct list_storage storage; struct string_pool * pool; };
+struct obj_list { int n; void ** element; int size; int mode; int at;
+                  struct list_storage storage; };
+struct int8_list { int n; int8_t * element; int size; int mode; int at;
+                   struct list_storage storage; };
+struct uint8_list { int n; uint8_t * element; int size; int mode; int at;
+                    struct list_storage storage; };
+struct int16_list { int n; int16_t * element; int size; int mode; int at;
+                    struct list_storage storage; };
+struct uint16_list { int n; uint16_t * element; int size; int mode; int at;
+                     struct list_storage storage; };
+struct uint32_list { int n; uint32_t * element; int size; int mode; int at;
+                     struct list_storage storage; };
+struct int64_list { int n; int64_t * element; int size; int mode; int at;
+                    struct list_storage storage; };
+struct uint64_list { int n; uint64_t * element; int size; int mode; int at;
+                     struct list_storage storage; };
+
+# define STRING_POOL_BLOCK 65536 /* Size of the first block */
+
+struct string_header {
+  uint64_t prefix; /* First 8 bytes, big-endian */
+  uint64_t hash;
+  size_t length;
+};
+
+struct string_pool {
+  char * block; /* Current block (which starts with the address of the
+                   previous one) */
+  size_t used, capacity; /* Bytes used and available in the current block */
+  int nblocks;
+  char ** slot; /* Hash table of the strings */
+  size_t nslots, count;
+};
+
+# define PACKED_BLOCK 128 /* Values per block */
+
+struct packed_block {
+  int64_t base; /* Smallest value */
+  int width; /* Bits per value */
+  int offset; /* First word */
+};
+
+struct packed_list {
+  int n;
+  int nblocks, block_size; /* Packed blocks, and the room for them */
+  struct packed_block * block;
+  uint64_t * word;
+  int nwords, word_size; /* Words used, and the room for them */
+  int64_t tail[PACKED_BLOCK]; /* Values not packed yet */
+};
+
+enum list_type {LIST_TYPE_INT = 1, LIST_TYPE_FLOAT, LIST_TYPE_DOUBLE,
+                LIST_TYPE_CHAR, LIST_TYPE_INT8, LIST_TYPE_UINT8,
+                LIST_TYPE_INT16, LIST_TYPE_UINT16, LIST_TYPE_UINT32,
+                LIST_TYPE_INT64, LIST_TYPE_UINT64};
+enum list_map_mode {LIST_MAP_READONLY, LIST_MAP_PRIVATE};
+
+# define LIST_FILE_MAGIC "ooclist"
+# define LIST_FILE_ORDER 0x01020304u
+
+struct list_file_header {
+  char magic[8];
+  uint32_t order; /* LIST_FILE_ORDER, as written by the machine */
+  uint32_t type;
+  uint32_t width; /* Bytes per element */
+  uint32_t reserved;
+  uint64_t n;
+};
+
+/* Free an array of elements, or unmap it, or leave it to its owner; the list
+   then owns whatever array it gets next (storage may be NULL for arrays that
+   are always ours) */
+void list_release(void * element, struct list_storage * storage)
+{
+  if(!storage || storage->owner == LIST_OWNED) free(element);
+  else if(storage->owner == LIST_MAPPED) munmap(storage->base, storage->length);
+  if(storage) storage->owner = LIST_OWNED;
+  return;
+}
+
+/* Resize an array of elements from old to new bytes, copying it to memory of
+   our own if it is mapped or borrowed */
+void * list_reallocate(void * element, struct list_storage * storage,
+                       size_t old, size_t new)
+{
+  if(!storage || storage->owner == LIST_OWNED) return realloc(element, new);
+  void * e = malloc(new);
+  if(e) memcpy(e, element, old < new ? old : new);
+  list_release(element, storage);
+  return e;
+}
+
+/* An array of the given size in bytes that belongs to us (element itself,
+   unless it is mapped or borrowed, and then a copy) */
+void * list_detach(void * element, struct list_storage * storage,
+                   size_t bytes)
+{
+  if(!storage || storage->owner == LIST_OWNED) return element;
+  void * e = malloc(bytes + 1);
+  if(!e) {
+    fprintf(stderr, "Error: list: unable to allocate memory.\n");
+    exit(-1);
+  }
+  memcpy(e, element, bytes);
+  list_release(element, storage);
+  return e;
+}
+
+/* Write the elements in the two runs of an array to a file */
+int list_save_runs(const char * path, enum list_type type, size_t width,
+                   const void * element, const int start[2],
+                   const int count[2])
+{
+  struct list_file_header header = {LIST_FILE_MAGIC, LIST_FILE_ORDER, type,
+                                    width, 0, count[0] + count[1]};
+  FILE * fp = fopen(path, "wb");
+  if(!fp) return 0;
+  const char * e = element;
+  int ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+  for(int r = 0; r < 2 && ok; ++r)
+    ok = fwrite(e + start[r]*width, width, count[r], fp) == (size_t) count[r];
+  return fclose(fp) == 0 && ok;
+}
+
+/* Map a list file, and give the elements (NULL if we cannot), their number
+   and the storage of the list that takes them */
+void * list_map_file(const char * path, enum list_type type, size_t width,
+                     enum list_map_mode how, int * n,
+                     struct list_storage * storage)
+{
+  struct list_file_header header;
+  struct stat st;
+  const int fd = open(path, O_RDONLY);
+  if(fd < 0) return NULL;
+  if(fstat(fd, &st) || read(fd, &header, sizeof(header)) != sizeof(header)
+     || memcmp(header.magic, LIST_FILE_MAGIC, 8)
+     || header.order != LIST_FILE_ORDER || header.type != (uint32_t) type
+     || header.width != width || header.n > INT_MAX
+     || (uint64_t) st.st_size < sizeof(header) + header.n*width) {
+    close(fd);
+    return NULL;
+  }
+  const size_t length = sizeof(header) + header.n*width;
+  void * base = how == LIST_MAP_PRIVATE
+                ? mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0)
+                : mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(base == MAP_FAILED) return NULL;
+  storage->owner = LIST_MAPPED;
+  storage->base = base;
+  storage->length = length;
+  *n = header.n;
+  return (char *) base + sizeof(header);
+}
+
+/* Size for at least n elements, at least doubling the old size */
+int list_new_size(int size, int n)
+{
+  int new_size = size < 4 ? 8 : 2*size;
+  return new_size < n ? n : new_size;
+}
+
+/* Reallocate an array with size elements of the given width for at least n
+   elements, at least doubling its size */
+void * list_grow(void * element, struct list_storage * storage, int * size,
+                 int n, size_t width)
+{
+  if(n <= *size) return element;
+  int new_size = list_new_size(*size, n);
+  element = list_reallocate(element, storage, *size*width, new_size*width);
+  if(!element) {
+    fprintf(stderr, "Error: list: unable to allocate memory for list.\n");
+    exit(-1);
+  }
+  *size = new_size;
+  return element;
+}
+
+/* Reallocate an array for exactly n elements of the given width (freeing it
+   if n is 0) */
+void * list_fit(void * element, struct list_storage * storage, int * size,
+                int n, size_t width)
+{
+  if(n == 0) {
+    list_release(element, storage);
+    element = NULL;
+  } else element = list_reallocate(element, storage, *size*width, n*width);
+  *size = n;
+  return element;
+}
+
+enum list_mode {LIST_PLAIN, LIST_DEQUE, LIST_GAP};
+
+# define list_index(list, i) \
+  list_position((list)->mode, (list)->at, (list)->n, (list)->size, i)
+
+/* Position of element i in the array of a list */
+int list_position(int mode, int at, int n, int size, int i)
+{
+  if(mode == LIST_DEQUE) return at + i < size ? at + i : at + i - size;
+  if(mode == LIST_GAP && i >= at) return i + size - n;
+  return i;
+}
+
+/* Move count elements of a ring buffer from position src to position dst,
+   one place down (dst = src - 1) or up (dst = src + 1), in as few memmoves as
+   the wrapping allows */
+void list_ring_move(char * e, int size, int src, int dst, int count,
+                    size_t width)
+{
+  const int down = dst == (src > 0 ? src - 1 : size - 1);
+  while(count > 0) {
+    int chunk = count;
+    if(down) {
+      /* Front to back */
+      if(chunk > size - src) chunk = size - src;
+      if(chunk > size - dst) chunk = size - dst;
+      memmove(e + dst*width, e + src*width, chunk*width);
+      src = (src + chunk) % size;
+      dst = (dst + chunk) % size;
+    } else {
+      /* Back to front */
+      const int s_last = (src + count - 1) % size;
+      const int d_last = (dst + count - 1) % size;
+      if(chunk > s_last + 1) chunk = s_last + 1;
+      if(chunk > d_last + 1) chunk = d_last + 1;
+      memmove(e + (d_last - chunk + 1)*width, e + (s_last - chunk + 1)*width,
+              chunk*width);
+    }
+    count -= chunk;
+  }
+  return;
+}
+
+/* Move the gap of a gap buffer in front of element g */
+void list_move_gap(char * e, int * at, int n, int size, int g, size_t width)
+{
+  const int gap = size - n;
+  if(g < *at) memmove(e + (g + gap)*width, e + g*width, (*at - g)*width);
+  else memmove(e + *at*width, e + (*at + gap)*width, (g - *at)*width);
+  *at = g;
+  return;
+}
+
+/* Grow the array of a list with n elements to new_size elements */
+void * list_expand(void * element, struct list_storage * storage, int * size,
+                   int * at, int n, int mode, int new_size, size_t width)
+{
+  const int old_size = *size;
+  char * e = list_reallocate(element, storage, old_size*width,
+                             new_size*width);
+  if(!e) {
+    fprintf(stderr, "Error: list: unable to allocate memory for list.\n");
+    exit(-1);
+  }
+  if(mode == LIST_DEQUE && *at + n > old_size) {
+    /* Move the elements before the wrap to the end */
+    memmove(e + (*at + new_size - old_size)*width, e + *at*width,
+            (old_size - *at)*width);
+    *at += new_size - old_size;
+  } else if(mode == LIST_GAP)
+    memmove(e + (*at + new_size - n)*width, e + (*at + old_size - n)*width,
+            (n - *at)*width);
+  *size = new_size;
+  return e;
+}
+
+/* Make room for a new element i in a list with n elements */
+void * list_open(void * element, struct list_storage * storage, int * size,
+                 int * at, int n, int mode, int i, size_t width)
+{
+  if(n == *size) {
+    if(mode == LIST_PLAIN)
+      element = list_grow(element, storage, size, n + 1, width);
+    else element = list_expand(element, storage, size, at, n, mode,
+                               list_new_size(*size, n + 1), width);
+  }
+  char * e = element;
+  if(mode == LIST_DEQUE) {
+    const int first = *at, place = list_position(mode, *at, n, *size, i);
+    if(i < n - i) {
+      /* Start one position earlier and move the first i elements down */
+      *at = *at > 0 ? *at - 1 : *size - 1;
+      list_ring_move(e, *size, first, *at, i, width);
+    } else
+      list_ring_move(e, *size, place, (place + 1) % *size, n - i, width);
+  } else if(mode == LIST_GAP) {
+    list_move_gap(e, at, n, *size, i, width);
+    (*at)++; /* The new element takes the first place of the gap */
+  } else memmove(e + (i + 1)*width, e + i*width, (n - i)*width);
+  return element;
+}
+
+/* Close the place of element i in a list with n elements */
+void list_close(void * element, int size, int * at, int n, int mode, int i,
+                size_t width)
+{
+  char * e = element;
+  if(mode == LIST_DEQUE) {
+    const int place = list_position(mode, *at, n, size, i);
+    if(i < n - 1 - i) {
+      /* Move the first i elements up and start one position later */
+      list_ring_move(e, size, *at, (*at + 1) % size, i, width);
+      *at = *at + 1 < size ? *at + 1 : 0;
+    } else
+      list_ring_move(e, size, (place + 1) % size, place, n - 1 - i, width);
+  } else if(mode == LIST_GAP)
+    list_move_gap(e, at, n, size, i, width); /* Element i joins the gap */
+  else memmove(e + i*width, e + (i + 1)*width, (n - i - 1)*width);
+  return;
+}
+
+/* Put the n elements of a list in order at the start of its array */
+void list_linearize(void * element, int size, int * at, int n, int mode,
+                    size_t width)
+{
+  char * e = element;
+  if(mode == LIST_DEQUE && *at > 0) {
+    if(*at + n <= size) memmove(e, e + *at*width, n*width);
+    else {
+      const int tail = size - *at; /* Elements before the wrap */
+      char * tmp = malloc(tail*width);
+      memcpy(tmp, e + *at*width, tail*width);
+      memmove(e + tail*width, e, (n - tail)*width);
+      memcpy(e, tmp, tail*width);
+      free(tmp);
+    }
+    *at = 0;
+  } else if(mode == LIST_GAP) list_move_gap(e, at, n, size, n, width);
+  return;
+}
+
+struct string_pool * string_pool_new()
+{
+  struct string_pool * pool = calloc(1, sizeof(struct string_pool));
+  if(!pool) {
+    fprintf(stderr, "Error: string_pool: unable to allocate memory.\n");
+    exit(-1);
+  }
+  return pool;
+}
+
+void string_pool_free(struct string_pool * pool)
+{
+  if(!pool) return;
+  while(pool->block) {
+    char * previous;
+    memcpy(&previous, pool->block, sizeof(char *));
+    free(pool->block);
+    pool->block = previous;
+  }
+  free(pool->slot);
+  free(pool);
+  return;
+}
+
+/* Room for size bytes in the pool */
+void * string_pool_alloc(struct string_pool * pool, size_t size)
+{
+  size = (size + 7) & ~(size_t) 7;
+  if(pool->used + size > pool->capacity) {
+    size_t capacity = pool->capacity ? 2*pool->capacity : STRING_POOL_BLOCK;
+    if(capacity < size + 8) capacity = size + 8;
+    char * block = malloc(capacity);
+    if(!block) {
+      fprintf(stderr, "Error: string_pool: unable to allocate memory.\n");
+      exit(-1);
+    }
+    memcpy(block, &pool->block, sizeof(char *));
+    pool->block = block;
+    pool->capacity = capacity;
+    pool->used = 8;
+    pool->nblocks++;
+  }
+  void * p = pool->block + pool->used;
+  pool->used += size;
+  return p;
+}
+
+uint64_t string_hash(const char * s, size_t length)
+{
+  uint64_t h = 0x9e3779b97f4a7c15u ^ length, w;
+  size_t i = 0;
+  for(; i + 8 <= length; i += 8) {
+    memcpy(&w, s + i, 8);
+    h = (h ^ w)*0xbf58476d1ce4e5b9u;
+    h ^= h >> 31;
+  }
+  w = 0;
+  memcpy(&w, s + i, length - i);
+  h = (h ^ w)*0xbf58476d1ce4e5b9u;
+  h ^= h >> 29;
+  h *= 0x94d049bb133111ebu;
+  return h ^ (h >> 32);
+}
+
+uint64_t string_prefix_key(const char * s, size_t length)
+{
+  uint64_t key = 0;
+  for(size_t b = 0; b < 8; ++b)
+    key = key << 8 | (b < length ? (unsigned char) s[b] : 0);
+  return key;
+}
+
+/* Header of a string from a pool */
+const struct string_header * string_header(const char * s)
+{return (const struct string_header *) s - 1;}
+
+void string_pool_rehash(struct string_pool * pool, size_t nslots)
+{
+  char ** slot = calloc(nslots, sizeof(char *));
+  for(size_t k = 0; k < pool->nslots; ++k)
+    if(pool->slot[k]) {
+      size_t h = string_header(pool->slot[k])->hash & (nslots - 1);
+      while(slot[h]) h = (h + 1) & (nslots - 1);
+      slot[h] = pool->slot[k];
+    }
+  free(pool->slot);
+  pool->slot = slot;
+  pool->nslots = nslots;
+  return;
+}
+
+/* Slot of the table with the string s of the given length and hash, or the
+   empty slot where it would go */
+size_t string_pool_slot(const struct string_pool * pool, const char * s,
+                        size_t length, uint64_t hash)
+{
+  const size_t mask = pool->nslots - 1;
+  size_t k = hash & mask;
+  for(; pool->slot[k]; k = (k + 1) & mask) {
+    const struct string_header * e = string_header(pool->slot[k]);
+    if(e->hash == hash && e->length == length
+       && !memcmp(pool->slot[k], s, length)) break;
+  }
+  return k;
+}
+
+/* The copy of the first length bytes of s in the pool (made if necessary) */
+char * string_intern_n(struct string_pool * pool, const char * s,
+                       size_t length)
+{
+  if(4*(pool->count + 1) > 3*pool->nslots)
+    string_pool_rehash(pool, pool->nslots ? 2*pool->nslots : 1024);
+  uint64_t hash = string_hash(s, length);
+  size_t k = string_pool_slot(pool, s, length, hash);
+  if(pool->slot[k]) return pool->slot[k];
+  struct string_header * e
+    = string_pool_alloc(pool, sizeof(struct string_header) + length + 1);
+  e->prefix = string_prefix_key(s, length);
+  e->hash = hash;
+  e->length = length;
+  char * copy = (char *) (e + 1);
+  memcpy(copy, s, length);
+  copy[length] = '\0';
+  pool->count++;
+  return pool->slot[k] = copy;
+}
+
+char * string_intern(struct string_pool * pool, const char * s)
+{return string_intern_n(pool, s, strlen(s));}
+
+/* The copy of s in the pool, or NULL if there is none */
+char * string_pool_find(const struct string_pool * pool, const char * s)
+{
+  if(!pool->nslots) return NULL;
+  size_t length = strlen(s);
+  return pool->slot[string_pool_slot(pool, s, length,
+                                     string_hash(s, length))];
+}
 
 # define list_init(list, size) \
   _Generic((list), \
             struct int_list *: int_list_alloc, \
+            struct int8_list *: int8_list_alloc, \
+            struct uint8_list *: uint8_list_alloc, \
+            struct int16_list *: int16_list_alloc, \
+            struct uint16_list *: uint16_list_alloc, \
+            struct uint32_list *: uint32_list_alloc, \
+            struct int64_list *: int64_list_alloc, \
+            struct uint64_list *: uint64_list_alloc, \
             struct float_list *: float_list_alloc, \
             struct double_list *: double_list_alloc, \
             struct char_list *: char_list_alloc, \
             struct string_list *: string_list_alloc, \
             struct obj_list *: obj_list_alloc, \
+            struct packed_list *: packed_list_alloc, \
             default: null_function)(list, size)
 
 void int_list_alloc(struct int_list * list, int n)
-{list->size = list->n = n; list->element = calloc(n, sizeof(int)); return;}
+{
+  list->size = list->n = n;
+  list->element = calloc(n, sizeof(int));
+  list->mode = list->at = 0;
+  list->storage.owner = LIST_OWNED;
+  return;
+}
 
 void float_list_alloc(struct float_list * list, int n)
-{list->size = list->n = n; list->element = calloc(n, sizeof(float)); return;}
+{
+  list->size = list->n = n;
+  list->element = calloc(n, sizeof(float));
+  list->mode = list->at = 0;
+  list->storage.owner = LIST_OWNED;
+  return;
+}
 
 void double_list_alloc(struct double_list * list, int n)
-{list->size = list->n = n; list->element = calloc(n, sizeof(double)); return;}
+{
+  list->size = list->n = n;
+  list->element = calloc(n, sizeof(double));
+  list->mode = list->at = 0;
+  list->storage.owner = LIST_OWNED;
+  return;
+}
 
 void char_list_alloc(struct char_list * list, int n)
-{list->size = list->n = n; list->element = calloc(n, sizeof(char)); return;}
+{
+  list->size = list->n = n;
+  list->element = calloc(n, sizeof(char));
+  list->mode = list->at = 0;
+  list->storage.owner = LIST_OWNED;
+  return;
+}
 
 void string_list_alloc(struct string_list * list, int n)
-{list->size = list->n = n; list->element = calloc(n, sizeof(char *)); return;}
+{
+  list->size = list->n = n;
+  list->element = calloc(n, sizeof(char *));
+  list->mode = list->at = 0;
+  list->storage.owner = LIST_OWNED;
+  list->pool = NULL;
+  return;
+}
 
-void obj_list_alloc(struct string_list * list, int n)
-{list->size = list->n = n; list->element = calloc(n, sizeof(void *)); return;}
+void obj_list_alloc(struct obj_list * list, int n)
+{
+  list->size = list->n = n;
+  list->element = calloc(n, sizeof(void *));
+  list->mode = list->at = 0;
+  list->storage.owner = LIST_OWNED;
+  return;
+}
 
 void null_function(void * x, ...) {return;}
 
 # define list_set(list, i, val) \
   _Generic((list), \
     struct int_list *: int_list_set, \
+    struct int8_list *: int8_list_set, \
+    struct uint8_list *: uint8_list_set, \
+    struct int16_list *: int16_list_set, \
+    struct uint16_list *: uint16_list_set, \
+    struct uint32_list *: uint32_list_set, \
+    struct int64_list *: int64_list_set, \
+    struct uint64_list *: uint64_list_set, \
     struct float_list *: float_list_set, \
     struct double_list *: double_list_set, \
     struct char_list *: char_list_set, \
@@ -53,43 +599,72 @@ void null_function(void * x, ...) {return;}
     default: null_function)(list, i, val)
 
 int int_list_set(struct int_list * list, int i, int val)
-{return list->element[i] = val;}
+{return list->element[list_index(list, i)] = val;}
 
 float float_list_set(struct float_list * list, int i, float val)
-{return list->element[i] = val;}
+{return list->element[list_index(list, i)] = val;}
 
 double double_list_set(struct double_list * list, int i, double val)
-{return list->element[i] = val;}
+{return list->element[list_index(list, i)] = val;}
 
 char char_list_set(struct char_list * list, int i, char val)
-{return list->element[i] = val;}
+{return list->element[list_index(list, i)] = val;}
 
 char * string_list_set(struct string_list * list, int i, char * val)
-{return list->element[i] = val;}
+{
+  if(list->pool) val = string_intern(list->pool, val);
+  return list->element[list_index(list, i)] = val;
+}
 
 void * obj_list_set(struct obj_list * list, int i, void * val)
-{return list->element[i] = val;}
+{return list->element[list_index(list, i)] = val;}
 
 # define list_read(list, i) \
   _Generic((list), \
             struct int_list *: int_read, \
+            struct int8_list *: int8_read, \
+            struct uint8_list *: uint8_read, \
+            struct int16_list *: int16_read, \
+            struct uint16_list *: uint16_read, \
+            struct uint32_list *: uint32_read, \
+            struct int64_list *: int64_read, \
+            struct uint64_list *: uint64_read, \
             struct float_list *: float_read, \
             struct double_list *: double_read, \
             struct char_list *: char_read, \
             struct string_list *: string_read, \
             struct obj_list *: obj_read, \
+            struct packed_list *: packed_read, \
             default: null_function)(list, i)
 
-int int_read(struct int_list * list, int i) {return list->element[i];}
-float float_read(struct float_list * list, int i) {return list->element[i];}
-double double_read(struct double_list * list, int i) {return list->element[i];}
-char char_read(struct char_list * list, int i) {return list->element[i];}
-char * string_read(struct string_list * list, int i) {return list->element[i];}
-void * obj_read(struct obj_list * list, int i) {return list->element[i];}
+int int_read(struct int_list * list, int i)
+{return list->element[list_index(list, i)];}
+
+float float_read(struct float_list * list, int i)
+{return list->element[list_index(list, i)];}
+
+double double_read(struct double_list * list, int i)
+{return list->element[list_index(list, i)];}
+
+char char_read(struct char_list * list, int i)
+{return list->element[list_index(list, i)];}
+
+char * string_read(struct string_list * list, int i)
+{return list->element[list_index(list, i)];}
+
+void * obj_read(struct obj_list * list, int i)
+{return list->element[list_index(list, i)];}
 
 # define list_pop(list, i) \
   _Generic((list), \
             struct int_list *: int_list_pop, \
+            struct int8_list *: int8_list_pop, \
+            struct uint8_list *: uint8_list_pop, \
+            struct int16_list *: int16_list_pop, \
+            struct uint16_list *: uint16_list_pop, \
+            struct uint32_list *: uint32_list_pop, \
+            struct int64_list *: int64_list_pop, \
+            struct uint64_list *: uint64_list_pop, \
             struct float_list *: float_list_pop, \
             struct double_list *: double_list_pop, \
             struct char_list *: char_list_pop, \
@@ -99,48 +674,54 @@ void * obj_read(struct obj_list * list, int i) {return list->element[i];}
 
 int int_list_pop(struct int_list * list, int i)
 {
-  int val = list->element[i];
-  for(int n = i; n < list->n - 1; ++n) list->element[n] = list->element[n + 1];
+  int val = list->element[list_index(list, i)];
+  list_close(list->element, list->size, &list->at, list->n, list->mode, i,
+             sizeof(int));
   (list->n)--;
   return val;
 }
 
 float float_list_pop(struct float_list * list, int i)
 {
-  float val = list->element[i];
-  for(int n = i; n < list->n - 1; ++n) list->element[n] = list->element[n + 1];
+  float val = list->element[list_index(list, i)];
+  list_close(list->element, list->size, &list->at, list->n, list->mode, i,
+             sizeof(float));
   (list->n)--;
   return val;
 }
 
 double double_list_pop(struct double_list * list, int i)
 {
-  double val = list->element[i];
-  for(int n = i; n < list->n - 1; ++n) list->element[n] = list->element[n + 1];
+  double val = list->element[list_index(list, i)];
+  list_close(list->element, list->size, &list->at, list->n, list->mode, i,
+             sizeof(double));
   (list->n)--;
   return val;
 }
 
 char char_list_pop(struct char_list * list, int i)
 {
-  char val = list->element[i];
-  for(int n = i; n < list->n - 1; ++n) list->element[n] = list->element[n + 1];
+  char val = list->element[list_index(list, i)];
+  list_close(list->element, list->size, &list->at, list->n, list->mode, i,
+             sizeof(char));
   (list->n)--;
   return val;
 }
 
 char * string_list_pop(struct string_list * list, int i)
 {
-  char * val = list->element[i];
-  for(int n = i; n < list->n - 1; ++n) list->element[n] = list->element[n + 1];
+  char * val = list->element[list_index(list, i)];
+  list_close(list->element, list->size, &list->at, list->n, list->mode, i,
+             sizeof(char *));
   (list->n)--;
   return val;
 }
 
 void * obj_list_pop(struct obj_list * list, int i)
 {
-  void * val = list->element[i];
-  for(int n = i; n < list->n - 1; ++n) list->element[n] = list->element[n + 1];
+  void * val = list->element[list_index(list, i)];
+  list_close(list->element, list->size, &list->at, list->n, list->mode, i,
+             sizeof(void *));
   (list->n)--;
   return val;
 }
@@ -148,6 +729,13 @@ void * obj_list_pop(struct obj_list * list, int i)
 # define list_push(list, i, val) \
   _Generic((list), \
             struct int_list *: int_list_push, \
+            struct int8_list *: int8_list_push, \
+            struct uint8_list *: uint8_list_push, \
+            struct int16_list *: int16_list_push, \
+            struct uint16_list *: uint16_list_push, \
+            struct uint32_list *: uint32_list_push, \
+            struct int64_list *: int64_list_push, \
+            struct uint64_list *: uint64_list_push, \
             struct float_list *: float_list_push, \
             struct double_list *: double_list_push, \
             struct char_list *: char_list_push, \
@@ -157,136 +745,2859 @@ void * obj_list_pop(struct obj_list * list, int i)
 
 int int_list_push(struct int_list * list, int i, int val)
 {
+  list->element = list_open(list->element, &list->storage, &list->size,
+                            &list->at, list->n, list->mode, i, sizeof(int));
   (list->n)++;
-  if(list->n > list->size) {
-    list->size = list->n;
-    list->element = realloc(list->element, list->n*sizeof(int));
-  }
-  for(int n = list->n - 1; n > i; --n) list->element[n] = list->element[n - 1];
-  list->element[i] = val;
+  list->element[list_index(list, i)] = val;
   return val;
 }
 
 float float_list_push(struct float_list * list, int i, float val)
 {
+  list->element = list_open(list->element, &list->storage, &list->size,
+                            &list->at, list->n, list->mode, i, sizeof(float));
   (list->n)++;
-  if(list->n > list->size) {
-    list->size = list->n;
-    list->element = realloc(list->element, list->n*sizeof(float));
-  }
-  for(int n = list->n - 1; n > i; --n) list->element[n] = list->element[n - 1];
-  list->element[i] = val;
+  list->element[list_index(list, i)] = val;
   return val;
 }
 
-float double_list_push(struct double_list * list, int i, double val)
+double double_list_push(struct double_list * list, int i, double val)
 {
+  list->element = list_open(list->element, &list->storage, &list->size,
+                            &list->at, list->n, list->mode, i, sizeof(double));
   (list->n)++;
-  if(list->n > list->size) {
-    list->size = list->n;
-    list->element = realloc(list->element, list->n*sizeof(double));
-  }
-  for(int n = list->n - 1; n > i; --n) list->element[n] = list->element[n - 1];
-  list->element[i] = val;
+  list->element[list_index(list, i)] = val;
   return val;
 }
 
-float char_list_push(struct char_list * list, int i, char val)
+char char_list_push(struct char_list * list, int i, char val)
 {
+  list->element = list_open(list->element, &list->storage, &list->size,
+                            &list->at, list->n, list->mode, i, sizeof(char));
   (list->n)++;
-  if(list->n > list->size) {
-    list->size = list->n;
-    list->element = realloc(list->element, list->n*sizeof(char));
-  }
-  for(int n = list->n - 1; n > i; --n) list->element[n] = list->element[n - 1];
-  list->element[i] = val;
+  list->element[list_index(list, i)] = val;
   return val;
 }
 
 char * string_list_push(struct string_list * list, int i, char * val)
 {
+  if(list->pool) val = string_intern(list->pool, val);
+  list->element = list_open(list->element, &list->storage, &list->size,
+                            &list->at, list->n, list->mode, i, sizeof(char *));
   (list->n)++;
-  if(list->n > list->size) {
-    list->size = list->n;
-    list->element = realloc(list->element, list->n*sizeof(char *));
-  }
-  for(int n = list->n - 1; n > i; --n) list->element[n] = list->element[n - 1];
-  list->element[i] = val;
+  list->element[list_index(list, i)] = val;
   return val;
 }
 
 void * obj_list_push(struct obj_list * list, int i, void * val)
 {
+  list->element = list_open(list->element, &list->storage, &list->size,
+                            &list->at, list->n, list->mode, i, sizeof(void *));
   (list->n)++;
-  if(list->n > list->size) {
-    list->size = list->n;
-    list->element = realloc(list->element, list->n*sizeof(void *));
-  }
-  for(int n = list->n - 1; n > i; --n) list->element[n] = list->element[n - 1];
-  list->element[i] = val;
+  list->element[list_index(list, i)] = val;
   return val;
 }
 
-# define list_sort(list) \
+# define list_append(list, val) \
   _Generic((list), \
-            struct int_list *: int_list_sort, \
-            struct float_list *: float_list_sort, \
-            struct double_list *: double_list_sort, \
-            struct char_list *: char_list_sort, \
-            struct string_list *: string_list_sort, \
+            struct int_list *: int_list_append, \
+            struct int8_list *: int8_list_append, \
+            struct uint8_list *: uint8_list_append, \
+            struct int16_list *: int16_list_append, \
+            struct uint16_list *: uint16_list_append, \
+            struct uint32_list *: uint32_list_append, \
+            struct int64_list *: int64_list_append, \
+            struct uint64_list *: uint64_list_append, \
+            struct float_list *: float_list_append, \
+            struct double_list *: double_list_append, \
+            struct char_list *: char_list_append, \
+            struct string_list *: string_list_append, \
+            struct obj_list *: obj_list_append, \
+            struct packed_list *: packed_list_append, \
+            default: null_function)(list, val)
+
+# define list_reserve(list, n) \
+  _Generic((list), \
+            struct int_list *: int_list_reserve, \
+            struct int8_list *: int8_list_reserve, \
+            struct uint8_list *: uint8_list_reserve, \
+            struct int16_list *: int16_list_reserve, \
+            struct uint16_list *: uint16_list_reserve, \
+            struct uint32_list *: uint32_list_reserve, \
+            struct int64_list *: int64_list_reserve, \
+            struct uint64_list *: uint64_list_reserve, \
+            struct float_list *: float_list_reserve, \
+            struct double_list *: double_list_reserve, \
+            struct char_list *: char_list_reserve, \
+            struct string_list *: string_list_reserve, \
+            struct obj_list *: obj_list_reserve, \
+            default: null_function)(list, n)
+
+# define list_shrink(list) \
+  _Generic((list), \
+            struct int_list *: int_list_shrink, \
+            struct int8_list *: int8_list_shrink, \
+            struct uint8_list *: uint8_list_shrink, \
+            struct int16_list *: int16_list_shrink, \
+            struct uint16_list *: uint16_list_shrink, \
+            struct uint32_list *: uint32_list_shrink, \
+            struct int64_list *: int64_list_shrink, \
+            struct uint64_list *: uint64_list_shrink, \
+            struct float_list *: float_list_shrink, \
+            struct double_list *: double_list_shrink, \
+            struct char_list *: char_list_shrink, \
+            struct string_list *: string_list_shrink, \
+            struct obj_list *: obj_list_shrink, \
             default: null_function)(list)
 
+int int_list_append(struct int_list * list, int val)
+{
+  if(list->mode) return int_list_push(list, list->n, val);
+  if(list->n == list->size)
+    list->element = list_grow(list->element, &list->storage, &list->size,
+                              list->n + 1, sizeof(int));
+  return list->element[(list->n)++] = val;
+}
+
+float float_list_append(struct float_list * list, float val)
+{
+  if(list->mode) return float_list_push(list, list->n, val);
+  if(list->n == list->size)
+    list->element = list_grow(list->element, &list->storage, &list->size,
+                              list->n + 1, sizeof(float));
+  return list->element[(list->n)++] = val;
+}
+
+double double_list_append(struct double_list * list, double val)
+{
+  if(list->mode) return double_list_push(list, list->n, val);
+  if(list->n == list->size)
+    list->element = list_grow(list->element, &list->storage, &list->size,
+                              list->n + 1, sizeof(double));
+  return list->element[(list->n)++] = val;
+}
+
+char char_list_append(struct char_list * list, char val)
+{
+  if(list->mode) return char_list_push(list, list->n, val);
+  if(list->n == list->size)
+    list->element = list_grow(list->element, &list->storage, &list->size,
+                              list->n + 1, sizeof(char));
+  return list->element[(list->n)++] = val;
+}
+
+char * string_list_append(struct string_list * list, char * val)
+{
+  if(list->mode) return string_list_push(list, list->n, val);
+  if(list->pool) val = string_intern(list->pool, val);
+  if(list->n == list->size)
+    list->element = list_grow(list->element, &list->storage, &list->size,
+                              list->n + 1, sizeof(char *));
+  return list->element[(list->n)++] = val;
+}
+
+void * obj_list_append(struct obj_list * list, void * val)
+{
+  if(list->mode) return obj_list_push(list, list->n, val);
+  if(list->n == list->size)
+    list->element = list_grow(list->element, &list->storage, &list->size,
+                              list->n + 1, sizeof(void *));
+  return list->element[(list->n)++] = val;
+}
+
+void int_list_reserve(struct int_list * list, int n)
+{
+  if(n > list->size)
+    list->element = list_expand(list->element, &list->storage, &list->size,
+                                &list->at, list->n, list->mode, n, sizeof(int));
+  return;
+}
+
+void float_list_reserve(struct float_list * list, int n)
+{
+  if(n > list->size)
+    list->element = list_expand(list->element, &list->storage, &list->size,
+                                &list->at, list->n, list->mode, n,
+                                sizeof(float));
+  return;
+}
+
+void double_list_reserve(struct double_list * list, int n)
+{
+  if(n > list->size)
+    list->element = list_expand(list->element, &list->storage, &list->size,
+                                &list->at, list->n, list->mode, n,
+                                sizeof(double));
+  return;
+}
+
+void char_list_reserve(struct char_list * list, int n)
+{
+  if(n > list->size)
+    list->element = list_expand(list->element, &list->storage, &list->size,
+                                &list->at, list->n, list->mode, n,
+                                sizeof(char));
+  return;
+}
+
+void string_list_reserve(struct string_list * list, int n)
+{
+  if(n > list->size)
+    list->element = list_expand(list->element, &list->storage, &list->size,
+                                &list->at, list->n, list->mode, n,
+                                sizeof(char *));
+  return;
+}
+
+void obj_list_reserve(struct obj_list * list, int n)
+{
+  if(n > list->size)
+    list->element = list_expand(list->element, &list->storage, &list->size,
+                                &list->at, list->n, list->mode, n,
+                                sizeof(void *));
+  return;
+}
+
+void int_list_shrink(struct int_list * list)
+{
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode,
+                 sizeof(int));
+  list->element = list_fit(list->element, &list->storage, &list->size, list->n,
+                           sizeof(int));
+  return;
+}
+
+void float_list_shrink(struct float_list * list)
+{
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode,
+                 sizeof(float));
+  list->element = list_fit(list->element, &list->storage, &list->size, list->n,
+                           sizeof(float));
+  return;
+}
+
+void double_list_shrink(struct double_list * list)
+{
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode,
+                 sizeof(double));
+  list->element = list_fit(list->element, &list->storage, &list->size, list->n,
+                           sizeof(double));
+  return;
+}
+
+void char_list_shrink(struct char_list * list)
+{
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode,
+                 sizeof(char));
+  list->element = list_fit(list->element, &list->storage, &list->size, list->n,
+                           sizeof(char));
+  return;
+}
+
+void string_list_shrink(struct string_list * list)
+{
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode,
+                 sizeof(char *));
+  list->element = list_fit(list->element, &list->storage, &list->size, list->n,
+                           sizeof(char *));
+  return;
+}
+
+void obj_list_shrink(struct obj_list * list)
+{
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode,
+                 sizeof(void *));
+  list->element = list_fit(list->element, &list->storage, &list->size, list->n,
+                           sizeof(void *));
+  return;
+}
+
+# define list_mode(list, mode) \
+  _Generic((list), \
+            struct int_list *: int_list_mode, \
+            struct int8_list *: int8_list_mode, \
+            struct uint8_list *: uint8_list_mode, \
+            struct int16_list *: int16_list_mode, \
+            struct uint16_list *: uint16_list_mode, \
+            struct uint32_list *: uint32_list_mode, \
+            struct int64_list *: int64_list_mode, \
+            struct uint64_list *: uint64_list_mode, \
+            struct float_list *: float_list_mode, \
+            struct double_list *: double_list_mode, \
+            struct char_list *: char_list_mode, \
+            struct string_list *: string_list_mode, \
+            struct obj_list *: obj_list_mode, \
+            default: null_function)(list, mode)
+
+void int_list_mode(struct int_list * list, enum list_mode mode)
+{
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode,
+                 sizeof(int));
+  list->mode = mode;
+  list->at = mode == LIST_GAP ? list->n : 0;
+  return;
+}
+
+void float_list_mode(struct float_list * list, enum list_mode mode)
+{
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode,
+                 sizeof(float));
+  list->mode = mode;
+  list->at = mode == LIST_GAP ? list->n : 0;
+  return;
+}
+
+void double_list_mode(struct double_list * list, enum list_mode mode)
+{
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode,
+                 sizeof(double));
+  list->mode = mode;
+  list->at = mode == LIST_GAP ? list->n : 0;
+  return;
+}
+
+void char_list_mode(struct char_list * list, enum list_mode mode)
+{
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode,
+                 sizeof(char));
+  list->mode = mode;
+  list->at = mode == LIST_GAP ? list->n : 0;
+  return;
+}
+
+void string_list_mode(struct string_list * list, enum list_mode mode)
+{
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode,
+                 sizeof(char *));
+  list->mode = mode;
+  list->at = mode == LIST_GAP ? list->n : 0;
+  return;
+}
+
+void obj_list_mode(struct obj_list * list, enum list_mode mode)
+{
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode,
+                 sizeof(void *));
+  list->mode = mode;
+  list->at = mode == LIST_GAP ? list->n : 0;
+  return;
+}
+
 int int_compare(const void * a, const void * b)
-{return * (int *) a - * (int *) b;}
+{
+  int x = * (const int *) a, y = * (const int *) b;
+  return (x > y) - (x < y);
+}
 
-void int_list_sort(struct int_list * list)
-{qsort(list->element, list->n, sizeof(int), int_compare); return;}
+uint32_t float_key(float x)
+{
+  uint32_t u;
+  memcpy(&u, &x, sizeof(u));
+  return u ^ (-(u >> 31) | 0x80000000u);
+}
 
 int float_compare(const void * a, const void * b)
-{return * (float *) a - * (float *) b;}
+{
+  uint32_t x = float_key(* (const float *) a);
+  uint32_t y = float_key(* (const float *) b);
+  return (x > y) - (x < y);
+}
 
-void float_list_sort(struct float_list * list)
-{qsort(list->element, list->n, sizeof(float), float_compare); return;}
+uint64_t double_key(double x)
+{
+  uint64_t u;
+  memcpy(&u, &x, sizeof(u));
+  return u ^ (-(u >> 63) | 0x8000000000000000u);
+}
 
 int double_compare(const void * a, const void * b)
-{return * (double *) a - * (double *) b;}
-
-void double_list_sort(struct double_list * list)
-{qsort(list->element, list->n, sizeof(double), double_compare); return;}
+{
+  uint64_t x = double_key(* (const double *) a);
+  uint64_t y = double_key(* (const double *) b);
+  return (x > y) - (x < y);
+}
 
 int char_compare(const void * a, const void * b)
 {return * (char *) a - * (char *) b;}
 
-void char_list_sort(struct char_list * list)
-{qsort(list->element, list->n, sizeof(char), char_compare); return;}
-
 int string_compare(const void * a, const void * b)
 {return strcmp(*(const char **) a, *(const char **) b);}
 
-void string_list_sort(struct string_list * list)
-{qsort(list->element, list->n, sizeof(char *), string_compare); return;}
-
 int __attribute__((weak)) obj_compare(const void * a, const void * b)
-{return a - b;}
+{
+  uintptr_t x = (uintptr_t) * (void * const *) a;
+  uintptr_t y = (uintptr_t) * (void * const *) b;
+  return (x > y) - (x < y);
+}
 
-void obj_list_sort(struct int_list * list)
-{qsort(list->element, list->n, sizeof(int), obj_compare); return;}
+# ifndef LIST_SORT_PARALLEL_MIN
+# define LIST_SORT_PARALLEL_MIN 100000 /* Minimum elements per thread */
+# endif
+# define LIST_SORT_MAX_THREADS 64
+# define LIST_RADIX_MIN 256 /* Smaller lists go to qsort */
 
-# define list_free(list) \
-  _Generic((list), \
-            struct int_list *: int_free, \
-            struct float_list *: float_free, \
-            struct double_list *: double_free, \
-            struct char_list *: char_free, \
-            struct string_list *: string_free, \
-            struct obj_list *: obj_free, \
-            default: null_function)(list)
+int list_sort_threads = 0; /* Threads for sorting (0: one per processor) */
+
+enum radix_kind {RADIX_INT, RADIX_FLOAT, RADIX_UINT};
+enum radix_phase {RADIX_ENCODE, RADIX_COUNT, RADIX_SCATTER, RADIX_DECODE};
+
+struct radix_job {
+  enum radix_phase phase;
+  int width; /* Bytes per element (4 or 8) */
+  enum radix_kind kind;
+  void * src, * dst;
+  size_t begin, end; /* Chunk of the array */
+  int pass; /* Byte we are sorting by */
+  size_t count[8][256]; /* Number of keys with each value of each byte */
+  size_t offset[256]; /* Where the next key with each byte value goes */
+};
+
+uint32_t radix_encode32(uint32_t u, enum radix_kind kind)
+{
+  if(kind == RADIX_UINT) return u;
+  return kind == RADIX_INT ? u ^ 0x80000000u : u ^ (-(u >> 31) | 0x80000000u);
+}
+
+uint32_t radix_decode32(uint32_t k, enum radix_kind kind)
+{
+  if(kind == RADIX_UINT) return k;
+  return kind == RADIX_INT ? k ^ 0x80000000u
+                           : k ^ (((k >> 31) - 1) | 0x80000000u);
+}
+
+uint64_t radix_encode64(uint64_t u, enum radix_kind kind)
+{
+  const uint64_t top = 0x8000000000000000u;
+  if(kind == RADIX_UINT) return u;
+  return kind == RADIX_INT ? u ^ top : u ^ (-(u >> 63) | top);
+}
 
-void int_free(struct int_list * list) {free(list->element); return;}
-void float_free(struct float_list * list) {free(list->element); return;}
-void double_free(struct double_list * list) {free(list->element); return;}
-void char_free(struct char_list * list) {free(list->element); return;}
-void string_free(struct string_list * list) {free(list->element); return;}
+uint64_t radix_decode64(uint64_t k, enum radix_kind kind)
+{
+  const uint64_t top = 0x8000000000000000u;
+  if(kind == RADIX_UINT) return k;
+  return kind == RADIX_INT ? k ^ top : k ^ (((k >> 63) - 1) | top);
+}
+
+/* Work of one thread on its chunk in one phase of the sort */
+void * radix_work(void * _job)
+{
+  struct radix_job * job = _job;
+  const int shift = 8*job->pass;
+  if(job->width == 4) {
+    uint32_t * src = job->src, * dst = job->dst;
+    switch(job->phase) {
+      case RADIX_ENCODE:
+        memset(job->count, 0, sizeof(job->count));
+        for(size_t i = job->begin; i < job->end; ++i) {
+          uint32_t k = src[i] = radix_encode32(src[i], job->kind);
+          for(int b = 0; b < 4; ++b) job->count[b][(k >> 8*b) & 255]++;
+        }
+        break;
+      case RADIX_COUNT:
+        memset(job->count[job->pass], 0, sizeof(job->count[0]));
+        for(size_t i = job->begin; i < job->end; ++i)
+          job->count[job->pass][(src[i] >> shift) & 255]++;
+        break;
+      case RADIX_SCATTER:
+        for(size_t i = job->begin; i < job->end; ++i)
+          dst[job->offset[(src[i] >> shift) & 255]++] = src[i];
+        break;
+      case RADIX_DECODE:
+        for(size_t i = job->begin; i < job->end; ++i)
+          dst[i] = radix_decode32(src[i], job->kind);
+        break;
+    }
+  } else {
+    uint64_t * src = job->src, * dst = job->dst;
+    switch(job->phase) {
+      case RADIX_ENCODE:
+        memset(job->count, 0, sizeof(job->count));
+        for(size_t i = job->begin; i < job->end; ++i) {
+          uint64_t k = src[i] = radix_encode64(src[i], job->kind);
+          for(int b = 0; b < 8; ++b) job->count[b][(k >> 8*b) & 255]++;
+        }
+        break;
+      case RADIX_COUNT:
+        memset(job->count[job->pass], 0, sizeof(job->count[0]));
+        for(size_t i = job->begin; i < job->end; ++i)
+          job->count[job->pass][(src[i] >> shift) & 255]++;
+        break;
+      case RADIX_SCATTER:
+        for(size_t i = job->begin; i < job->end; ++i)
+          dst[job->offset[(src[i] >> shift) & 255]++] = src[i];
+        break;
+      case RADIX_DECODE:
+        for(size_t i = job->begin; i < job->end; ++i)
+          dst[i] = radix_decode64(src[i], job->kind);
+        break;
+    }
+  }
+  return NULL;
+}
+
+/* Run a phase of the sort in nthreads threads (the current one included) */
+void radix_run(struct radix_job * job, int nthreads, enum radix_phase phase)
+{
+  pthread_t thread[LIST_SORT_MAX_THREADS];
+  for(int t = 0; t < nthreads; ++t) job[t].phase = phase;
+  for(int t = 1; t < nthreads; ++t)
+    if(pthread_create(&thread[t], NULL, radix_work, &job[t])) {
+      radix_work(&job[t]); /* Could not start a thread: do it ourselves */
+      thread[t] = pthread_self();
+    }
+  radix_work(&job[0]);
+  for(int t = 1; t < nthreads; ++t)
+    if(!pthread_equal(thread[t], pthread_self())) pthread_join(thread[t], NULL);
+  return;
+}
+
+/* Number of threads for sorting n elements */
+int list_sort_nthreads(size_t n)
+{
+  long nthreads = list_sort_threads;
+  if(nthreads <= 0) nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+  if(nthreads > (long) (n/LIST_SORT_PARALLEL_MIN))
+    nthreads = n/LIST_SORT_PARALLEL_MIN;
+  if(nthreads > LIST_SORT_MAX_THREADS) nthreads = LIST_SORT_MAX_THREADS;
+  return nthreads < 1 ? 1 : nthreads;
+}
+
+/* Sort n numbers of the given width (4 or 8 bytes) and kind */
+void radix_sort(void * a, size_t n, int width, enum radix_kind kind)
+{
+  int nthreads = list_sort_nthreads(n);
+  void * tmp = malloc(n*width);
+  struct radix_job * job = malloc(nthreads*sizeof(struct radix_job));
+  if(!tmp || !job) {
+    fprintf(stderr, "Error: list_sort: unable to allocate memory.\n");
+    exit(-1);
+  }
+  for(int t = 0; t < nthreads; ++t) {
+    job[t].width = width;
+    job[t].kind = kind;
+    job[t].src = a;
+    job[t].dst = tmp;
+    job[t].begin = n*t/nthreads;
+    job[t].end = n*(t + 1)/nthreads;
+    job[t].pass = 0;
+  }
+  radix_run(job, nthreads, RADIX_ENCODE);
+
+  int moved = 0; /* Has any pass moved the keys yet? */
+  for(int pass = 0; pass < width; ++pass) {
+    int same = 0; /* Do all keys have the same byte? */
+    for(int v = 0; v < 256 && !same; ++v) {
+      size_t total = 0;
+      for(int t = 0; t < nthreads; ++t) total += job[t].count[pass][v];
+      same = total == n;
+    }
+    if(same) continue;
+    for(int t = 0; t < nthreads; ++t) job[t].pass = pass;
+    if(moved) radix_run(job, nthreads, RADIX_COUNT);
+    size_t offset = 0;
+    for(int v = 0; v < 256; ++v)
+      for(int t = 0; t < nthreads; ++t) {
+        job[t].offset[v] = offset;
+        offset += job[t].count[pass][v];
+      }
+    radix_run(job, nthreads, RADIX_SCATTER);
+    for(int t = 0; t < nthreads; ++t) {
+      void * src = job[t].src;
+      job[t].src = job[t].dst;
+      job[t].dst = src;
+    }
+    moved = 1;
+  }
+
+  /* Decode the keys into a */
+  for(int t = 0; t < nthreads; ++t) job[t].dst = a;
+  radix_run(job, nthreads, RADIX_DECODE);
+  free(job);
+  free(tmp);
+  return;
+}
+
+void string_list_use_pool(struct string_list * list)
+{
+  if(list->pool) return;
+  list->pool = string_pool_new();
+  for(int i = 0; i < list->n; ++i) {
+    const int k = list_index(list, i);
+    list->element[k] = string_intern(list->pool, list->element[k]);
+  }
+  return;
+}
+
+int string_list_read_lines(struct string_list * list, FILE * fp)
+{
+  string_list_use_pool(list);
+  char * line = NULL;
+  size_t capacity = 0;
+  ssize_t length;
+  int count = 0;
+  while((length = getline(&line, &capacity, fp)) != -1) {
+    if(length > 0 && line[length - 1] == '\n') line[length - 1] = '\0';
+    string_list_append(list, line);
+    count++;
+  }
+  free(line);
+  return count;
+}
+
+/* Sort key of a string from a pool */
+struct string_sort_key {
+  uint64_t prefix;
+  char * s;
+};
+
+int string_key_compare(const void * _a, const void * _b)
+{
+  const struct string_sort_key * a = _a, * b = _b;
+  if(a->prefix != b->prefix) return a->prefix < b->prefix ? -1 : 1;
+  if(a->s == b->s) return 0;
+  return strcmp(a->s + 8, b->s + 8); /* Both at least 8 bytes long */
+}
+
+void string_list_sort_pooled(struct string_list * list)
+{
+  struct string_sort_key * key = malloc(list->n*sizeof(struct string_sort_key)
+                                        + 1);
+  for(int i = 0; i < list->n; ++i) {
+    key[i].s = list->element[i];
+    key[i].prefix = string_header(key[i].s)->prefix;
+  }
+  qsort(key, list->n, sizeof(struct string_sort_key), string_key_compare);
+  for(int i = 0; i < list->n; ++i) list->element[i] = key[i].s;
+  free(key);
+  return;
+}
+
+# define list_sort(list) \
+  _Generic((list), \
+            struct int_list *: int_list_sort, \
+            struct int8_list *: int8_list_sort, \
+            struct uint8_list *: uint8_list_sort, \
+            struct int16_list *: int16_list_sort, \
+            struct uint16_list *: uint16_list_sort, \
+            struct uint32_list *: uint32_list_sort, \
+            struct int64_list *: int64_list_sort, \
+            struct uint64_list *: uint64_list_sort, \
+            struct float_list *: float_list_sort, \
+            struct double_list *: double_list_sort, \
+            struct char_list *: char_list_sort, \
+            struct string_list *: string_list_sort, \
+            struct obj_list *: obj_list_sort, \
+            default: null_function)(list)
+
+void int_list_sort(struct int_list * list)
+{
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode,
+                 sizeof(int));
+  if(list->n < LIST_RADIX_MIN)
+    qsort(list->element, list->n, sizeof(int), int_compare);
+  else radix_sort(list->element, list->n, sizeof(int), RADIX_INT);
+  return;
+}
+
+void float_list_sort(struct float_list * list)
+{
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode,
+                 sizeof(float));
+  if(list->n < LIST_RADIX_MIN)
+    qsort(list->element, list->n, sizeof(float), float_compare);
+  else radix_sort(list->element, list->n, sizeof(float), RADIX_FLOAT);
+  return;
+}
+
+void double_list_sort(struct double_list * list)
+{
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode,
+                 sizeof(double));
+  if(list->n < LIST_RADIX_MIN)
+    qsort(list->element, list->n, sizeof(double), double_compare);
+  else radix_sort(list->element, list->n, sizeof(double), RADIX_FLOAT);
+  return;
+}
+
+void char_list_sort(struct char_list * list)
+{
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode,
+                 sizeof(char));
+  qsort(list->element, list->n, sizeof(char), char_compare);
+  return;
+}
+
+void string_list_sort(struct string_list * list)
+{
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode,
+                 sizeof(char *));
+  if(list->pool) string_list_sort_pooled(list);
+  else qsort(list->element, list->n, sizeof(char *), string_compare);
+  return;
+}
+
+void obj_list_sort(struct obj_list * list)
+{
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode,
+                 sizeof(void *));
+  qsort(list->element, list->n, sizeof(void *), obj_compare);
+  return;
+}
+
+# define LIST_LANES 8
+
+# define list_runs(list, start, count) \
+  list_run_bounds((list)->mode, (list)->at, (list)->n, (list)->size, start, \
+                  count)
+
+/* Positions and lengths of the runs of elements in the array of a list */
+void list_run_bounds(int mode, int at, int n, int size, int start[2],
+                     int count[2])
+{
+  start[0] = start[1] = count[1] = 0;
+  count[0] = n;
+  if(mode == LIST_DEQUE) {
+    start[0] = at;
+    count[0] = at + n <= size ? n : size - at;
+    count[1] = n - count[0];
+  } else if(mode == LIST_GAP) {
+    count[0] = at;
+    start[1] = at + size - n;
+    count[1] = n - at;
+  }
+  return;
+}
+
+# define list_sum(list) \
+  _Generic((list), \
+            struct int_list *: int_list_sum, \
+            struct int8_list *: int8_list_sum, \
+            struct uint8_list *: uint8_list_sum, \
+            struct int16_list *: int16_list_sum, \
+            struct uint16_list *: uint16_list_sum, \
+            struct uint32_list *: uint32_list_sum, \
+            struct int64_list *: int64_list_sum, \
+            struct uint64_list *: uint64_list_sum, \
+            struct float_list *: float_list_sum, \
+            struct double_list *: double_list_sum, \
+            struct char_list *: char_list_sum, \
+            struct packed_list *: packed_list_sum, \
+            default: null_function)(list)
+
+# define list_min(list) \
+  _Generic((list), \
+            struct int_list *: int_list_min, \
+            struct int8_list *: int8_list_min, \
+            struct uint8_list *: uint8_list_min, \
+            struct int16_list *: int16_list_min, \
+            struct uint16_list *: uint16_list_min, \
+            struct uint32_list *: uint32_list_min, \
+            struct int64_list *: int64_list_min, \
+            struct uint64_list *: uint64_list_min, \
+            struct float_list *: float_list_min, \
+            struct double_list *: double_list_min, \
+            struct char_list *: char_list_min, \
+            default: null_function)(list)
+
+# define list_max(list) \
+  _Generic((list), \
+            struct int_list *: int_list_max, \
+            struct int8_list *: int8_list_max, \
+            struct uint8_list *: uint8_list_max, \
+            struct int16_list *: int16_list_max, \
+            struct uint16_list *: uint16_list_max, \
+            struct uint32_list *: uint32_list_max, \
+            struct int64_list *: int64_list_max, \
+            struct uint64_list *: uint64_list_max, \
+            struct float_list *: float_list_max, \
+            struct double_list *: double_list_max, \
+            struct char_list *: char_list_max, \
+            default: null_function)(list)
+
+# define list_minmax(list, lo, hi) \
+  _Generic((list), \
+            struct int_list *: int_list_minmax, \
+            struct int8_list *: int8_list_minmax, \
+            struct uint8_list *: uint8_list_minmax, \
+            struct int16_list *: int16_list_minmax, \
+            struct uint16_list *: uint16_list_minmax, \
+            struct uint32_list *: uint32_list_minmax, \
+            struct int64_list *: int64_list_minmax, \
+            struct uint64_list *: uint64_list_minmax, \
+            struct float_list *: float_list_minmax, \
+            struct double_list *: double_list_minmax, \
+            struct char_list *: char_list_minmax, \
+            default: null_function)(list, lo, hi)
+
+# define list_find(list, val) \
+  _Generic((list), \
+            struct int_list *: int_list_find, \
+            struct int8_list *: int8_list_find, \
+            struct uint8_list *: uint8_list_find, \
+            struct int16_list *: int16_list_find, \
+            struct uint16_list *: uint16_list_find, \
+            struct uint32_list *: uint32_list_find, \
+            struct int64_list *: int64_list_find, \
+            struct uint64_list *: uint64_list_find, \
+            struct float_list *: float_list_find, \
+            struct double_list *: double_list_find, \
+            struct char_list *: char_list_find, \
+            struct string_list *: string_list_find, \
+            struct obj_list *: obj_list_find, \
+            default: null_function)(list, val)
+
+# define list_count(list, val) \
+  _Generic((list), \
+            struct int_list *: int_list_count, \
+            struct int8_list *: int8_list_count, \
+            struct uint8_list *: uint8_list_count, \
+            struct int16_list *: int16_list_count, \
+            struct uint16_list *: uint16_list_count, \
+            struct uint32_list *: uint32_list_count, \
+            struct int64_list *: int64_list_count, \
+            struct uint64_list *: uint64_list_count, \
+            struct float_list *: float_list_count, \
+            struct double_list *: double_list_count, \
+            struct char_list *: char_list_count, \
+            struct string_list *: string_list_count, \
+            struct obj_list *: obj_list_count, \
+            default: null_function)(list, val)
+
+/* Array kernels */
+
+long int_array_sum(const int * a, int n)
+{
+  long s[LIST_LANES] = {0}, sum = 0;
+  int i = 0;
+  for(; i + LIST_LANES <= n; i += LIST_LANES)
+    for(int l = 0; l < LIST_LANES; ++l) s[l] += a[i + l];
+  for(; i < n; ++i) sum += a[i];
+  for(int l = 0; l < LIST_LANES; ++l) sum += s[l];
+  return sum;
+}
+
+double float_array_sum(const float * a, int n)
+{
+  double s[LIST_LANES] = {0}, sum = 0;
+  int i = 0;
+  for(; i + LIST_LANES <= n; i += LIST_LANES)
+    for(int l = 0; l < LIST_LANES; ++l) s[l] += a[i + l];
+  for(; i < n; ++i) sum += a[i];
+  for(int l = 0; l < LIST_LANES; ++l) sum += s[l];
+  return sum;
+}
+
+double double_array_sum(const double * a, int n)
+{
+  double s[LIST_LANES] = {0}, sum = 0;
+  int i = 0;
+  for(; i + LIST_LANES <= n; i += LIST_LANES)
+    for(int l = 0; l < LIST_LANES; ++l) s[l] += a[i + l];
+  for(; i < n; ++i) sum += a[i];
+  for(int l = 0; l < LIST_LANES; ++l) sum += s[l];
+  return sum;
+}
+
+long char_array_sum(const char * a, int n)
+{
+  long s[LIST_LANES] = {0}, sum = 0;
+  int i = 0;
+  for(; i + LIST_LANES <= n; i += LIST_LANES)
+    for(int l = 0; l < LIST_LANES; ++l) s[l] += a[i + l];
+  for(; i < n; ++i) sum += a[i];
+  for(int l = 0; l < LIST_LANES; ++l) sum += s[l];
+  return sum;
+}
+
+/* Lower *lo and raise *hi to the smallest and largest of a[0..n) */
+void int_array_minmax(const int * a, int n, int * lo, int * hi)
+{
+  int l_lo[LIST_LANES], l_hi[LIST_LANES], i = 0;
+  for(int l = 0; l < LIST_LANES; ++l) l_lo[l] = *lo, l_hi[l] = *hi;
+  for(; i + LIST_LANES <= n; i += LIST_LANES)
+    for(int l = 0; l < LIST_LANES; ++l) {
+      l_lo[l] = a[i + l] < l_lo[l] ? a[i + l] : l_lo[l];
+      l_hi[l] = a[i + l] > l_hi[l] ? a[i + l] : l_hi[l];
+    }
+  for(; i < n; ++i) {
+    if(a[i] < *lo) *lo = a[i];
+    if(a[i] > *hi) *hi = a[i];
+  }
+  for(int l = 0; l < LIST_LANES; ++l) {
+    if(l_lo[l] < *lo) *lo = l_lo[l];
+    if(l_hi[l] > *hi) *hi = l_hi[l];
+  }
+  return;
+}
+
+void float_array_minmax(const float * a, int n, float * lo, float * hi)
+{
+  float l_lo[LIST_LANES], l_hi[LIST_LANES];
+  int i = 0;
+  for(int l = 0; l < LIST_LANES; ++l) l_lo[l] = *lo, l_hi[l] = *hi;
+  for(; i + LIST_LANES <= n; i += LIST_LANES)
+    for(int l = 0; l < LIST_LANES; ++l) {
+      l_lo[l] = a[i + l] < l_lo[l] ? a[i + l] : l_lo[l];
+      l_hi[l] = a[i + l] > l_hi[l] ? a[i + l] : l_hi[l];
+    }
+  for(; i < n; ++i) {
+    if(a[i] < *lo) *lo = a[i];
+    if(a[i] > *hi) *hi = a[i];
+  }
+  for(int l = 0; l < LIST_LANES; ++l) {
+    if(l_lo[l] < *lo) *lo = l_lo[l];
+    if(l_hi[l] > *hi) *hi = l_hi[l];
+  }
+  return;
+}
+
+void double_array_minmax(const double * a, int n, double * lo, double * hi)
+{
+  double l_lo[LIST_LANES], l_hi[LIST_LANES];
+  int i = 0;
+  for(int l = 0; l < LIST_LANES; ++l) l_lo[l] = *lo, l_hi[l] = *hi;
+  for(; i + LIST_LANES <= n; i += LIST_LANES)
+    for(int l = 0; l < LIST_LANES; ++l) {
+      l_lo[l] = a[i + l] < l_lo[l] ? a[i + l] : l_lo[l];
+      l_hi[l] = a[i + l] > l_hi[l] ? a[i + l] : l_hi[l];
+    }
+  for(; i < n; ++i) {
+    if(a[i] < *lo) *lo = a[i];
+    if(a[i] > *hi) *hi = a[i];
+  }
+  for(int l = 0; l < LIST_LANES; ++l) {
+    if(l_lo[l] < *lo) *lo = l_lo[l];
+    if(l_hi[l] > *hi) *hi = l_hi[l];
+  }
+  return;
+}
+
+void char_array_minmax(const char * a, int n, char * lo, char * hi)
+{
+  char l_lo[LIST_LANES], l_hi[LIST_LANES];
+  int i = 0;
+  for(int l = 0; l < LIST_LANES; ++l) l_lo[l] = *lo, l_hi[l] = *hi;
+  for(; i + LIST_LANES <= n; i += LIST_LANES)
+    for(int l = 0; l < LIST_LANES; ++l) {
+      l_lo[l] = a[i + l] < l_lo[l] ? a[i + l] : l_lo[l];
+      l_hi[l] = a[i + l] > l_hi[l] ? a[i + l] : l_hi[l];
+    }
+  for(; i < n; ++i) {
+    if(a[i] < *lo) *lo = a[i];
+    if(a[i] > *hi) *hi = a[i];
+  }
+  for(int l = 0; l < LIST_LANES; ++l) {
+    if(l_lo[l] < *lo) *lo = l_lo[l];
+    if(l_hi[l] > *hi) *hi = l_hi[l];
+  }
+  return;
+}
+
+/* Index of the first element of a[0..n) equal to val, or -1 */
+int int_array_find(const int * a, int n, int val)
+{
+  int i = 0;
+  for(; i + LIST_LANES <= n; i += LIST_LANES) {
+    int hit = 0;
+    for(int l = 0; l < LIST_LANES; ++l) hit |= a[i + l] == val;
+    if(hit) break;
+  }
+  for(; i < n; ++i) if(a[i] == val) return i;
+  return -1;
+}
+
+int float_array_find(const float * a, int n, float val)
+{
+  int i = 0;
+  for(; i + LIST_LANES <= n; i += LIST_LANES) {
+    int hit = 0;
+    for(int l = 0; l < LIST_LANES; ++l) hit |= a[i + l] == val;
+    if(hit) break;
+  }
+  for(; i < n; ++i) if(a[i] == val) return i;
+  return -1;
+}
+
+int double_array_find(const double * a, int n, double val)
+{
+  int i = 0;
+  for(; i + LIST_LANES <= n; i += LIST_LANES) {
+    int hit = 0;
+    for(int l = 0; l < LIST_LANES; ++l) hit |= a[i + l] == val;
+    if(hit) break;
+  }
+  for(; i < n; ++i) if(a[i] == val) return i;
+  return -1;
+}
+
+int char_array_find(const char * a, int n, char val)
+{
+  const char * p = memchr(a, val, n);
+  return p ? p - a : -1;
+}
+
+/* Number of elements of a[0..n) equal to val */
+int int_array_count(const int * a, int n, int val)
+{
+  int c[LIST_LANES] = {0}, i = 0, count = 0;
+  for(; i + LIST_LANES <= n; i += LIST_LANES)
+    for(int l = 0; l < LIST_LANES; ++l) c[l] += a[i + l] == val;
+  for(; i < n; ++i) count += a[i] == val;
+  for(int l = 0; l < LIST_LANES; ++l) count += c[l];
+  return count;
+}
+
+int float_array_count(const float * a, int n, float val)
+{
+  int c[LIST_LANES] = {0}, i = 0, count = 0;
+  for(; i + LIST_LANES <= n; i += LIST_LANES)
+    for(int l = 0; l < LIST_LANES; ++l) c[l] += a[i + l] == val;
+  for(; i < n; ++i) count += a[i] == val;
+  for(int l = 0; l < LIST_LANES; ++l) count += c[l];
+  return count;
+}
+
+int double_array_count(const double * a, int n, double val)
+{
+  int c[LIST_LANES] = {0}, i = 0, count = 0;
+  for(; i + LIST_LANES <= n; i += LIST_LANES)
+    for(int l = 0; l < LIST_LANES; ++l) c[l] += a[i + l] == val;
+  for(; i < n; ++i) count += a[i] == val;
+  for(int l = 0; l < LIST_LANES; ++l) count += c[l];
+  return count;
+}
+
+int char_array_count(const char * a, int n, char val)
+{
+  const uint64_t ones = 0x0101010101010101u, low = 0x7f7f7f7f7f7f7f7fu;
+  const uint64_t pattern = ones*(unsigned char) val;
+  int i = 0, count = 0;
+  for(; i + 8 <= n; i += 8) {
+    uint64_t w;
+    memcpy(&w, a + i, 8);
+    w ^= pattern; /* Zero bytes where the characters equal val */
+    w = ~(((w & low) + low) | w | low); /* 0x80 in those bytes, 0 elsewhere */
+    count += (w >> 7)*ones >> 56; /* Add up the bytes in the top one */
+  }
+  for(; i < n; ++i) count += a[i] == val;
+  return count;
+}
+
+/* Lists */
+
+long int_list_sum(struct int_list * list)
+{
+  int start[2], count[2];
+  list_runs(list, start, count);
+  return int_array_sum(list->element + start[0], count[0])
+         + int_array_sum(list->element + start[1], count[1]);
+}
+
+double float_list_sum(struct float_list * list)
+{
+  int start[2], count[2];
+  list_runs(list, start, count);
+  return float_array_sum(list->element + start[0], count[0])
+         + float_array_sum(list->element + start[1], count[1]);
+}
+
+double double_list_sum(struct double_list * list)
+{
+  int start[2], count[2];
+  list_runs(list, start, count);
+  return double_array_sum(list->element + start[0], count[0])
+         + double_array_sum(list->element + start[1], count[1]);
+}
+
+long char_list_sum(struct char_list * list)
+{
+  int start[2], count[2];
+  list_runs(list, start, count);
+  return char_array_sum(list->element + start[0], count[0])
+         + char_array_sum(list->element + start[1], count[1]);
+}
+
+void int_list_minmax(struct int_list * list, int * lo, int * hi)
+{
+  int start[2], count[2];
+  list_runs(list, start, count);
+  *lo = INT_MAX;
+  *hi = INT_MIN;
+  int_array_minmax(list->element + start[0], count[0], lo, hi);
+  int_array_minmax(list->element + start[1], count[1], lo, hi);
+  if(!list->n) *lo = *hi = 0;
+  return;
+}
+
+void float_list_minmax(struct float_list * list, float * lo, float * hi)
+{
+  int start[2], count[2];
+  list_runs(list, start, count);
+  *lo = INFINITY;
+  *hi = -INFINITY;
+  float_array_minmax(list->element + start[0], count[0], lo, hi);
+  float_array_minmax(list->element + start[1], count[1], lo, hi);
+  if(!list->n) *lo = *hi = 0;
+  else if(*lo > *hi) *lo = *hi = NAN; /* Nothing but NaNs */
+  return;
+}
+
+void double_list_minmax(struct double_list * list, double * lo, double * hi)
+{
+  int start[2], count[2];
+  list_runs(list, start, count);
+  *lo = INFINITY;
+  *hi = -INFINITY;
+  double_array_minmax(list->element + start[0], count[0], lo, hi);
+  double_array_minmax(list->element + start[1], count[1], lo, hi);
+  if(!list->n) *lo = *hi = 0;
+  else if(*lo > *hi) *lo = *hi = NAN; /* Nothing but NaNs */
+  return;
+}
+
+void char_list_minmax(struct char_list * list, char * lo, char * hi)
+{
+  int start[2], count[2];
+  list_runs(list, start, count);
+  *lo = CHAR_MAX;
+  *hi = CHAR_MIN;
+  char_array_minmax(list->element + start[0], count[0], lo, hi);
+  char_array_minmax(list->element + start[1], count[1], lo, hi);
+  if(!list->n) *lo = *hi = 0;
+  return;
+}
+
+int int_list_min(struct int_list * list)
+{int lo, hi; int_list_minmax(list, &lo, &hi); return lo;}
+
+int int_list_max(struct int_list * list)
+{int lo, hi; int_list_minmax(list, &lo, &hi); return hi;}
+
+float float_list_min(struct float_list * list)
+{float lo, hi; float_list_minmax(list, &lo, &hi); return lo;}
+
+float float_list_max(struct float_list * list)
+{float lo, hi; float_list_minmax(list, &lo, &hi); return hi;}
+
+double double_list_min(struct double_list * list)
+{double lo, hi; double_list_minmax(list, &lo, &hi); return lo;}
+
+double double_list_max(struct double_list * list)
+{double lo, hi; double_list_minmax(list, &lo, &hi); return hi;}
+
+char char_list_min(struct char_list * list)
+{char lo, hi; char_list_minmax(list, &lo, &hi); return lo;}
+
+char char_list_max(struct char_list * list)
+{char lo, hi; char_list_minmax(list, &lo, &hi); return hi;}
+
+int int_list_find(struct int_list * list, int val)
+{
+  int start[2], count[2];
+  list_runs(list, start, count);
+  int i = int_array_find(list->element + start[0], count[0], val);
+  if(i < 0 && (i = int_array_find(list->element + start[1], count[1], val))
+              >= 0) i += count[0];
+  return i;
+}
+
+int float_list_find(struct float_list * list, float val)
+{
+  int start[2], count[2];
+  list_runs(list, start, count);
+  int i = float_array_find(list->element + start[0], count[0], val);
+  if(i < 0 && (i = float_array_find(list->element + start[1], count[1], val))
+              >= 0) i += count[0];
+  return i;
+}
+
+int double_list_find(struct double_list * list, double val)
+{
+  int start[2], count[2];
+  list_runs(list, start, count);
+  int i = double_array_find(list->element + start[0], count[0], val);
+  if(i < 0 && (i = double_array_find(list->element + start[1], count[1], val))
+              >= 0) i += count[0];
+  return i;
+}
+
+int char_list_find(struct char_list * list, char val)
+{
+  int start[2], count[2];
+  list_runs(list, start, count);
+  int i = char_array_find(list->element + start[0], count[0], val);
+  if(i < 0 && (i = char_array_find(list->element + start[1], count[1], val))
+              >= 0) i += count[0];
+  return i;
+}
+
+int string_list_find(struct string_list * list, char * val)
+{
+  if(list->pool && !(val = string_pool_find(list->pool, val))) return -1;
+  for(int i = 0; i < list->n; ++i) {
+    char * s = list->element[list_index(list, i)];
+    if(list->pool ? s == val : !strcmp(s, val)) return i;
+  }
+  return -1;
+}
+
+int obj_list_find(struct obj_list * list, void * val)
+{
+  for(int i = 0; i < list->n; ++i)
+    if(list->element[list_index(list, i)] == val) return i;
+  return -1;
+}
+
+int int_list_count(struct int_list * list, int val)
+{
+  int start[2], count[2];
+  list_runs(list, start, count);
+  return int_array_count(list->element + start[0], count[0], val)
+         + int_array_count(list->element + start[1], count[1], val);
+}
+
+int float_list_count(struct float_list * list, float val)
+{
+  int start[2], count[2];
+  list_runs(list, start, count);
+  return float_array_count(list->element + start[0], count[0], val)
+         + float_array_count(list->element + start[1], count[1], val);
+}
+
+int double_list_count(struct double_list * list, double val)
+{
+  int start[2], count[2];
+  list_runs(list, start, count);
+  return double_array_count(list->element + start[0], count[0], val)
+         + double_array_count(list->element + start[1], count[1], val);
+}
+
+int char_list_count(struct char_list * list, char val)
+{
+  int start[2], count[2];
+  list_runs(list, start, count);
+  return char_array_count(list->element + start[0], count[0], val)
+         + char_array_count(list->element + start[1], count[1], val);
+}
+
+int string_list_count(struct string_list * list, char * val)
+{
+  int count = 0;
+  if(list->pool && !(val = string_pool_find(list->pool, val))) return 0;
+  for(int i = 0; i < list->n; ++i) {
+    char * s = list->element[list_index(list, i)];
+    count += list->pool ? s == val : !strcmp(s, val);
+  }
+  return count;
+}
+
+int obj_list_count(struct obj_list * list, void * val)
+{
+  int count = 0;
+  for(int i = 0; i < list->n; ++i)
+    count += list->element[list_index(list, i)] == val;
+  return count;
+}
+
+# define list_lower_bound(list, val) \
+  _Generic((list), \
+            struct int_list *: int_list_lower_bound, \
+            struct int8_list *: int8_list_lower_bound, \
+            struct uint8_list *: uint8_list_lower_bound, \
+            struct int16_list *: int16_list_lower_bound, \
+            struct uint16_list *: uint16_list_lower_bound, \
+            struct uint32_list *: uint32_list_lower_bound, \
+            struct int64_list *: int64_list_lower_bound, \
+            struct uint64_list *: uint64_list_lower_bound, \
+            struct float_list *: float_list_lower_bound, \
+            struct double_list *: double_list_lower_bound, \
+            struct char_list *: char_list_lower_bound, \
+            struct string_list *: string_list_lower_bound, \
+            default: null_function)(list, val)
+
+# define list_bsearch(list, val) \
+  _Generic((list), \
+            struct int_list *: int_list_bsearch, \
+            struct int8_list *: int8_list_bsearch, \
+            struct uint8_list *: uint8_list_bsearch, \
+            struct int16_list *: int16_list_bsearch, \
+            struct uint16_list *: uint16_list_bsearch, \
+            struct uint32_list *: uint32_list_bsearch, \
+            struct int64_list *: int64_list_bsearch, \
+            struct uint64_list *: uint64_list_bsearch, \
+            struct float_list *: float_list_bsearch, \
+            struct double_list *: double_list_bsearch, \
+            struct char_list *: char_list_bsearch, \
+            struct string_list *: string_list_bsearch, \
+            default: null_function)(list, val)
+
+# define list_insert_sorted(list, val) \
+  _Generic((list), \
+            struct int_list *: int_list_insert_sorted, \
+            struct int8_list *: int8_list_insert_sorted, \
+            struct uint8_list *: uint8_list_insert_sorted, \
+            struct int16_list *: int16_list_insert_sorted, \
+            struct uint16_list *: uint16_list_insert_sorted, \
+            struct uint32_list *: uint32_list_insert_sorted, \
+            struct int64_list *: int64_list_insert_sorted, \
+            struct uint64_list *: uint64_list_insert_sorted, \
+            struct float_list *: float_list_insert_sorted, \
+            struct double_list *: double_list_insert_sorted, \
+            struct char_list *: char_list_insert_sorted, \
+            struct string_list *: string_list_insert_sorted, \
+            default: null_function)(list, val)
+
+# define list_unique(list) \
+  _Generic((list), \
+            struct int_list *: int_list_unique, \
+            struct int8_list *: int8_list_unique, \
+            struct uint8_list *: uint8_list_unique, \
+            struct int16_list *: int16_list_unique, \
+            struct uint16_list *: uint16_list_unique, \
+            struct uint32_list *: uint32_list_unique, \
+            struct int64_list *: int64_list_unique, \
+            struct uint64_list *: uint64_list_unique, \
+            struct float_list *: float_list_unique, \
+            struct double_list *: double_list_unique, \
+            struct char_list *: char_list_unique, \
+            struct string_list *: string_list_unique, \
+            default: null_function)(list)
+
+# define list_merge(list, part, k) \
+  _Generic((list), \
+            struct int_list *: int_list_merge, \
+            struct int8_list *: int8_list_merge, \
+            struct uint8_list *: uint8_list_merge, \
+            struct int16_list *: int16_list_merge, \
+            struct uint16_list *: uint16_list_merge, \
+            struct uint32_list *: uint32_list_merge, \
+            struct int64_list *: int64_list_merge, \
+            struct uint64_list *: uint64_list_merge, \
+            struct float_list *: float_list_merge, \
+            struct double_list *: double_list_merge, \
+            struct char_list *: char_list_merge, \
+            struct string_list *: string_list_merge, \
+            default: null_function)(list, part, k)
+
+/* Index of the first element of a sorted array a[0..n) not less than val */
+int int_array_lower_bound(const int * a, int n, int val)
+{
+  if(n == 0) return 0;
+  const int * base = a;
+  while(n > 1) {
+    const int half = n/2;
+    base = base[half] < val ? base + half : base;
+    n -= half;
+  }
+  return base - a + (*base < val);
+}
+
+int float_array_lower_bound(const float * a, int n, float val)
+{
+  if(n == 0) return 0;
+  const uint32_t key = float_key(val);
+  const float * base = a;
+  while(n > 1) {
+    const int half = n/2;
+    base = float_key(base[half]) < key ? base + half : base;
+    n -= half;
+  }
+  return base - a + (float_key(*base) < key);
+}
+
+int double_array_lower_bound(const double * a, int n, double val)
+{
+  if(n == 0) return 0;
+  const uint64_t key = double_key(val);
+  const double * base = a;
+  while(n > 1) {
+    const int half = n/2;
+    base = double_key(base[half]) < key ? base + half : base;
+    n -= half;
+  }
+  return base - a + (double_key(*base) < key);
+}
+
+int char_array_lower_bound(const char * a, int n, char val)
+{
+  if(n == 0) return 0;
+  const char * base = a;
+  while(n > 1) {
+    const int half = n/2;
+    base = base[half] < val ? base + half : base;
+    n -= half;
+  }
+  return base - a + (*base < val);
+}
+
+/* The same for strings (from a pool if pooled) */
+int string_array_lower_bound(char * const * a, int n, const char * val,
+                             int pooled)
+{
+  const uint64_t key = pooled ? string_prefix_key(val, strlen(val)) : 0;
+  int lo = 0;
+  while(n > 0) {
+    const int half = n/2;
+    const char * s = a[lo + half];
+    int c;
+    if(pooled && string_header(s)->prefix != key)
+      c = string_header(s)->prefix < key ? -1 : 1;
+    else c = strcmp(s, val);
+    if(c < 0) {
+      lo += half + 1;
+      n -= half + 1;
+    } else n = half;
+  }
+  return lo;
+}
+
+/* Remove the repeats of equal elements from a sorted array of n elements of
+   the given width (compared with memcmp if compare is NULL), and return the
+   new number of elements */
+int list_unique_array(void * element, int n, size_t width,
+                      int (* compare) (const void *, const void *))
+{
+  char * e = element;
+  int m = n > 0;
+  for(int i = 1; i < n; ++i) {
+    const char * x = e + i*width, * last = e + (m - 1)*width;
+    if(compare ? !compare(x, last) : !memcmp(x, last, width)) continue;
+    if(m < i) memcpy(e + m*width, x, width);
+    m++;
+  }
+  return m;
+}
+
+/* Is part a (at position next[a]) before part b in the heap of a merge? */
+int list_merge_before(char ** part, const int * next, int a, int b,
+                      size_t width, int (* compare) (const void *,
+                                                     const void *))
+{
+  const int c = compare(part[a] + next[a]*width, part[b] + next[b]*width);
+  return c < 0 || (c == 0 && a < b);
+}
+
+/* Merge the k sorted arrays part[t], with length[t] elements of the given
+   width, into a new array (replacing old), and return it */
+void * list_merge_arrays(void * old, struct list_storage * storage,
+                         char ** part, const int * length, int k,
+                         size_t width, int (* compare) (const void *,
+                                                        const void *))
+{
+  int * heap = malloc(k*sizeof(int) + 1), * next = calloc(k + 1, sizeof(int));
+  size_t n = 0;
+  int h = 0;
+  for(int t = 0; t < k; ++t) n += length[t];
+  char * out = malloc(n*width + 1), * o = out;
+  if(!heap || !next || !out) {
+    fprintf(stderr, "Error: list_merge: unable to allocate memory.\n");
+    exit(-1);
+  }
+  for(int t = 0; t < k; ++t) {
+    if(!length[t]) continue;
+    int c = h++;
+    /* Sift up */
+    while(c > 0 && list_merge_before(part, next, t, heap[(c - 1)/2], width,
+                                     compare)) {
+      heap[c] = heap[(c - 1)/2];
+      c = (c - 1)/2;
+    }
+    heap[c] = t;
+  }
+  while(h > 1) {
+    const int t = heap[0];
+    memcpy(o, part[t] + next[t]*width, width);
+    o += width;
+    int top = ++next[t] < length[t] ? t : heap[--h];
+    /* Sift down */
+    int c = 0;
+    while(2*c + 1 < h) {
+      int child = 2*c + 1;
+      if(child + 1 < h && list_merge_before(part, next, heap[child + 1],
+                                            heap[child], width, compare))
+        child++;
+      if(!list_merge_before(part, next, heap[child], top, width, compare))
+        break;
+      heap[c] = heap[child];
+      c = child;
+    }
+    heap[c] = top;
+  }
+  if(h == 1) /* The rest of the last part */
+    memcpy(o, part[heap[0]] + next[heap[0]]*width,
+           (length[heap[0]] - next[heap[0]])*width);
+  free(heap);
+  free(next);
+  list_release(old, storage);
+  return out;
+}
+
+int int_list_lower_bound(struct int_list * list, int val)
+{
+  int start[2], count[2];
+  list_runs(list, start, count);
+  int i = int_array_lower_bound(list->element + start[0], count[0], val);
+  if(i == count[0])
+    i += int_array_lower_bound(list->element + start[1], count[1], val);
+  return i;
+}
+
+int float_list_lower_bound(struct float_list * list, float val)
+{
+  int start[2], count[2];
+  list_runs(list, start, count);
+  int i = float_array_lower_bound(list->element + start[0], count[0], val);
+  if(i == count[0])
+    i += float_array_lower_bound(list->element + start[1], count[1], val);
+  return i;
+}
+
+int double_list_lower_bound(struct double_list * list, double val)
+{
+  int start[2], count[2];
+  list_runs(list, start, count);
+  int i = double_array_lower_bound(list->element + start[0], count[0], val);
+  if(i == count[0])
+    i += double_array_lower_bound(list->element + start[1], count[1], val);
+  return i;
+}
+
+int char_list_lower_bound(struct char_list * list, char val)
+{
+  int start[2], count[2];
+  list_runs(list, start, count);
+  int i = char_array_lower_bound(list->element + start[0], count[0], val);
+  if(i == count[0])
+    i += char_array_lower_bound(list->element + start[1], count[1], val);
+  return i;
+}
+
+int string_list_lower_bound(struct string_list * list, char * val)
+{
+  int start[2], count[2], pooled = list->pool != NULL;
+  list_runs(list, start, count);
+  int i = string_array_lower_bound(list->element + start[0], count[0], val,
+                                   pooled);
+  if(i == count[0])
+    i += string_array_lower_bound(list->element + start[1], count[1], val,
+                                  pooled);
+  return i;
+}
+
+int int_list_bsearch(struct int_list * list, int val)
+{
+  int i = int_list_lower_bound(list, val);
+  return i < list->n && int_read(list, i) == val ? i : -1;
+}
+
+int float_list_bsearch(struct float_list * list, float val)
+{
+  int i = float_list_lower_bound(list, val);
+  return i < list->n && float_key(float_read(list, i)) == float_key(val)
+         ? i : -1;
+}
+
+int double_list_bsearch(struct double_list * list, double val)
+{
+  int i = double_list_lower_bound(list, val);
+  return i < list->n && double_key(double_read(list, i)) == double_key(val)
+         ? i : -1;
+}
+
+int char_list_bsearch(struct char_list * list, char val)
+{
+  int i = char_list_lower_bound(list, val);
+  return i < list->n && char_read(list, i) == val ? i : -1;
+}
+
+int string_list_bsearch(struct string_list * list, char * val)
+{
+  int i = string_list_lower_bound(list, val);
+  return i < list->n && !strcmp(string_read(list, i), val) ? i : -1;
+}
+
+int int_list_insert_sorted(struct int_list * list, int val)
+{
+  int i = int_list_lower_bound(list, val);
+  int_list_push(list, i, val);
+  return i;
+}
+
+int float_list_insert_sorted(struct float_list * list, float val)
+{
+  int i = float_list_lower_bound(list, val);
+  float_list_push(list, i, val);
+  return i;
+}
+
+int double_list_insert_sorted(struct double_list * list, double val)
+{
+  int i = double_list_lower_bound(list, val);
+  double_list_push(list, i, val);
+  return i;
+}
+
+int char_list_insert_sorted(struct char_list * list, char val)
+{
+  int i = char_list_lower_bound(list, val);
+  char_list_push(list, i, val);
+  return i;
+}
+
+int string_list_insert_sorted(struct string_list * list, char * val)
+{
+  int i = string_list_lower_bound(list, val);
+  string_list_push(list, i, val);
+  return i;
+}
+
+int int_list_unique(struct int_list * list)
+{
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode,
+                 sizeof(int));
+  list->n = list_unique_array(list->element, list->n, sizeof(int), NULL);
+  if(list->mode == LIST_GAP) list->at = list->n;
+  return list->n;
+}
+
+int float_list_unique(struct float_list * list)
+{
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode,
+                 sizeof(float));
+  list->n = list_unique_array(list->element, list->n, sizeof(float), NULL);
+  if(list->mode == LIST_GAP) list->at = list->n;
+  return list->n;
+}
+
+int double_list_unique(struct double_list * list)
+{
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode,
+                 sizeof(double));
+  list->n = list_unique_array(list->element, list->n, sizeof(double), NULL);
+  if(list->mode == LIST_GAP) list->at = list->n;
+  return list->n;
+}
+
+int char_list_unique(struct char_list * list)
+{
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode,
+                 sizeof(char));
+  list->n = list_unique_array(list->element, list->n, sizeof(char), NULL);
+  if(list->mode == LIST_GAP) list->at = list->n;
+  return list->n;
+}
+
+int string_list_unique(struct string_list * list)
+{
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode,
+                 sizeof(char *));
+  list->n = list_unique_array(list->element, list->n, sizeof(char *),
+                              list->pool ? NULL : string_compare);
+  if(list->mode == LIST_GAP) list->at = list->n;
+  return list->n;
+}
+
+void int_list_merge(struct int_list * list, struct int_list ** part, int k)
+{
+  char ** e = malloc(k*sizeof(char *) + 1);
+  int * length = malloc(k*sizeof(int) + 1), n = 0;
+  for(int t = 0; t < k; ++t) {
+    list_linearize(part[t]->element, part[t]->size, &part[t]->at, part[t]->n,
+                   part[t]->mode, sizeof(int));
+    e[t] = (char *) part[t]->element;
+    n += length[t] = part[t]->n;
+  }
+  list->element = list_merge_arrays(list->element, &list->storage, e, length, k,
+                                    sizeof(int), int_compare);
+  list->n = list->size = n;
+  list->at = list->mode == LIST_GAP ? n : 0;
+  free(e);
+  free(length);
+  return;
+}
+
+void float_list_merge(struct float_list * list, struct float_list ** part,
+                      int k)
+{
+  char ** e = malloc(k*sizeof(char *) + 1);
+  int * length = malloc(k*sizeof(int) + 1), n = 0;
+  for(int t = 0; t < k; ++t) {
+    list_linearize(part[t]->element, part[t]->size, &part[t]->at, part[t]->n,
+                   part[t]->mode, sizeof(float));
+    e[t] = (char *) part[t]->element;
+    n += length[t] = part[t]->n;
+  }
+  list->element = list_merge_arrays(list->element, &list->storage, e, length, k,
+                                    sizeof(float), float_compare);
+  list->n = list->size = n;
+  list->at = list->mode == LIST_GAP ? n : 0;
+  free(e);
+  free(length);
+  return;
+}
+
+void double_list_merge(struct double_list * list, struct double_list ** part,
+                       int k)
+{
+  char ** e = malloc(k*sizeof(char *) + 1);
+  int * length = malloc(k*sizeof(int) + 1), n = 0;
+  for(int t = 0; t < k; ++t) {
+    list_linearize(part[t]->element, part[t]->size, &part[t]->at, part[t]->n,
+                   part[t]->mode, sizeof(double));
+    e[t] = (char *) part[t]->element;
+    n += length[t] = part[t]->n;
+  }
+  list->element = list_merge_arrays(list->element, &list->storage, e, length, k,
+                                    sizeof(double), double_compare);
+  list->n = list->size = n;
+  list->at = list->mode == LIST_GAP ? n : 0;
+  free(e);
+  free(length);
+  return;
+}
+
+void char_list_merge(struct char_list * list, struct char_list ** part, int k)
+{
+  char ** e = malloc(k*sizeof(char *) + 1);
+  int * length = malloc(k*sizeof(int) + 1), n = 0;
+  for(int t = 0; t < k; ++t) {
+    list_linearize(part[t]->element, part[t]->size, &part[t]->at, part[t]->n,
+                   part[t]->mode, sizeof(char));
+    e[t] = part[t]->element;
+    n += length[t] = part[t]->n;
+  }
+  list->element = list_merge_arrays(list->element, &list->storage, e, length, k,
+                                    sizeof(char), char_compare);
+  list->n = list->size = n;
+  list->at = list->mode == LIST_GAP ? n : 0;
+  free(e);
+  free(length);
+  return;
+}
+
+void string_list_merge(struct string_list * list, struct string_list ** part,
+                       int k)
+{
+  char ** e = malloc(k*sizeof(char *) + 1);
+  int * length = malloc(k*sizeof(int) + 1), n = 0;
+  for(int t = 0; t < k; ++t) {
+    list_linearize(part[t]->element, part[t]->size, &part[t]->at, part[t]->n,
+                   part[t]->mode, sizeof(char *));
+    e[t] = (char *) part[t]->element;
+    n += length[t] = part[t]->n;
+  }
+  list->element = list_merge_arrays(list->element, &list->storage, e, length, k,
+                                    sizeof(char *), string_compare);
+  list->n = list->size = n;
+  list->at = list->mode == LIST_GAP ? n : 0;
+  if(list->pool) /* The strings of the other parts come from other pools */
+    for(int i = 0; i < n; ++i)
+      list->element[i] = string_intern(list->pool, list->element[i]);
+  free(e);
+  free(length);
+  return;
+}
+
+# define list_save(list, path) \
+  _Generic((list), \
+            struct int_list *: int_list_save, \
+            struct float_list *: float_list_save, \
+            struct double_list *: double_list_save, \
+            struct char_list *: char_list_save, \
+            struct int8_list *: int8_list_save, \
+            struct uint8_list *: uint8_list_save, \
+            struct int16_list *: int16_list_save, \
+            struct uint16_list *: uint16_list_save, \
+            struct uint32_list *: uint32_list_save, \
+            struct int64_list *: int64_list_save, \
+            struct uint64_list *: uint64_list_save, \
+            default: null_function)(list, path)
+
+# define list_map(list, path, how) \
+  _Generic((list), \
+            struct int_list *: int_list_map, \
+            struct float_list *: float_list_map, \
+            struct double_list *: double_list_map, \
+            struct char_list *: char_list_map, \
+            struct int8_list *: int8_list_map, \
+            struct uint8_list *: uint8_list_map, \
+            struct int16_list *: int16_list_map, \
+            struct uint16_list *: uint16_list_map, \
+            struct uint32_list *: uint32_list_map, \
+            struct int64_list *: int64_list_map, \
+            struct uint64_list *: uint64_list_map, \
+            default: null_function)(list, path, how)
+
+void * int_list_save(struct int_list * list, const char * path)
+{
+  int start[2], count[2];
+  list_runs(list, start, count);
+  return list_save_runs(path, LIST_TYPE_INT, sizeof(int), list->element,
+                        start, count) ? list : NULL;
+}
+
+void * float_list_save(struct float_list * list, const char * path)
+{
+  int start[2], count[2];
+  list_runs(list, start, count);
+  return list_save_runs(path, LIST_TYPE_FLOAT, sizeof(float), list->element,
+                        start, count) ? list : NULL;
+}
+
+void * double_list_save(struct double_list * list, const char * path)
+{
+  int start[2], count[2];
+  list_runs(list, start, count);
+  return list_save_runs(path, LIST_TYPE_DOUBLE, sizeof(double), list->element,
+                        start, count) ? list : NULL;
+}
+
+void * char_list_save(struct char_list * list, const char * path)
+{
+  int start[2], count[2];
+  list_runs(list, start, count);
+  return list_save_runs(path, LIST_TYPE_CHAR, sizeof(char), list->element,
+                        start, count) ? list : NULL;
+}
+
+void * int_list_map(struct int_list * list, const char * path,
+                    enum list_map_mode how)
+{
+  int * e = list_map_file(path, LIST_TYPE_INT, sizeof(int), how, &list->n,
+                          &list->storage);
+  if(!e) return NULL;
+  list->element = e;
+  list->size = list->n;
+  list->mode = list->at = 0;
+  return list;
+}
+
+void * float_list_map(struct float_list * list, const char * path,
+                      enum list_map_mode how)
+{
+  float * e = list_map_file(path, LIST_TYPE_FLOAT, sizeof(float), how,
+                            &list->n, &list->storage);
+  if(!e) return NULL;
+  list->element = e;
+  list->size = list->n;
+  list->mode = list->at = 0;
+  return list;
+}
+
+void * double_list_map(struct double_list * list, const char * path,
+                       enum list_map_mode how)
+{
+  double * e = list_map_file(path, LIST_TYPE_DOUBLE, sizeof(double), how,
+                             &list->n, &list->storage);
+  if(!e) return NULL;
+  list->element = e;
+  list->size = list->n;
+  list->mode = list->at = 0;
+  return list;
+}
+
+void * char_list_map(struct char_list * list, const char * path,
+                     enum list_map_mode how)
+{
+  char * e = list_map_file(path, LIST_TYPE_CHAR, sizeof(char), how,
+                           &list->n, &list->storage);
+  if(!e) return NULL;
+  list->element = e;
+  list->size = list->n;
+  list->mode = list->at = 0;
+  return list;
+}
+
+# define list_range(list, i, k, start, count) \
+  list_range_bounds((list)->mode, (list)->at, (list)->n, (list)->size, i, k, \
+                    start, count)
+
+/* Positions and lengths of the runs of elements i, ..., i + k - 1 in the array
+   of a list */
+void list_range_bounds(int mode, int at, int n, int size, int i, int k,
+                       int start[2], int count[2])
+{
+  int run_start[2], run_count[2], first = 0;
+  list_run_bounds(mode, at, n, size, run_start, run_count);
+  for(int r = 0; r < 2; ++r) {
+    const int lo = i > first ? i : first;
+    const int hi = i + k < first + run_count[r] ? i + k : first + run_count[r];
+    start[r] = run_start[r] + lo - first;
+    count[r] = hi > lo ? hi - lo : 0;
+    first += run_count[r];
+  }
+  return;
+}
+
+/* Make room for k new elements in front of element i of a list with n
+   elements: they go to positions i, ..., i + k - 1 of the array */
+void * list_open_range(void * element, struct list_storage * storage,
+                       int * size, int * at, int n, int mode, int i, int k,
+                       size_t width)
+{
+  if(mode == LIST_GAP) {
+    if(n + k > *size)
+      element = list_expand(element, storage, size, at, n, mode,
+                            list_new_size(*size, n + k), width);
+    list_move_gap(element, at, n, *size, i, width);
+    *at += k; /* The new elements take the first places of the gap */
+    return element;
+  }
+  list_linearize(element, *size, at, n, mode, width);
+  element = list_grow(element, storage, size, n + k, width);
+  char * e = element;
+  memmove(e + (i + k)*width, e + i*width, (n - i)*width);
+  return element;
+}
+
+/* Close the places of the k elements from i on in a list with n elements */
+void list_close_range(void * element, int size, int * at, int n, int mode,
+                      int i, int k, size_t width)
+{
+  if(mode == LIST_GAP) {
+    list_move_gap(element, at, n, size, i + k, width);
+    *at -= k; /* The elements join the gap */
+    return;
+  }
+  list_linearize(element, size, at, n, mode, width);
+  char * e = element;
+  memmove(e + i*width, e + (i + k)*width, (n - i - k)*width);
+  return;
+}
+
+/* Copy the k elements of a list from i on into out */
+void list_copy_range(void * out, const void * element, int size, int at,
+                     int n, int mode, int i, int k, size_t width)
+{
+  int start[2], count[2];
+  const char * e = element;
+  list_range_bounds(mode, at, n, size, i, k, start, count);
+  memcpy(out, e + start[0]*width, count[0]*width);
+  memcpy((char *) out + count[0]*width, e + start[1]*width, count[1]*width);
+  return;
+}
+
+/* Make room for k elements in an (initialised) list, which becomes empty */
+void * list_clear_for(void * element, struct list_storage * storage,
+                      int * size, int * n, int * at, int mode, int k,
+                      size_t width)
+{
+  *n = *at = 0;
+  return list_grow(element, storage, size, k, width);
+}
+
+# define list_extend(list, src, k) \
+  _Generic((list), \
+            struct int_list *: int_list_extend, \
+            struct float_list *: float_list_extend, \
+            struct double_list *: double_list_extend, \
+            struct char_list *: char_list_extend, \
+            struct string_list *: string_list_extend, \
+            struct obj_list *: obj_list_extend, \
+            struct int8_list *: int8_list_extend, \
+            struct uint8_list *: uint8_list_extend, \
+            struct int16_list *: int16_list_extend, \
+            struct uint16_list *: uint16_list_extend, \
+            struct uint32_list *: uint32_list_extend, \
+            struct int64_list *: int64_list_extend, \
+            struct uint64_list *: uint64_list_extend, \
+            struct packed_list *: packed_list_extend, \
+            default: null_function)(list, src, k)
+
+# define list_insert_range(list, i, src, k) \
+  _Generic((list), \
+            struct int_list *: int_list_insert_range, \
+            struct float_list *: float_list_insert_range, \
+            struct double_list *: double_list_insert_range, \
+            struct char_list *: char_list_insert_range, \
+            struct string_list *: string_list_insert_range, \
+            struct obj_list *: obj_list_insert_range, \
+            struct int8_list *: int8_list_insert_range, \
+            struct uint8_list *: uint8_list_insert_range, \
+            struct int16_list *: int16_list_insert_range, \
+            struct uint16_list *: uint16_list_insert_range, \
+            struct uint32_list *: uint32_list_insert_range, \
+            struct int64_list *: int64_list_insert_range, \
+            struct uint64_list *: uint64_list_insert_range, \
+            default: null_function)(list, i, src, k)
+
+# define list_erase_range(list, i, k) \
+  _Generic((list), \
+            struct int_list *: int_list_erase_range, \
+            struct float_list *: float_list_erase_range, \
+            struct double_list *: double_list_erase_range, \
+            struct char_list *: char_list_erase_range, \
+            struct string_list *: string_list_erase_range, \
+            struct obj_list *: obj_list_erase_range, \
+            struct int8_list *: int8_list_erase_range, \
+            struct uint8_list *: uint8_list_erase_range, \
+            struct int16_list *: int16_list_erase_range, \
+            struct uint16_list *: uint16_list_erase_range, \
+            struct uint32_list *: uint32_list_erase_range, \
+            struct int64_list *: int64_list_erase_range, \
+            struct uint64_list *: uint64_list_erase_range, \
+            default: null_function)(list, i, k)
+
+# define list_slice(list, dest, i, k) \
+  _Generic((list), \
+            struct int_list *: int_list_slice, \
+            struct float_list *: float_list_slice, \
+            struct double_list *: double_list_slice, \
+            struct char_list *: char_list_slice, \
+            struct string_list *: string_list_slice, \
+            struct obj_list *: obj_list_slice, \
+            struct int8_list *: int8_list_slice, \
+            struct uint8_list *: uint8_list_slice, \
+            struct int16_list *: int16_list_slice, \
+            struct uint16_list *: uint16_list_slice, \
+            struct uint32_list *: uint32_list_slice, \
+            struct int64_list *: int64_list_slice, \
+            struct uint64_list *: uint64_list_slice, \
+            default: null_function)(list, dest, i, k)
+
+# define list_fill(list, i, k, val) \
+  _Generic((list), \
+            struct int_list *: int_list_fill, \
+            struct float_list *: float_list_fill, \
+            struct double_list *: double_list_fill, \
+            struct char_list *: char_list_fill, \
+            struct string_list *: string_list_fill, \
+            struct obj_list *: obj_list_fill, \
+            struct int8_list *: int8_list_fill, \
+            struct uint8_list *: uint8_list_fill, \
+            struct int16_list *: int16_list_fill, \
+            struct uint16_list *: uint16_list_fill, \
+            struct uint32_list *: uint32_list_fill, \
+            struct int64_list *: int64_list_fill, \
+            struct uint64_list *: uint64_list_fill, \
+            default: null_function)(list, i, k, val)
+
+void int_list_insert_range(struct int_list * list, int i, const int * src,
+                           int k)
+{
+  list->element = list_open_range(list->element, &list->storage, &list->size,
+                                  &list->at, list->n, list->mode, i, k,
+                                  sizeof(int));
+  memcpy(list->element + i, src, k*sizeof(int));
+  list->n += k;
+  return;
+}
+
+void float_list_insert_range(struct float_list * list, int i,
+                             const float * src, int k)
+{
+  list->element = list_open_range(list->element, &list->storage, &list->size,
+                                  &list->at, list->n, list->mode, i, k,
+                                  sizeof(float));
+  memcpy(list->element + i, src, k*sizeof(float));
+  list->n += k;
+  return;
+}
+
+void double_list_insert_range(struct double_list * list, int i,
+                              const double * src, int k)
+{
+  list->element = list_open_range(list->element, &list->storage, &list->size,
+                                  &list->at, list->n, list->mode, i, k,
+                                  sizeof(double));
+  memcpy(list->element + i, src, k*sizeof(double));
+  list->n += k;
+  return;
+}
+
+void char_list_insert_range(struct char_list * list, int i, const char * src,
+                            int k)
+{
+  list->element = list_open_range(list->element, &list->storage, &list->size,
+                                  &list->at, list->n, list->mode, i, k,
+                                  sizeof(char));
+  memcpy(list->element + i, src, k*sizeof(char));
+  list->n += k;
+  return;
+}
+
+void string_list_insert_range(struct string_list * list, int i,
+                              char * const * src, int k)
+{
+  list->element = list_open_range(list->element, &list->storage, &list->size,
+                                  &list->at, list->n, list->mode, i, k,
+                                  sizeof(char *));
+  if(list->pool)
+    for(int j = 0; j < k; ++j)
+      list->element[i + j] = string_intern(list->pool, src[j]);
+  else memcpy(list->element + i, src, k*sizeof(char *));
+  list->n += k;
+  return;
+}
+
+void obj_list_insert_range(struct obj_list * list, int i, void * const * src,
+                           int k)
+{
+  list->element = list_open_range(list->element, &list->storage, &list->size,
+                                  &list->at, list->n, list->mode, i, k,
+                                  sizeof(void *));
+  memcpy(list->element + i, src, k*sizeof(void *));
+  list->n += k;
+  return;
+}
+
+void int_list_extend(struct int_list * list, const int * src, int k)
+{int_list_insert_range(list, list->n, src, k); return;}
+
+void float_list_extend(struct float_list * list, const float * src, int k)
+{float_list_insert_range(list, list->n, src, k); return;}
+
+void double_list_extend(struct double_list * list, const double * src, int k)
+{double_list_insert_range(list, list->n, src, k); return;}
+
+void char_list_extend(struct char_list * list, const char * src, int k)
+{char_list_insert_range(list, list->n, src, k); return;}
+
+void string_list_extend(struct string_list * list, char * const * src, int k)
+{string_list_insert_range(list, list->n, src, k); return;}
+
+void obj_list_extend(struct obj_list * list, void * const * src, int k)
+{obj_list_insert_range(list, list->n, src, k); return;}
+
+void int_list_erase_range(struct int_list * list, int i, int k)
+{
+  list_close_range(list->element, list->size, &list->at, list->n, list->mode,
+                   i, k, sizeof(int));
+  list->n -= k;
+  return;
+}
+
+void float_list_erase_range(struct float_list * list, int i, int k)
+{
+  list_close_range(list->element, list->size, &list->at, list->n, list->mode,
+                   i, k, sizeof(float));
+  list->n -= k;
+  return;
+}
+
+void double_list_erase_range(struct double_list * list, int i, int k)
+{
+  list_close_range(list->element, list->size, &list->at, list->n, list->mode,
+                   i, k, sizeof(double));
+  list->n -= k;
+  return;
+}
+
+void char_list_erase_range(struct char_list * list, int i, int k)
+{
+  list_close_range(list->element, list->size, &list->at, list->n, list->mode,
+                   i, k, sizeof(char));
+  list->n -= k;
+  return;
+}
+
+void string_list_erase_range(struct string_list * list, int i, int k)
+{
+  list_close_range(list->element, list->size, &list->at, list->n, list->mode,
+                   i, k, sizeof(char *));
+  list->n -= k;
+  return;
+}
+
+void obj_list_erase_range(struct obj_list * list, int i, int k)
+{
+  list_close_range(list->element, list->size, &list->at, list->n, list->mode,
+                   i, k, sizeof(void *));
+  list->n -= k;
+  return;
+}
+
+void int_list_slice(struct int_list * list, struct int_list * dest, int i,
+                    int k)
+{
+  dest->element = list_clear_for(dest->element, &dest->storage, &dest->size,
+                                 &dest->n, &dest->at, dest->mode, k,
+                                 sizeof(int));
+  list_copy_range(dest->element, list->element, list->size, list->at,
+                  list->n, list->mode, i, k, sizeof(int));
+  dest->n = k;
+  if(dest->mode == LIST_GAP) dest->at = k;
+  return;
+}
+
+void float_list_slice(struct float_list * list, struct float_list * dest,
+                      int i, int k)
+{
+  dest->element = list_clear_for(dest->element, &dest->storage, &dest->size,
+                                 &dest->n, &dest->at, dest->mode, k,
+                                 sizeof(float));
+  list_copy_range(dest->element, list->element, list->size, list->at,
+                  list->n, list->mode, i, k, sizeof(float));
+  dest->n = k;
+  if(dest->mode == LIST_GAP) dest->at = k;
+  return;
+}
+
+void double_list_slice(struct double_list * list, struct double_list * dest,
+                       int i, int k)
+{
+  dest->element = list_clear_for(dest->element, &dest->storage, &dest->size,
+                                 &dest->n, &dest->at, dest->mode, k,
+                                 sizeof(double));
+  list_copy_range(dest->element, list->element, list->size, list->at,
+                  list->n, list->mode, i, k, sizeof(double));
+  dest->n = k;
+  if(dest->mode == LIST_GAP) dest->at = k;
+  return;
+}
+
+void char_list_slice(struct char_list * list, struct char_list * dest, int i,
+                     int k)
+{
+  dest->element = list_clear_for(dest->element, &dest->storage, &dest->size,
+                                 &dest->n, &dest->at, dest->mode, k,
+                                 sizeof(char));
+  list_copy_range(dest->element, list->element, list->size, list->at,
+                  list->n, list->mode, i, k, sizeof(char));
+  dest->n = k;
+  if(dest->mode == LIST_GAP) dest->at = k;
+  return;
+}
+
+void string_list_slice(struct string_list * list, struct string_list * dest,
+                       int i, int k)
+{
+  dest->element = list_clear_for(dest->element, &dest->storage, &dest->size,
+                                 &dest->n, &dest->at, dest->mode, k,
+                                 sizeof(char *));
+  list_copy_range(dest->element, list->element, list->size, list->at,
+                  list->n, list->mode, i, k, sizeof(char *));
+  if(dest->pool)
+    for(int j = 0; j < k; ++j)
+      dest->element[j] = string_intern(dest->pool, dest->element[j]);
+  dest->n = k;
+  if(dest->mode == LIST_GAP) dest->at = k;
+  return;
+}
+
+void obj_list_slice(struct obj_list * list, struct obj_list * dest, int i,
+                    int k)
+{
+  dest->element = list_clear_for(dest->element, &dest->storage, &dest->size,
+                                 &dest->n, &dest->at, dest->mode, k,
+                                 sizeof(void *));
+  list_copy_range(dest->element, list->element, list->size, list->at,
+                  list->n, list->mode, i, k, sizeof(void *));
+  dest->n = k;
+  if(dest->mode == LIST_GAP) dest->at = k;
+  return;
+}
+
+void int_list_fill(struct int_list * list, int i, int k, int val)
+{
+  int start[2], count[2];
+  list_range(list, i, k, start, count);
+  for(int r = 0; r < 2; ++r)
+    for(int j = start[r]; j < start[r] + count[r]; ++j) list->element[j] = val;
+  return;
+}
+
+void float_list_fill(struct float_list * list, int i, int k, float val)
+{
+  int start[2], count[2];
+  list_range(list, i, k, start, count);
+  for(int r = 0; r < 2; ++r)
+    for(int j = start[r]; j < start[r] + count[r]; ++j) list->element[j] = val;
+  return;
+}
+
+void double_list_fill(struct double_list * list, int i, int k, double val)
+{
+  int start[2], count[2];
+  list_range(list, i, k, start, count);
+  for(int r = 0; r < 2; ++r)
+    for(int j = start[r]; j < start[r] + count[r]; ++j) list->element[j] = val;
+  return;
+}
+
+void char_list_fill(struct char_list * list, int i, int k, char val)
+{
+  int start[2], count[2];
+  list_range(list, i, k, start, count);
+  for(int r = 0; r < 2; ++r) memset(list->element + start[r], val, count[r]);
+  return;
+}
+
+void string_list_fill(struct string_list * list, int i, int k, char * val)
+{
+  int start[2], count[2];
+  list_range(list, i, k, start, count);
+  if(list->pool) val = string_intern(list->pool, val);
+  for(int r = 0; r < 2; ++r)
+    for(int j = start[r]; j < start[r] + count[r]; ++j) list->element[j] = val;
+  return;
+}
+
+void obj_list_fill(struct obj_list * list, int i, int k, void * val)
+{
+  int start[2], count[2];
+  list_range(list, i, k, start, count);
+  for(int r = 0; r < 2; ++r)
+    for(int j = start[r]; j < start[r] + count[r]; ++j) list->element[j] = val;
+  return;
+}
+
+# define list_iterator_of(list) \
+  new_object(list_iterator, (list), sizeof(*(list)->element), NULL)
+
+struct list_iterator {
+  const struct array_iterator _; /* This item must come first */
+};
+
+/* The fields that all the array lists share */
+struct list_layout {
+  int n;
+  char * element;
+  int size, mode, at;
+};
+
+static void * list_iterator_constructor(void * _self, va_list * args);
+
+static const Class _list_iterator
+  = {sizeof(struct list_iterator), "list iterator", &_array_iterator,
+     list_iterator_constructor, NULL};
+
+const void * list_iterator = &_list_iterator;
+
+static void * list_iterator_constructor(void * _self, va_list * args)
+{
+  array_iterator_constructor(_self, args);
+  const struct list_layout * list = va_arg(*args, const struct list_layout *);
+  const size_t width = va_arg(*args, size_t);
+  if(!list || list->n == 0) return _self;
+  int start[2], count[2];
+  list_run_bounds(list->mode, list->at, list->n, list->size, start, count);
+  if(count[0] == 0) { /* A gap buffer with its gap at the start */
+    start[0] = start[1];
+    count[0] = count[1];
+    count[1] = 0;
+  }
+  array_iterator_runs(_self, list->element + start[0]*width, width, count[0],
+                      (ptrdiff_t) (start[1] - start[0])*width,
+                      count[1] ? 2 : 1, count[1] ? count[1] : count[0]);
+  return _self;
+}
+
+/* Sort n integers of width 1 or 2 by counting them */
+void list_counting_sort(void * a, size_t n, int width, int is_signed)
+{
+  const size_t values = (size_t) 1 << 8*width;
+  const unsigned flip = is_signed ? values/2 : 0; /* Signed to unsigned order */
+  size_t * count = calloc(values, sizeof(size_t));
+  if(!count) {
+    fprintf(stderr, "Error: list_sort: unable to allocate memory.\n");
+    exit(-1);
+  }
+  uint8_t * a8 = a;
+  uint16_t * a16 = a;
+  for(size_t i = 0; i < n; ++i)
+    count[(width == 1 ? a8[i] : a16[i]) ^ flip]++;
+  size_t i = 0;
+  for(size_t v = 0; v < values; ++v)
+    for(size_t c = count[v]; c > 0; --c, ++i)
+      if(width == 1) a8[i] = v ^ flip;
+      else a16[i] = v ^ flip;
+  free(count);
+  return;
+}
+
+/* Sort n integers of width 1, 2, 4 or 8 */
+void list_integer_sort(void * a, size_t n, int width, int is_signed,
+                       int (* compare) (const void *, const void *))
+{
+  if(width <= 2 && n >= ((size_t) 1 << 8*width)/16)
+    list_counting_sort(a, n, width, is_signed);
+  else if(width >= 4 && n >= LIST_RADIX_MIN)
+    radix_sort(a, n, width, is_signed ? RADIX_INT : RADIX_UINT);
+  else qsort(a, n, width, compare);
+  return;
+}
+
+# define LIST_INTEGER_FUNCTIONS(name, T, S, T_MIN, T_MAX, SIGNED, TYPE) \
+void name##_list_alloc(struct name##_list * list, int n) \
+{ \
+  list->size = list->n = n; \
+  list->element = calloc(n, sizeof(T)); \
+  list->mode = list->at = 0; \
+  list->storage.owner = LIST_OWNED; \
+  return; \
+} \
+\
+T name##_list_set(struct name##_list * list, int i, T val) \
+{return list->element[list_index(list, i)] = val;} \
+\
+T name##_read(struct name##_list * list, int i) \
+{return list->element[list_index(list, i)];} \
+\
+T name##_list_pop(struct name##_list * list, int i) \
+{ \
+  T val = list->element[list_index(list, i)]; \
+  list_close(list->element, list->size, &list->at, list->n, list->mode, i, \
+             sizeof(T)); \
+  (list->n)--; \
+  return val; \
+} \
+\
+T name##_list_push(struct name##_list * list, int i, T val) \
+{ \
+  list->element = list_open(list->element, &list->storage, &list->size, \
+                            &list->at, list->n, list->mode, i, sizeof(T)); \
+  (list->n)++; \
+  list->element[list_index(list, i)] = val; \
+  return val; \
+} \
+\
+T name##_list_append(struct name##_list * list, T val) \
+{ \
+  if(list->mode) return name##_list_push(list, list->n, val); \
+  if(list->n == list->size) \
+    list->element = list_grow(list->element, &list->storage, &list->size, \
+                              list->n + 1, sizeof(T)); \
+  return list->element[(list->n)++] = val; \
+} \
+\
+void name##_list_reserve(struct name##_list * list, int n) \
+{ \
+  if(n > list->size) \
+    list->element = list_expand(list->element, &list->storage, &list->size, \
+                                &list->at, list->n, list->mode, n, sizeof(T)); \
+  return; \
+} \
+\
+void name##_list_shrink(struct name##_list * list) \
+{ \
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode, \
+                 sizeof(T)); \
+  list->element = list_fit(list->element, &list->storage, &list->size, \
+                           list->n, sizeof(T)); \
+  return; \
+} \
+\
+void name##_list_mode(struct name##_list * list, enum list_mode mode) \
+{ \
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode, \
+                 sizeof(T)); \
+  list->mode = mode; \
+  list->at = mode == LIST_GAP ? list->n : 0; \
+  return; \
+} \
+\
+int name##_compare(const void * a, const void * b) \
+{ \
+  T x = * (const T *) a, y = * (const T *) b; \
+  return (x > y) - (x < y); \
+} \
+\
+void name##_list_sort(struct name##_list * list) \
+{ \
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode, \
+                 sizeof(T)); \
+  list_integer_sort(list->element, list->n, sizeof(T), SIGNED, \
+                    name##_compare); \
+  return; \
+} \
+\
+S name##_array_sum(const T * a, int n) \
+{ \
+  S s[LIST_LANES] = {0}, sum = 0; \
+  int i = 0; \
+  for(; i + LIST_LANES <= n; i += LIST_LANES) \
+    for(int l = 0; l < LIST_LANES; ++l) s[l] += a[i + l]; \
+  for(; i < n; ++i) sum += a[i]; \
+  for(int l = 0; l < LIST_LANES; ++l) sum += s[l]; \
+  return sum; \
+} \
+\
+void name##_array_minmax(const T * a, int n, T * lo, T * hi) \
+{ \
+  T l_lo[LIST_LANES], l_hi[LIST_LANES]; \
+  int i = 0; \
+  for(int l = 0; l < LIST_LANES; ++l) l_lo[l] = *lo, l_hi[l] = *hi; \
+  for(; i + LIST_LANES <= n; i += LIST_LANES) \
+    for(int l = 0; l < LIST_LANES; ++l) { \
+      l_lo[l] = a[i + l] < l_lo[l] ? a[i + l] : l_lo[l]; \
+      l_hi[l] = a[i + l] > l_hi[l] ? a[i + l] : l_hi[l]; \
+    } \
+  for(; i < n; ++i) { \
+    if(a[i] < *lo) *lo = a[i]; \
+    if(a[i] > *hi) *hi = a[i]; \
+  } \
+  for(int l = 0; l < LIST_LANES; ++l) { \
+    if(l_lo[l] < *lo) *lo = l_lo[l]; \
+    if(l_hi[l] > *hi) *hi = l_hi[l]; \
+  } \
+  return; \
+} \
+\
+int name##_array_find(const T * a, int n, T val) \
+{ \
+  int i = 0; \
+  for(; i + LIST_LANES <= n; i += LIST_LANES) { \
+    int hit = 0; \
+    for(int l = 0; l < LIST_LANES; ++l) hit |= a[i + l] == val; \
+    if(hit) break; \
+  } \
+  for(; i < n; ++i) if(a[i] == val) return i; \
+  return -1; \
+} \
+\
+int name##_array_count(const T * a, int n, T val) \
+{ \
+  int c[LIST_LANES] = {0}, i = 0, count = 0; \
+  for(; i + LIST_LANES <= n; i += LIST_LANES) \
+    for(int l = 0; l < LIST_LANES; ++l) c[l] += a[i + l] == val; \
+  for(; i < n; ++i) count += a[i] == val; \
+  for(int l = 0; l < LIST_LANES; ++l) count += c[l]; \
+  return count; \
+} \
+\
+S name##_list_sum(struct name##_list * list) \
+{ \
+  int start[2], count[2]; \
+  list_runs(list, start, count); \
+  return name##_array_sum(list->element + start[0], count[0]) \
+         + name##_array_sum(list->element + start[1], count[1]); \
+} \
+\
+void name##_list_minmax(struct name##_list * list, T * lo, T * hi) \
+{ \
+  int start[2], count[2]; \
+  list_runs(list, start, count); \
+  *lo = T_MAX; \
+  *hi = T_MIN; \
+  name##_array_minmax(list->element + start[0], count[0], lo, hi); \
+  name##_array_minmax(list->element + start[1], count[1], lo, hi); \
+  if(!list->n) *lo = *hi = 0; \
+  return; \
+} \
+\
+T name##_list_min(struct name##_list * list) \
+{T lo, hi; name##_list_minmax(list, &lo, &hi); return lo;} \
+\
+T name##_list_max(struct name##_list * list) \
+{T lo, hi; name##_list_minmax(list, &lo, &hi); return hi;} \
+\
+int name##_list_find(struct name##_list * list, T val) \
+{ \
+  int start[2], count[2]; \
+  list_runs(list, start, count); \
+  int i = name##_array_find(list->element + start[0], count[0], val); \
+  if(i < 0 && (i = name##_array_find(list->element + start[1], count[1], \
+                                     val)) >= 0) i += count[0]; \
+  return i; \
+} \
+\
+int name##_list_count(struct name##_list * list, T val) \
+{ \
+  int start[2], count[2]; \
+  list_runs(list, start, count); \
+  return name##_array_count(list->element + start[0], count[0], val) \
+         + name##_array_count(list->element + start[1], count[1], val); \
+} \
+\
+int name##_array_lower_bound(const T * a, int n, T val) \
+{ \
+  if(n == 0) return 0; \
+  const T * base = a; \
+  while(n > 1) { \
+    const int half = n/2; \
+    base = base[half] < val ? base + half : base; \
+    n -= half; \
+  } \
+  return base - a + (*base < val); \
+} \
+\
+int name##_list_lower_bound(struct name##_list * list, T val) \
+{ \
+  int start[2], count[2]; \
+  list_runs(list, start, count); \
+  int i = name##_array_lower_bound(list->element + start[0], count[0], val); \
+  if(i == count[0]) \
+    i += name##_array_lower_bound(list->element + start[1], count[1], val); \
+  return i; \
+} \
+\
+int name##_list_bsearch(struct name##_list * list, T val) \
+{ \
+  int i = name##_list_lower_bound(list, val); \
+  return i < list->n && name##_read(list, i) == val ? i : -1; \
+} \
+\
+int name##_list_insert_sorted(struct name##_list * list, T val) \
+{ \
+  int i = name##_list_lower_bound(list, val); \
+  name##_list_push(list, i, val); \
+  return i; \
+} \
+\
+int name##_list_unique(struct name##_list * list) \
+{ \
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode, \
+                 sizeof(T)); \
+  list->n = list_unique_array(list->element, list->n, sizeof(T), NULL); \
+  if(list->mode == LIST_GAP) list->at = list->n; \
+  return list->n; \
+} \
+\
+void name##_list_merge(struct name##_list * list, \
+                       struct name##_list ** part, int k) \
+{ \
+  char ** e = malloc(k*sizeof(char *) + 1); \
+  int * length = malloc(k*sizeof(int) + 1), n = 0; \
+  for(int t = 0; t < k; ++t) { \
+    list_linearize(part[t]->element, part[t]->size, &part[t]->at, \
+                   part[t]->n, part[t]->mode, sizeof(T)); \
+    e[t] = (char *) part[t]->element; \
+    n += length[t] = part[t]->n; \
+  } \
+  list->element = list_merge_arrays(list->element, &list->storage, e, length, \
+                                    k, sizeof(T), name##_compare); \
+  list->n = list->size = n; \
+  list->at = list->mode == LIST_GAP ? n : 0; \
+  free(e); \
+  free(length); \
+  return; \
+} \
+\
+void name##_list_insert_range(struct name##_list * list, int i, \
+                              const T * src, int k) \
+{ \
+  list->element = list_open_range(list->element, &list->storage, &list->size, \
+                                  &list->at, list->n, list->mode, i, k, \
+                                  sizeof(T)); \
+  memcpy(list->element + i, src, k*sizeof(T)); \
+  list->n += k; \
+  return; \
+} \
+\
+void name##_list_extend(struct name##_list * list, const T * src, int k) \
+{name##_list_insert_range(list, list->n, src, k); return;} \
+\
+void name##_list_erase_range(struct name##_list * list, int i, int k) \
+{ \
+  list_close_range(list->element, list->size, &list->at, list->n, \
+                   list->mode, i, k, sizeof(T)); \
+  list->n -= k; \
+  return; \
+} \
+\
+void name##_list_slice(struct name##_list * list, \
+                       struct name##_list * dest, int i, int k) \
+{ \
+  dest->element = list_clear_for(dest->element, &dest->storage, &dest->size, \
+                                 &dest->n, &dest->at, dest->mode, k, \
+                                 sizeof(T)); \
+  list_copy_range(dest->element, list->element, list->size, list->at, \
+                  list->n, list->mode, i, k, sizeof(T)); \
+  dest->n = k; \
+  if(dest->mode == LIST_GAP) dest->at = k; \
+  return; \
+} \
+\
+void name##_list_fill(struct name##_list * list, int i, int k, T val) \
+{ \
+  int start[2], count[2]; \
+  list_range(list, i, k, start, count); \
+  for(int r = 0; r < 2; ++r) \
+    for(int j = start[r]; j < start[r] + count[r]; ++j) \
+      list->element[j] = val; \
+  return; \
+} \
+\
+void * name##_list_save(struct name##_list * list, const char * path) \
+{ \
+  int start[2], count[2]; \
+  list_runs(list, start, count); \
+  return list_save_runs(path, TYPE, sizeof(T), list->element, start, \
+                        count) ? list : NULL; \
+} \
+\
+void * name##_list_map(struct name##_list * list, const char * path, \
+                       enum list_map_mode how) \
+{ \
+  T * e = list_map_file(path, TYPE, sizeof(T), how, &list->n, \
+                        &list->storage); \
+  if(!e) return NULL; \
+  list->element = e; \
+  list->size = list->n; \
+  list->mode = list->at = 0; \
+  return list; \
+} \
+\
+void name##_free(struct name##_list * list) \
+{list_release(list->element, &list->storage); return;}
+
+LIST_INTEGER_FUNCTIONS(int8, int8_t, int64_t, INT8_MIN, INT8_MAX, 1,
+                       LIST_TYPE_INT8)
+LIST_INTEGER_FUNCTIONS(uint8, uint8_t, uint64_t, 0, UINT8_MAX, 0,
+                       LIST_TYPE_UINT8)
+LIST_INTEGER_FUNCTIONS(int16, int16_t, int64_t, INT16_MIN, INT16_MAX, 1,
+                       LIST_TYPE_INT16)
+LIST_INTEGER_FUNCTIONS(uint16, uint16_t, uint64_t, 0, UINT16_MAX, 0,
+                       LIST_TYPE_UINT16)
+LIST_INTEGER_FUNCTIONS(uint32, uint32_t, uint64_t, 0, UINT32_MAX, 0,
+                       LIST_TYPE_UINT32)
+LIST_INTEGER_FUNCTIONS(int64, int64_t, int64_t, INT64_MIN, INT64_MAX, 1,
+                       LIST_TYPE_INT64)
+LIST_INTEGER_FUNCTIONS(uint64, uint64_t, uint64_t, 0, UINT64_MAX, 0,
+                       LIST_TYPE_UINT64)
+
+/* Pack the values in the tail as a new block */
+void packed_list_pack(struct packed_list * list)
+{
+  const int64_t * v = list->tail;
+  int64_t lo = v[0], hi = v[0];
+  for(int i = 1; i < PACKED_BLOCK; ++i) {
+    if(v[i] < lo) lo = v[i];
+    if(v[i] > hi) hi = v[i];
+  }
+  const uint64_t range = (uint64_t) hi - (uint64_t) lo;
+  int b = 0;
+  while(b < 64 && range >> b) b++;
+  const int words = (PACKED_BLOCK*b + 63)/64;
+  list->block = list_grow(list->block, NULL, &list->block_size,
+                          list->nblocks + 1, sizeof(struct packed_block));
+  list->word = list_grow(list->word, NULL, &list->word_size,
+                         list->nwords + words + 2, sizeof(uint64_t));
+  uint64_t * w = list->word + list->nwords;
+  memset(w, 0, (words + 2)*sizeof(uint64_t));
+  for(int i = 0; i < PACKED_BLOCK; ++i) {
+    const uint64_t u = (uint64_t) v[i] - (uint64_t) lo;
+    const int p = i*b, s = p % 64;
+    w[p/64] |= u << s;
+    if(s + b > 64) w[p/64 + 1] |= u >> (64 - s);
+  }
+  struct packed_block * block = list->block + list->nblocks++;
+  block->base = lo;
+  block->width = b;
+  block->offset = list->nwords;
+  list->nwords += words;
+  return;
+}
+
+int64_t packed_list_append(struct packed_list * list, int64_t val)
+{
+  list->tail[list->n++ % PACKED_BLOCK] = val;
+  if(list->n % PACKED_BLOCK == 0) packed_list_pack(list);
+  return val;
+}
+
+/* Append the k values of src, a tail at a time */
+void packed_list_extend(struct packed_list * list, const int64_t * src, int k)
+{
+  while(k > 0) {
+    const int j = list->n % PACKED_BLOCK;
+    const int m = k < PACKED_BLOCK - j ? k : PACKED_BLOCK - j;
+    memcpy(list->tail + j, src, m*sizeof(int64_t));
+    list->n += m;
+    if(list->n % PACKED_BLOCK == 0) packed_list_pack(list);
+    src += m;
+    k -= m;
+  }
+  return;
+}
+
+void packed_list_alloc(struct packed_list * list, int n)
+{
+  memset(list, 0, sizeof(struct packed_list));
+  for(int i = 0; i < n; ++i) packed_list_append(list, 0);
+  return;
+}
+
+/* Value j of block k */
+int64_t packed_block_read(const struct packed_list * list, int k, int j)
+{
+  const struct packed_block * block = list->block + k;
+  const int p = j*block->width, s = p % 64;
+  const uint64_t * w = list->word + block->offset + p/64;
+  uint64_t u = w[0] >> s | w[1] << 1 << (63 - s);
+  if(block->width < 64) u &= ((uint64_t) 1 << block->width) - 1;
+  return (int64_t) ((uint64_t) block->base + u);
+}
+
+int64_t packed_read(struct packed_list * list, int i)
+{
+  const int k = i/PACKED_BLOCK;
+  if(k == list->nblocks) return list->tail[i % PACKED_BLOCK];
+  return packed_block_read(list, k, i % PACKED_BLOCK);
+}
+
+/* Unpack the count values from i on into out */
+void packed_list_decode(const struct packed_list * list, int i, int count,
+                        int64_t * out)
+{
+  for(int end = i + count; i < end; ++i, ++out) {
+    const int k = i/PACKED_BLOCK;
+    *out = k == list->nblocks ? list->tail[i % PACKED_BLOCK]
+                              : packed_block_read(list, k, i % PACKED_BLOCK);
+  }
+  return;
+}
+
+int64_t packed_list_sum(struct packed_list * list)
+{
+  uint64_t sum = 0;
+  for(int k = 0; k < list->nblocks; ++k)
+    for(int j = 0; j < PACKED_BLOCK; ++j)
+      sum += (uint64_t) packed_block_read(list, k, j);
+  for(int i = list->nblocks*PACKED_BLOCK; i < list->n; ++i)
+    sum += (uint64_t) list->tail[i % PACKED_BLOCK];
+  return (int64_t) sum;
+}
+
+/* Memory taken by a packed list, in bytes */
+size_t packed_list_bytes(const struct packed_list * list)
+{
+  return sizeof(struct packed_list)
+         + list->block_size*sizeof(struct packed_block)
+         + list->word_size*sizeof(uint64_t);
+}
+
+void packed_free(struct packed_list * list)
+{
+  free(list->block);
+  free(list->word);
+  return;
+}
+
+# define list_free(list) \
+  _Generic((list), \
+            struct int_list *: int_free, \
+            struct int8_list *: int8_free, \
+            struct uint8_list *: uint8_free, \
+            struct int16_list *: int16_free, \
+            struct uint16_list *: uint16_free, \
+            struct uint32_list *: uint32_free, \
+            struct int64_list *: int64_free, \
+            struct uint64_list *: uint64_free, \
+            struct float_list *: float_free, \
+            struct double_list *: double_free, \
+            struct char_list *: char_free, \
+            struct string_list *: string_free, \
+            struct obj_list *: obj_free, \
+            struct packed_list *: packed_free, \
+            default: null_function)(list)
+
+void int_free(struct int_list * list)
+{list_release(list->element, &list->storage); return;}
+void float_free(struct float_list * list)
+{list_release(list->element, &list->storage); return;}
+void double_free(struct double_list * list)
+{list_release(list->element, &list->storage); return;}
+void char_free(struct char_list * list)
+{list_release(list->element, &list->storage); return;}
+void string_free(struct string_list * list)
+{
+  free(list->element);
+  string_pool_free(list->pool);
+  return;
+}
 void obj_free(struct obj_list * list) {free(list->element); return;}
 
 # endif
@@ -0,0 +1,301 @@
+# ifndef MAPPED_MATRIX_H
+# define MAPPED_MATRIX_H
+# include <stdio.h>
+# include <stdlib.h>
+# include <stdarg.h>
+# include <stdint.h>
+# include <string.h>
+# include <limits.h>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <sys/uio.h>
+# include "object.h"
+# include "matrix.h"
+
+# ifndef IOV_MAX
+# define IOV_MAX 1024
+# endif
+
+/*** Mapped matrix object definition ***/
+# define MAPPED_MATRIX_MAGIC "OOCMAT1"
+# define MAPPED_MATRIX_HEADER 64
+
+struct mapped_matrix_header {
+  char magic[8];
+  int32_t rows, cols;
+  int32_t precision; /* sizeof(real) */
+  char unused[MAPPED_MATRIX_HEADER - 20];
+};
+
+typedef enum {MAPPED_READ_ONLY = 0, MAPPED_READ_WRITE, MAPPED_COPY_ON_WRITE}
+  mapped_mode;
+
+struct mapped_matrix {
+  const struct matrix_view _; /* This item must come first */
+  int fd; /* File descriptor (-1 if not mapped) */
+  void * map; /* Start of the mapping (the header) */
+  size_t map_size;
+  mapped_mode mode;
+};
+
+static void * mapped_matrix_constructor(void * _self, va_list * args);
+static void * mapped_matrix_destructor(void * _self);
+static void * mapped_matrix_display(const void * _self, FILE * fp);
+
+static const Class _mapped_matrix
+  = {sizeof(struct mapped_matrix), "mapped matrix", &_matrix_view,
+     mapped_matrix_constructor, mapped_matrix_destructor};
+
+const void * mapped_matrix = &_mapped_matrix;
+
+/*** Mapped matrix operations ***/
+int mapped_matrix_open(void * _self, const char * path, mapped_mode mode);
+void * mapped_matrix_create(const char * path, int rows, int cols);
+void * matrix_to_file(const void * _A, const char * path);
+void mapped_matrix_advise(const void * _A, int first_row, int nrows,
+                          int advice);
+void * mapped_matrix_dot(const void * _A, const void * _B, const char * path);
+
+/*** Function definitions ***/
+static void * mapped_matrix_constructor(void * _self, va_list * args)
+{
+  const char * path = va_arg(*args, const char *);
+  mapped_mode mode = MAPPED_READ_ONLY;
+  if(path) mode = va_arg(*args, mapped_mode);
+
+  struct abstract_object * obj = matrix_constructor(_self, args);
+  obj->display = mapped_matrix_display;
+  struct matrix_view * vself = _self;
+  vself->parent = NULL;
+  vself->offset = MAPPED_MATRIX_HEADER/sizeof(real);
+
+  struct mapped_matrix * self = _self;
+  self->fd = -1;
+  self->map = NULL;
+  self->map_size = 0;
+  self->mode = mode;
+
+  if(path) mapped_matrix_open(_self, path, mode);
+
+  return _self;
+}
+
+static void * mapped_matrix_destructor(void * _self)
+{
+  struct mapped_matrix * self = _self;
+  if(self->map) munmap(self->map, self->map_size);
+  if(self->fd >= 0) close(self->fd);
+  return NULL;
+}
+
+static void * mapped_matrix_display(const void * _self, FILE * fp)
+{
+  matrix_display(_self, fp);
+
+  if(inherits_from(_self, mapped_matrix)) {
+    const struct mapped_matrix * self = _self;
+    fprintf(fp, "Mapped bytes: %lu\n", (unsigned long int) self->map_size);
+    fprintf(fp, "Mode: %s\n", self->mode == MAPPED_READ_WRITE ? "read-write" :
+            self->mode == MAPPED_COPY_ON_WRITE ? "copy-on-write" : "read-only");
+  }
+  return NULL;
+}
+
+int mapped_matrix_open(void * _self, const char * path, mapped_mode mode)
+{
+  if(!inherits_from(_self, mapped_matrix)) return 0;
+  struct mapped_matrix * self = _self;
+  struct matrix * mself = _self;
+
+  int fd = open(path, mode == MAPPED_READ_WRITE ? O_RDWR : O_RDONLY);
+  if(fd < 0) {
+    fprintf(stderr, "Error: mapped_matrix: unable to open %s.\n", path);
+    return 0;
+  }
+
+  struct mapped_matrix_header header;
+  struct stat st;
+  if(fstat(fd, &st) || read(fd, &header, sizeof(header)) != sizeof(header)
+     || strncmp(header.magic, MAPPED_MATRIX_MAGIC, 8)
+     || header.precision != sizeof(real) || header.rows < 0 || header.cols < 0
+     || (size_t) st.st_size < MAPPED_MATRIX_HEADER
+                              + (size_t) header.rows*header.cols*sizeof(real)) {
+    fprintf(stderr, "Error: mapped_matrix: %s is not a matrix file.\n", path);
+    close(fd);
+    return 0;
+  }
+
+  size_t size = MAPPED_MATRIX_HEADER
+                + (size_t) header.rows*header.cols*sizeof(real);
+  int prot = mode == MAPPED_READ_ONLY ? PROT_READ : PROT_READ | PROT_WRITE;
+  int flags = mode == MAPPED_READ_WRITE ? MAP_SHARED : MAP_PRIVATE;
+  void * map = mmap(NULL, size, prot, flags, fd, 0);
+  if(map == MAP_FAILED) {
+    fprintf(stderr, "Error: mapped_matrix: unable to map %s.\n", path);
+    close(fd);
+    return 0;
+  }
+
+  /* Forget any previous mapping */
+  if(self->map) munmap(self->map, self->map_size);
+  if(self->fd >= 0) close(self->fd);
+
+  self->fd = fd;
+  self->map = map;
+  self->map_size = size;
+  self->mode = mode;
+  mself->rows = header.rows;
+  mself->cols = header.cols;
+  mself->ld = header.cols;
+  mself->dat = (real *) ((char *) map + MAPPED_MATRIX_HEADER);
+  return 1;
+}
+
+void mapped_matrix_header_init(struct mapped_matrix_header * header,
+                               int rows, int cols)
+{
+  memset(header, 0, sizeof(*header));
+  memcpy(header->magic, MAPPED_MATRIX_MAGIC, 8);
+  header->rows = rows;
+  header->cols = cols;
+  header->precision = sizeof(real);
+  return;
+}
+
+void * mapped_matrix_create(const char * path, int rows, int cols)
+{
+  struct mapped_matrix_header header;
+  mapped_matrix_header_init(&header, rows, cols);
+  int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if(fd < 0 || write(fd, &header, sizeof(header)) != sizeof(header)
+     || ftruncate(fd, MAPPED_MATRIX_HEADER
+                      + (off_t) rows*cols*sizeof(real))) {
+    fprintf(stderr, "Error: mapped_matrix: unable to create %s.\n", path);
+    if(fd >= 0) close(fd);
+    return NULL;
+  }
+  close(fd);
+
+  new(M, mapped_matrix, path, MAPPED_READ_WRITE);
+  return M;
+}
+
+void * matrix_to_file(const void * _A, const char * path)
+{
+  const struct matrix * A = _A;
+  if(!inherits_from(A, matrix)) return NULL;
+
+  struct mapped_matrix_header header;
+  mapped_matrix_header_init(&header, A->rows, A->cols);
+  int contiguous = A->ld == A->cols || A->rows <= 1;
+  int niov = 1 + (contiguous ? 1 : A->rows);
+  struct iovec * iov = malloc(niov*sizeof(struct iovec));
+  iov[0] = (struct iovec) {&header, sizeof(header)};
+  if(contiguous) {
+    iov[1] = (struct iovec) {A->dat, (size_t) A->rows*A->cols*sizeof(real)};
+  } else {
+    for(int i = 0; i < A->rows; ++i)
+      iov[1 + i] = (struct iovec) {A->dat + (long int) A->ld*i,
+                                   A->cols*sizeof(real)};
+  }
+
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  int ok = fd >= 0;
+  for(int first = 0; ok && first < niov; first += IOV_MAX) {
+    int count = niov - first < IOV_MAX ? niov - first : IOV_MAX;
+    ssize_t expected = 0;
+    for(int i = first; i < first + count; ++i) expected += iov[i].iov_len;
+    ok = writev(fd, iov + first, count) == expected;
+  }
+  free(iov);
+  if(fd >= 0) close(fd);
+  if(!ok) {
+    fprintf(stderr, "Error: mapped_matrix: unable to write %s.\n", path);
+    return NULL;
+  }
+
+  new(M, mapped_matrix, path, MAPPED_READ_WRITE);
+  return M;
+}
+
+# ifndef MAPPED_TILE_BYTES
+# define MAPPED_TILE_BYTES 67108864 /* 64 MB */
+# endif
+
+void mapped_matrix_advise(const void * _A, int first_row, int nrows,
+                          int advice)
+{
+  const struct matrix * A = _A;
+  if(!inherits_from(A, mapped_matrix) || nrows <= 0 || first_row >= A->rows)
+    return;
+  if(first_row + nrows > A->rows) nrows = A->rows - first_row;
+  const struct mapped_matrix * self = _A;
+  if(advice == MADV_DONTNEED && self->mode == MAPPED_COPY_ON_WRITE) {
+# ifdef MADV_COLD
+    advice = MADV_COLD;
+# else
+    return;
+# endif
+  }
+
+  const size_t page = sysconf(_SC_PAGESIZE);
+  char * start = (char *) (A->dat + (long int) A->ld*first_row);
+  char * end = (char *) (A->dat + (long int) A->ld*(first_row + nrows));
+  char * first_page = (char *) ((size_t) start/page*page);
+  if(advice == MADV_DONTNEED) {
+    /* Only release pages that lie entirely inside the band */
+    first_page = (char *) (((size_t) start + page - 1)/page*page);
+    end = (char *) ((size_t) end/page*page);
+  }
+  if(end > first_page) madvise(first_page, end - first_page, advice);
+  return;
+}
+
+void * mapped_matrix_dot(const void * _A, const void * _B, const char * path)
+{
+  const struct matrix * A = _A;
+  const struct matrix * B = _B;
+  if(!inherits_from(A, matrix) || !inherits_from(B, matrix)
+     || A->cols != B->rows)
+    return NULL;
+
+  struct matrix * C;
+  if(path) {
+    C = mapped_matrix_create(path, A->rows, B->cols);
+    if(C == NULL || C->dat == NULL) return NULL;
+  } else {
+    new(M, matrix);
+    matrix_set_dim(M, A->rows, B->cols);
+    C = M;
+  }
+
+  const int m = A->rows, n = B->cols, k = A->cols;
+  size_t row_bytes = (size_t) (n > k ? n : k)*sizeof(real);
+  int band = row_bytes > 0 ? MAPPED_TILE_BYTES/row_bytes : 1;
+  if(band < 1) band = 1;
+
+  for(int ib = 0; ib < m; ib += band) {
+    const int mb = m - ib < band ? m - ib : band;
+    mapped_matrix_advise(A, ib, mb, MADV_WILLNEED);
+    mapped_matrix_advise(B, 0, band, MADV_WILLNEED);
+    for(int pb = 0; pb < k; pb += band) {
+      const int kb = k - pb < band ? k - pb : band;
+      mapped_matrix_advise(B, pb + kb, band, MADV_WILLNEED); /* Read ahead */
+      matrix_gemm(mb, n, kb, 1, A->dat + (long int) A->ld*ib + pb, A->ld,
+                  B->dat + (long int) B->ld*pb, B->ld,
+                  1, C->dat + (long int) C->ld*ib, C->ld);
+      mapped_matrix_advise(B, pb, kb, MADV_DONTNEED);
+    }
+    mapped_matrix_advise(A, ib, mb, MADV_DONTNEED);
+    if(path) {
+      const struct mapped_matrix * mC = (struct mapped_matrix *) C;
+      msync(mC->map, mC->map_size, MS_ASYNC);
+      mapped_matrix_advise(C, ib, mb, MADV_DONTNEED);
+    }
+  }
+
+  return C;
+}
+# endif
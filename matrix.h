@@ -3,21 +3,29 @@
 # include <stdio.h>
 # include <stdlib.h>
 # include <stdarg.h>
+# include <string.h>
 # include <math.h>
+# include <pthread.h>
+# include <unistd.h>
 # include "object.h"
 # include "vector.h" /* We want to enable matrix times vector */
+# include "list.h" /* And to hand arrays over to and from lists */
+# include "iterator.h" /* And to go through blocks, rows and columns */
 
 /*** Matrix object definition ***/
 struct matrix {
   const struct abstract_object _; /* This item must come first */
   int rows, cols; /* Dimensionality */
   real * dat;
+  int ld; /* Leading dimension: element (i, j) is dat[ld*i + j] */
 };
 
 static void * matrix_constructor(void * _self, va_list * args);
 static void * matrix_destructor(void * _self);
 static void * matrix_clone(const void * _self);
 static void * matrix_display(const void * _self, FILE * fp);
+int matrix_differs(void * _a, void * _b);
+size_t matrix_hash(const void * _self);
 
 static const Class _matrix
   = {sizeof(struct matrix), "matrix", &_abstract_object,
@@ -33,19 +41,73 @@ void * matrix_add(const void * _A, const void * _B);
 void * matrix_subtract(const void * _A, const void * _B);
 void * matrix_prod(const real lambda, const void * _M);
 void * matrix_dot(const void * _A, const void * _B);
+void matrix_gemm(int m, int n, int k, real alpha, const real * A, int lda,
+                 const real * B, int ldb, real beta, real * C, int ldc);
 void * matrix_transpose(const void * _A);
 
 
+/*** Matrix view definition ***/
+struct matrix_view {
+  const struct matrix _; /* This item must come first */
+  const struct matrix * parent;
+  long int offset; /* Position of element (0, 0) in parent->dat */
+};
+
+static void * matrix_view_constructor(void * _self, va_list * args);
+static void * matrix_view_destructor(void * _self);
+static void * matrix_view_display(const void * _self, FILE * fp);
+
+static const Class _matrix_view
+  = {sizeof(struct matrix_view), "matrix view", &_matrix,
+     matrix_view_constructor, matrix_view_destructor};
+
+const void * matrix_view = &_matrix_view;
+
+/*** Sparse (compressed sparse row) matrix definition ***/
+struct csr_matrix {
+  const struct abstract_object _; /* This item must come first */
+  int rows, cols; /* Dimensionality */
+  int nnz; /* Number of stored (non-zero) elements */
+  int * row_ptr; /* rows + 1 offsets into col and val */
+  int * col;
+  real * val;
+};
+
+static void * csr_matrix_constructor(void * _self, va_list * args);
+static void * csr_matrix_destructor(void * _self);
+static void * csr_matrix_clone(const void * _self);
+static void * csr_matrix_display(const void * _self, FILE * fp);
+
+static const Class _csr_matrix
+  = {sizeof(struct csr_matrix), "csr matrix", &_abstract_object,
+     csr_matrix_constructor, csr_matrix_destructor};
+
+const void * csr_matrix = &_csr_matrix;
+
+/*** Sparse matrix operations ***/
+void * csr_from_triplets(int rows, int cols, int n, const int * row,
+                         const int * col, const real * val);
+void * csr_from_matrix(const void * _A);
+void * csr_to_matrix(const void * _S);
+void * csr_transpose(const void * _S);
+void csr_spmv(const void * _S, const real * x, real * y);
+void * csr_dot(const void * _S, const void * _B);
+void * matrix_csr_dot(const void * _A, const void * _S);
+
+
 /*** Function definitions ***/
 static void * matrix_constructor(void * _self, va_list * args)
 {
   struct abstract_object * obj =  abstract_object_constructor(_self, args);
+  obj->differs = matrix_differs;
+  obj->hash = matrix_hash;
   obj->clone = matrix_clone;
   obj->display = matrix_display;
   struct matrix * self = _self;
   self->rows = 0;
   self->cols = 0;
   self->dat = NULL;
+  self->ld = 0;
   return _self;
 }
 
@@ -63,7 +125,9 @@ static void * matrix_clone(const void * _self)
   if(inherits_from(self, matrix)) {
     new(A, matrix);
     matrix_set_dim(A, self->rows, self->cols);
-    for(int i = 0; i < self->rows*self->cols; ++i) A->dat[i] = self->dat[i];
+    for(int i = 0; i < self->rows; ++i)
+      for(int j = 0; j < self->cols; ++j)
+        A->dat[A->ld*i + j] = self->dat[self->ld*i + j];
     return A;
   }
   return NULL;
@@ -81,18 +145,274 @@ static void * matrix_display(const void * _self, FILE * fp)
   return NULL;
 }
 
+/* Two matrices are the same if they have the same elements */
+int matrix_differs(void * _a, void * _b)
+{
+  const struct matrix * a = _a;
+  const struct matrix * b = _b;
+  if(a == b) return 0;
+  if(!inherits_from(a, matrix) || !inherits_from(b, matrix)) return 1;
+  if(a->rows != b->rows || a->cols != b->cols) return 1;
+  for(int i = 0; i < a->rows; ++i)
+    for(int j = 0; j < a->cols; ++j)
+      if(a->dat[a->ld*i + j] != b->dat[b->ld*i + j]) return 1;
+  return 0;
+}
+
+/* Hash row by row, so that views hash like the matrices they equal */
+size_t matrix_hash(const void * _self)
+{
+  const struct matrix * self = _self;
+  size_t h = hash_mix(((uint64_t) self->rows << 32) ^ self->cols);
+  for(int i = 0; i < self->rows; ++i)
+    h = real_hash(h, self->dat + self->ld*i, self->cols);
+  return h;
+}
+
+static void * matrix_view_constructor(void * _self, va_list * args)
+{
+  struct abstract_object * obj = matrix_constructor(_self, args);
+  obj->display = matrix_view_display;
+  struct matrix_view * self = _self;
+  struct matrix * mself = _self;
+  self->parent = NULL;
+  self->offset = 0;
+
+  const struct matrix * parent = va_arg(*args, const struct matrix *);
+  if(parent && inherits_from(parent, matrix)) {
+    int row = va_arg(*args, int);
+    int col = va_arg(*args, int);
+    int rows = va_arg(*args, int);
+    int cols = va_arg(*args, int);
+    self->parent = parent;
+    mself->ld = parent->ld;
+    if(row >= 0 && col >= 0 && rows >= 0 && cols >= 0
+       && row + rows <= parent->rows && col + cols <= parent->cols) {
+      self->offset = (long int) parent->ld*row + col;
+      mself->rows = rows;
+      mself->cols = cols;
+      mself->dat = parent->dat + self->offset;
+    }
+  }
+
+  return _self;
+}
+
+/* The elements belong to the parent */
+static void * matrix_view_destructor(void * _self)
+{
+  return NULL;
+}
+
+static void * matrix_view_display(const void * _self, FILE * fp)
+{
+  matrix_display(_self, fp);
+
+  if(inherits_from(_self, matrix_view)) {
+    const struct matrix_view * self = _self;
+    const struct matrix * mself = _self;
+    fprintf(fp, "Parent matrix: %p\n", (void *) self->parent);
+    fprintf(fp, "Offset: %ld\n", self->offset);
+    fprintf(fp, "Leading dimension: %d\n", mself->ld);
+  }
+  return NULL;
+}
+
+/*** Iterators over blocks, rows and columns ***/
+struct matrix_iterator {
+  const struct array_iterator _; /* This item must come first */
+};
+
+static void * matrix_iterator_constructor(void * _self, va_list * args);
+
+static const Class _matrix_iterator
+  = {sizeof(struct matrix_iterator), "matrix iterator", &_array_iterator,
+     matrix_iterator_constructor, NULL};
+
+const void * matrix_iterator = &_matrix_iterator;
+
+static void * matrix_iterator_constructor(void * _self, va_list * args)
+{
+  array_iterator_constructor(_self, args);
+  const struct matrix * A = va_arg(*args, const struct matrix *);
+  if(!A || !inherits_from(A, matrix)) return _self;
+  int row = va_arg(*args, int);
+  int col = va_arg(*args, int);
+  int rows = va_arg(*args, int);
+  int cols = va_arg(*args, int);
+  if(row < 0 || col < 0 || rows <= 0 || cols <= 0
+     || row + rows > A->rows || col + cols > A->cols) return _self;
+  real * first = A->dat + (long int) A->ld*row + col;
+  const ptrdiff_t row_step = A->ld*sizeof(real);
+  if(cols == 1)
+    array_iterator_runs(_self, first, row_step, rows, 0, 1, rows);
+  else if(cols == A->ld || rows == 1)
+    array_iterator_runs(_self, first, sizeof(real), rows*cols, 0, 1,
+                        rows*cols);
+  else array_iterator_runs(_self, first, sizeof(real), cols, row_step, rows,
+                           cols);
+  return _self;
+}
+
+/* Iterators over row i and column j */
+void * matrix_row_iterator(const void * _A, int i)
+{
+  const struct matrix * A = _A;
+  if(!inherits_from(_A, matrix)) return NULL;
+  return new_object(matrix_iterator, A, i, 0, 1, A->cols, NULL);
+}
+
+void * matrix_column_iterator(const void * _A, int j)
+{
+  const struct matrix * A = _A;
+  if(!inherits_from(_A, matrix)) return NULL;
+  return new_object(matrix_iterator, A, 0, j, A->rows, 1, NULL);
+}
+
+/*** Fast dense matrix products ***/
+# ifndef MATRIX_MAX_THREADS
+# define MATRIX_MAX_THREADS 64
+# endif
+# ifndef GEMM_MC
+# define GEMM_MC 64
+# endif
+# ifndef GEMM_KC
+# define GEMM_KC 256
+# endif
+# ifndef GEMM_NC
+# define GEMM_NC 1024
+# endif
+# ifndef GEMM_PARALLEL_WORK
+# define GEMM_PARALLEL_WORK 2097152 /* Below m*n*k, use a single thread */
+# endif
+
+/* Number of threads to use for a given amount of work */
+int matrix_threads(long int work, long int grain)
+{
+  if(work < grain) return 1;
+# ifdef MATRIX_THREADS
+  long int nthreads = MATRIX_THREADS;
+# else
+  long int nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+# endif
+  if(nthreads > MATRIX_MAX_THREADS) nthreads = MATRIX_MAX_THREADS;
+  if(nthreads > work/(grain/4)) nthreads = work/(grain/4);
+  return nthreads < 1 ? 1 : (int) nthreads;
+}
+
+struct gemm_task {
+  int m, n, k;
+  real alpha;
+  const real * A; int lda;
+  const real * B; int ldb;
+  real * C; int ldc;
+};
+
+/* C += alpha A B on one band of rows */
+void * gemm_task_run(void * _task)
+{
+  const struct gemm_task * t = _task;
+  const long int lda = t->lda, ldb = t->ldb, ldc = t->ldc;
+
+  for(int jc = 0; jc < t->n; jc += GEMM_NC) {
+    const int nc = t->n - jc < GEMM_NC ? t->n - jc : GEMM_NC;
+    for(int pc = 0; pc < t->k; pc += GEMM_KC) {
+      const int kc = t->k - pc < GEMM_KC ? t->k - pc : GEMM_KC;
+      for(int ic = 0; ic < t->m; ic += GEMM_MC) {
+        const int mc = t->m - ic < GEMM_MC ? t->m - ic : GEMM_MC;
+        int i = ic;
+        /* Four rows of C at a time */
+        for(; i + 4 <= ic + mc; i += 4) {
+          real * restrict c0 = t->C + ldc*i + jc;
+          real * restrict c1 = c0 + ldc;
+          real * restrict c2 = c1 + ldc;
+          real * restrict c3 = c2 + ldc;
+          const real * a0 = t->A + lda*i + pc;
+          for(int p = 0; p < kc; ++p) {
+            const real * restrict b = t->B + ldb*(pc + p) + jc;
+            const real x0 = t->alpha*a0[p];
+            const real x1 = t->alpha*a0[lda + p];
+            const real x2 = t->alpha*a0[2*lda + p];
+            const real x3 = t->alpha*a0[3*lda + p];
+            for(int j = 0; j < nc; ++j) {
+              const real bj = b[j];
+              c0[j] += x0*bj;
+              c1[j] += x1*bj;
+              c2[j] += x2*bj;
+              c3[j] += x3*bj;
+            }
+          }
+        }
+        /* Remaining rows */
+        for(; i < ic + mc; ++i) {
+          real * restrict c = t->C + ldc*i + jc;
+          const real * a = t->A + lda*i + pc;
+          for(int p = 0; p < kc; ++p) {
+            const real * restrict b = t->B + ldb*(pc + p) + jc;
+            const real x = t->alpha*a[p];
+            for(int j = 0; j < nc; ++j) c[j] += x*b[j];
+          }
+        }
+      }
+    }
+  }
+  return NULL;
+}
+
+/* General matrix product on raw arrays: C = alpha A B + beta C, where A is
+   m x k, B is k x n and C is m x n */
+void matrix_gemm(int m, int n, int k, real alpha, const real * A, int lda,
+                 const real * B, int ldb, real beta, real * C, int ldc)
+{
+  if(m <= 0 || n <= 0) return;
+
+  if(beta != 1)
+    for(int i = 0; i < m; ++i)
+      for(int j = 0; j < n; ++j)
+        C[(long int) ldc*i + j] = beta == 0 ? 0 : beta*C[(long int) ldc*i + j];
+  if(k <= 0 || alpha == 0) return;
+
+  struct gemm_task task[MATRIX_MAX_THREADS];
+  pthread_t thread[MATRIX_MAX_THREADS];
+  int nthreads = matrix_threads((long int) m*n*k, GEMM_PARALLEL_WORK);
+  if(nthreads > (m + 3)/4) nthreads = (m + 3)/4;
+
+  /* Split C into bands of rows (multiples of four) */
+  int first = 0;
+  for(int t = 0; t < nthreads; ++t) {
+    int last = t == nthreads - 1 ? m : 4*(((long int) m*(t + 1)/nthreads)/4);
+    if(last < first) last = first;
+    task[t] = (struct gemm_task)
+      {last - first, n, k, alpha, A + (long int) lda*first, lda, B, ldb,
+       C + (long int) ldc*first, ldc};
+    first = last;
+  }
+
+  for(int t = 1; t < nthreads; ++t)
+    if(pthread_create(&thread[t], NULL, gemm_task_run, &task[t])) {
+      gemm_task_run(&task[t]); /* Could not start a thread: do it ourselves */
+      thread[t] = pthread_self();
+    }
+  gemm_task_run(&task[0]);
+  for(int t = 1; t < nthreads; ++t)
+    if(!pthread_equal(thread[t], pthread_self())) pthread_join(thread[t], NULL);
+
+  return;
+}
+
 /* Set dimensions of matrix and allocate memory */
 void matrix_set_dim(void * _self, int rows, int cols)
 {
   struct matrix * self = _self;
-  if(inherits_from(self, matrix)) {
+  if(inherits_from(self, matrix) && !inherits_from(self, matrix_view)) {
     self->rows = rows;
     self->cols = cols;
+    self->ld = cols;
     int dim = rows*cols;
     if(self->dat == NULL)
       self->dat = (real *) calloc(dim, sizeof(real));
     else
-      self->dat = (real *) realloc(self, dim);
+      self->dat = (real *) realloc(self->dat, dim*sizeof(real));
   }
 
   return;
@@ -112,6 +432,163 @@ void * vector_to_matrix(void * _v)
   return NULL;
 }
 
+/*** Handing arrays over between lists, vectors and matrices ***/
+_Static_assert(sizeof(real) == sizeof(double),
+               "lists of doubles can only hand arrays to vectors and matrices "
+               "when real is double");
+
+/* Hand the array of a linearized list over, leaving the list empty */
+real * list_take_elements(struct double_list * list)
+{
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode,
+                 sizeof(double));
+  real * dat = list_detach(list->element, &list->storage,
+                           list->n*sizeof(double));
+  list->element = NULL;
+  list->n = list->size = list->at = 0;
+  return dat;
+}
+
+/* Replace the elements of a list by the n elements of dat, which then belong
+   to the list (LIST_OWNED) or still to a vector or matrix (LIST_BORROWED) */
+void list_give_elements(struct double_list * list, real * dat, int n,
+                        enum list_owner owner)
+{
+  list_release(list->element, &list->storage);
+  list->element = dat;
+  list->storage.owner = owner;
+  list->n = list->size = n;
+  list->at = list->mode == LIST_GAP ? n : 0;
+  return;
+}
+
+void * vector_adopt_list(struct double_list * list)
+{
+  const int n = list->n;
+  new(v, vector);
+  v->dat = list_take_elements(list);
+  v->dim = n;
+  return v;
+}
+
+void * vector_borrow_list(struct double_list * list)
+{
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode,
+                 sizeof(double));
+  new(v, vector_view, list->element, list->n);
+  return v;
+}
+
+void * matrix_adopt_list(struct double_list * list, int rows, int cols)
+{
+  if(rows < 0 || cols < 0 || (long int) rows*cols != list->n) return NULL;
+  new(M, matrix);
+  M->dat = list_take_elements(list);
+  M->rows = rows;
+  M->cols = M->ld = cols;
+  return M;
+}
+
+void * matrix_borrow_list(struct double_list * list, int rows, int cols)
+{
+  if(rows < 0 || cols < 0 || (long int) rows*cols != list->n) return NULL;
+  list_linearize(list->element, list->size, &list->at, list->n, list->mode,
+                 sizeof(double));
+  new(V, matrix_view, NULL);
+  struct matrix * M = (struct matrix *) V;
+  M->dat = list->element;
+  M->rows = rows;
+  M->cols = M->ld = cols;
+  return V;
+}
+
+void * list_adopt_vector(struct double_list * list, void * _v)
+{
+  struct vector * v = _v;
+  if(!inherits_from(v, vector) || inherits_from(v, vector_view)) return NULL;
+  list_give_elements(list, v->dat, v->dim, LIST_OWNED);
+  v->dat = NULL;
+  v->dim = 0;
+  return list;
+}
+
+void * list_borrow_vector(struct double_list * list, void * _v)
+{
+  struct vector * v = _v;
+  if(!inherits_from(v, vector)) return NULL;
+  list_give_elements(list, v->dat, v->dim, LIST_BORROWED);
+  return list;
+}
+
+void * list_adopt_matrix(struct double_list * list, void * _M)
+{
+  struct matrix * M = _M;
+  if(!inherits_from(M, matrix) || inherits_from(M, matrix_view)
+     || M->ld != M->cols) return NULL;
+  list_give_elements(list, M->dat, M->rows*M->cols, LIST_OWNED);
+  M->dat = NULL;
+  M->rows = M->cols = M->ld = 0;
+  return list;
+}
+
+void * list_borrow_matrix(struct double_list * list, void * _M)
+{
+  struct matrix * M = _M;
+  if(!inherits_from(M, matrix) || (M->ld != M->cols && M->rows > 1))
+    return NULL;
+  list_give_elements(list, M->dat, M->rows*M->cols, LIST_BORROWED);
+  return list;
+}
+
+void * matrix_adopt_vector(void * _v, int rows, int cols)
+{
+  struct vector * v = _v;
+  if(!inherits_from(v, vector) || inherits_from(v, vector_view)
+     || rows < 0 || cols < 0 || (long int) rows*cols != v->dim) return NULL;
+  new(M, matrix);
+  M->dat = v->dat;
+  M->rows = rows;
+  M->cols = M->ld = cols;
+  v->dat = NULL;
+  v->dim = 0;
+  return M;
+}
+
+void * matrix_borrow_vector(void * _v, int rows, int cols)
+{
+  struct vector * v = _v;
+  if(!inherits_from(v, vector) || rows < 0 || cols < 0
+     || (long int) rows*cols != v->dim) return NULL;
+  new(V, matrix_view, NULL);
+  struct matrix * M = (struct matrix *) V;
+  M->dat = v->dat;
+  M->rows = rows;
+  M->cols = M->ld = cols;
+  return V;
+}
+
+void * vector_adopt_matrix(void * _M)
+{
+  struct matrix * M = _M;
+  if(!inherits_from(M, matrix) || inherits_from(M, matrix_view)
+     || M->ld != M->cols) return NULL;
+  new(v, vector);
+  v->dat = M->dat;
+  v->dim = M->rows*M->cols;
+  M->dat = NULL;
+  M->rows = M->cols = M->ld = 0;
+  return v;
+}
+
+void * vector_borrow_matrix(void * _M)
+{
+  struct matrix * M = _M;
+  if(!inherits_from(M, matrix) || (M->ld != M->cols && M->rows > 1))
+    return NULL;
+  new(v, vector_view, M->dat, M->rows*M->cols);
+  return v;
+}
+
 /* Formatted print of matrix elements */
 void matrix_print(const void * _self, FILE * fp)
 {
@@ -120,7 +597,7 @@ void matrix_print(const void * _self, FILE * fp)
     for(int i = 0; i < self->rows; ++i) {
       fprintf(fp, "  [ ");
       for(int j = 0; j < self->cols; ++j)
-        fprintf(fp, " % 1.2e ", self->dat[self->cols*i + j]);
+        fprintf(fp, " % 1.2e ", self->dat[self->ld*i + j]);
       fprintf(fp, " ]\n");
     }
   } else fprintf(fp, "[]");
@@ -136,8 +613,9 @@ void * matrix_add(const void * _A, const void * _B)
      && A->rows == B->rows && A->cols == B->cols) {
      new(M, matrix);
      matrix_set_dim(M, A->rows, A->cols);
-     for(int i = 0; i < M->rows*M->cols; ++i)
-       M->dat[i] = A->dat[i] + B->dat[i];
+     for(int i = 0; i < M->rows; ++i)
+       for(int j = 0; j < M->cols; ++j)
+         M->dat[M->ld*i + j] = A->dat[A->ld*i + j] + B->dat[B->ld*i + j];
      return M;
   }
   return NULL;
@@ -152,8 +630,9 @@ void * matrix_subtract(const void * _A, const void * _B)
      && A->rows == B->rows && A->cols == B->cols) {
      new(M, matrix);
      matrix_set_dim(M, A->rows, A->cols);
-     for(int i = 0; i < M->rows*M->cols; ++i)
-       M->dat[i] = A->dat[i] - B->dat[i];
+     for(int i = 0; i < M->rows; ++i)
+       for(int j = 0; j < M->cols; ++j)
+         M->dat[M->ld*i + j] = A->dat[A->ld*i + j] - B->dat[B->ld*i + j];
      return M;
   }
   return NULL;
@@ -166,8 +645,9 @@ void * matrix_prod(const real lambda, const void * _A)
   if(inherits_from(A, matrix)) {
     new(M, matrix);
     matrix_set_dim(M, A->rows, A->cols);
-    for(int i = 0; i < M->rows*M->cols; ++i)
-      M->dat[i] = lambda*A->dat[i];
+    for(int i = 0; i < M->rows; ++i)
+      for(int j = 0; j < M->cols; ++j)
+        M->dat[M->ld*i + j] = lambda*A->dat[A->ld*i + j];
     return M;
   }
   return NULL;
@@ -180,14 +660,16 @@ void * matrix_dot(const void * _A, const void * _B)
   const struct matrix * B = _B;
   const struct vector * u = _B;
 
+  /* Sparse operands have their own kernels */
+  if(inherits_from(A, csr_matrix)) return csr_dot(A, B);
+  if(inherits_from(B, csr_matrix)) return matrix_csr_dot(A, B);
+
   if(inherits_from(A, matrix) && inherits_from(B, matrix)
      && A->cols == B->rows) {
     new(M, matrix);
     matrix_set_dim(M, A->rows, B->cols);
-    for(int i = 0; i < M->rows; ++i)
-      for(int j = 0; j < M->cols; ++j)
-        for(int k = 0; k < A->cols; ++k)
-          M->dat[M->cols*i + j] += A->dat[A->cols*i + k]*B->dat[B->cols*k + j];
+    matrix_gemm(A->rows, B->cols, A->cols, 1, A->dat, A->ld, B->dat, B->ld,
+                0, M->dat, M->ld);
     return M;
   } else if (inherits_from(A, matrix) && inherits_from(u, vector)
              && A->cols == u->dim) {
@@ -195,7 +677,7 @@ void * matrix_dot(const void * _A, const void * _B)
     vector_set_dim(v, A->rows);
     for(int i = 0; i < v->dim; ++i)
       for(int j = 0; j < A->cols; ++j)
-        v->dat[i] += A->dat[A->cols*i + j]*u->dat[j];
+        v->dat[i] += A->dat[A->ld*i + j]*u->dat[j];
     return v;
   }
 
@@ -211,7 +693,335 @@ void * matrix_transpose(const void * _A)
     matrix_set_dim(M, A->cols, A->rows);
     for(int i = 0; i < M->rows; ++i)
       for(int j = 0; j < M->cols; ++j)
-        M->dat[M->cols*i + j] = A->dat[A->cols*j + i];
+        M->dat[M->ld*i + j] = A->dat[A->ld*j + i];
+    return M;
+  }
+  return NULL;
+}
+
+/*** Sparse matrix functions ***/
+static void * csr_matrix_constructor(void * _self, va_list * args)
+{
+  struct abstract_object * obj =  abstract_object_constructor(_self, args);
+  obj->clone = csr_matrix_clone;
+  obj->display = csr_matrix_display;
+  struct csr_matrix * self = _self;
+  self->rows = 0;
+  self->cols = 0;
+  self->nnz = 0;
+  self->row_ptr = calloc(1, sizeof(int));
+  self->col = NULL;
+  self->val = NULL;
+  return _self;
+}
+
+static void * csr_matrix_destructor(void * _self)
+{
+  struct csr_matrix * self = _self;
+  free(self->row_ptr);
+  free(self->col);
+  free(self->val);
+  return NULL;
+}
+
+/* Copy the three CSR arrays */
+static void * csr_matrix_clone(const void * _self)
+{
+  const struct csr_matrix * self = _self;
+  if(inherits_from(self, csr_matrix)) {
+    new(S, csr_matrix);
+    S->rows = self->rows;
+    S->cols = self->cols;
+    S->nnz = self->nnz;
+    S->row_ptr = realloc(S->row_ptr, (self->rows + 1)*sizeof(int));
+    S->col = malloc(self->nnz*sizeof(int));
+    S->val = malloc(self->nnz*sizeof(real));
+    memcpy(S->row_ptr, self->row_ptr, (self->rows + 1)*sizeof(int));
+    memcpy(S->col, self->col, self->nnz*sizeof(int));
+    memcpy(S->val, self->val, self->nnz*sizeof(real));
+    return S;
+  }
+  return NULL;
+}
+
+/* Displaying sparse matrices */
+static void * csr_matrix_display(const void * _self, FILE * fp)
+{
+  abstract_object_display(_self, fp);
+
+  if(inherits_from(_self, csr_matrix)) {
+    const struct csr_matrix * self = _self;
+    fprintf(fp, "dim: %d x %d\n", self->rows, self->cols);
+    fprintf(fp, "non-zero elements: %d\n", self->nnz);
+  }
+  return NULL;
+}
+
+struct csr_entry { int col; real val; };
+
+int csr_entry_compare(const void * a, const void * b)
+{
+  const struct csr_entry * x = a;
+  const struct csr_entry * y = b;
+  return (x->col > y->col) - (x->col < y->col);
+}
+
+void * csr_from_triplets(int rows, int cols, int n, const int * row,
+                         const int * col, const real * val)
+{
+  for(int k = 0; k < n; ++k)
+    if(row[k] < 0 || row[k] >= rows || col[k] < 0 || col[k] >= cols)
+      return NULL;
+
+  /* Bucket the triplets by row */
+  int * start = calloc(rows + 1, sizeof(int));
+  for(int k = 0; k < n; ++k) start[row[k] + 1]++;
+  for(int i = 0; i < rows; ++i) start[i + 1] += start[i];
+  int * cursor = malloc((rows + 1)*sizeof(int));
+  memcpy(cursor, start, (rows + 1)*sizeof(int));
+  struct csr_entry * entry = malloc((n > 0 ? n : 1)*sizeof(struct csr_entry));
+  for(int k = 0; k < n; ++k) {
+    entry[cursor[row[k]]].col = col[k];
+    entry[cursor[row[k]]++].val = val[k];
+  }
+
+  new(S, csr_matrix);
+  S->rows = rows;
+  S->cols = cols;
+  S->row_ptr = realloc(S->row_ptr, (rows + 1)*sizeof(int));
+  S->col = malloc((n > 0 ? n : 1)*sizeof(int));
+  S->val = malloc((n > 0 ? n : 1)*sizeof(real));
+
+  /* Sort every row by column and merge duplicates */
+  int nnz = 0;
+  S->row_ptr[0] = 0;
+  for(int i = 0; i < rows; ++i) {
+    struct csr_entry * first = entry + start[i];
+    int length = start[i + 1] - start[i];
+    if(length > 16) {
+      qsort(first, length, sizeof(struct csr_entry), csr_entry_compare);
+    } else {
+      for(int a = 1; a < length; ++a) {
+        struct csr_entry e = first[a];
+        int b = a - 1;
+        for(; b >= 0 && first[b].col > e.col; --b) first[b + 1] = first[b];
+        first[b + 1] = e;
+      }
+    }
+    for(int a = 0; a < length; ++a) {
+      if(nnz > S->row_ptr[i] && S->col[nnz - 1] == first[a].col) {
+        S->val[nnz - 1] += first[a].val;
+      } else {
+        S->col[nnz] = first[a].col;
+        S->val[nnz++] = first[a].val;
+      }
+    }
+    S->row_ptr[i + 1] = nnz;
+  }
+  S->nnz = nnz;
+
+  free(start);
+  free(cursor);
+  free(entry);
+  return S;
+}
+
+/* Convert a dense matrix to CSR, keeping only its non-zero elements */
+void * csr_from_matrix(const void * _A)
+{
+  const struct matrix * A = _A;
+  if(inherits_from(A, matrix)) {
+    int nnz = 0;
+    for(int i = 0; i < A->rows; ++i)
+      for(int j = 0; j < A->cols; ++j) if(A->dat[A->ld*i + j] != 0) nnz++;
+    new(S, csr_matrix);
+    S->rows = A->rows;
+    S->cols = A->cols;
+    S->nnz = nnz;
+    S->row_ptr = realloc(S->row_ptr, (A->rows + 1)*sizeof(int));
+    S->col = malloc((nnz > 0 ? nnz : 1)*sizeof(int));
+    S->val = malloc((nnz > 0 ? nnz : 1)*sizeof(real));
+    nnz = 0;
+    for(int i = 0; i < A->rows; ++i) {
+      S->row_ptr[i] = nnz;
+      for(int j = 0; j < A->cols; ++j)
+        if(A->dat[A->ld*i + j] != 0) {
+          S->col[nnz] = j;
+          S->val[nnz++] = A->dat[A->ld*i + j];
+        }
+    }
+    S->row_ptr[A->rows] = nnz;
+    return S;
+  }
+  return NULL;
+}
+
+/* Convert a CSR matrix to a dense matrix */
+void * csr_to_matrix(const void * _S)
+{
+  const struct csr_matrix * S = _S;
+  if(inherits_from(S, csr_matrix)) {
+    new(M, matrix);
+    matrix_set_dim(M, S->rows, S->cols);
+    for(int i = 0; i < S->rows; ++i)
+      for(int p = S->row_ptr[i]; p < S->row_ptr[i + 1]; ++p)
+        M->dat[M->cols*i + S->col[p]] = S->val[p];
+    return M;
+  }
+  return NULL;
+}
+
+void * csr_transpose(const void * _S)
+{
+  const struct csr_matrix * S = _S;
+  if(inherits_from(S, csr_matrix)) {
+    new(T, csr_matrix);
+    T->rows = S->cols;
+    T->cols = S->rows;
+    T->nnz = S->nnz;
+    T->row_ptr = realloc(T->row_ptr, (T->rows + 1)*sizeof(int));
+    memset(T->row_ptr, 0, (T->rows + 1)*sizeof(int));
+    T->col = malloc((S->nnz > 0 ? S->nnz : 1)*sizeof(int));
+    T->val = malloc((S->nnz > 0 ? S->nnz : 1)*sizeof(real));
+    for(int p = 0; p < S->nnz; ++p) T->row_ptr[S->col[p] + 1]++;
+    for(int i = 0; i < T->rows; ++i) T->row_ptr[i + 1] += T->row_ptr[i];
+    int * cursor = malloc((T->rows + 1)*sizeof(int));
+    memcpy(cursor, T->row_ptr, (T->rows + 1)*sizeof(int));
+    for(int i = 0; i < S->rows; ++i)
+      for(int p = S->row_ptr[i]; p < S->row_ptr[i + 1]; ++p) {
+        int q = cursor[S->col[p]]++;
+        T->col[q] = i;
+        T->val[q] = S->val[p];
+      }
+    free(cursor);
+    return T;
+  }
+  return NULL;
+}
+
+# ifndef CSR_PARALLEL_NNZ
+# define CSR_PARALLEL_NNZ 32768 /* Below this, use a single thread */
+# endif
+
+struct csr_task {
+  const struct csr_matrix * S;
+  const real * x; /* Dense right-hand side (S->cols x nrhs) */
+  int ldx; /* Leading dimension of x */
+  real * y; /* Result (S->rows x nrhs) */
+  int nrhs;
+  int first, last; /* Range of rows */
+};
+
+/* Multiply rows first to last - 1 of S by x */
+void * csr_task_run(void * _task)
+{
+  const struct csr_task * task = _task;
+  const struct csr_matrix * S = task->S;
+  const int nrhs = task->nrhs;
+  if(nrhs == 1) {
+    for(int i = task->first; i < task->last; ++i) {
+      real sum = 0;
+      for(int p = S->row_ptr[i]; p < S->row_ptr[i + 1]; ++p)
+        sum += S->val[p]*task->x[S->col[p]];
+      task->y[i] = sum;
+    }
+  } else {
+    for(int i = task->first; i < task->last; ++i) {
+      real * yi = task->y + nrhs*i;
+      for(int c = 0; c < nrhs; ++c) yi[c] = 0;
+      for(int p = S->row_ptr[i]; p < S->row_ptr[i + 1]; ++p) {
+        const real * xk = task->x + (long int) task->ldx*S->col[p];
+        const real v = S->val[p];
+        for(int c = 0; c < nrhs; ++c) yi[c] += v*xk[c];
+      }
+    }
+  }
+  return NULL;
+}
+
+/* y = S x for a dense block x with nrhs columns (row-major) */
+void csr_multiply(const struct csr_matrix * S, const real * x, int ldx,
+                  real * y, int nrhs)
+{
+  struct csr_task task[MATRIX_MAX_THREADS];
+  pthread_t thread[MATRIX_MAX_THREADS];
+  int nthreads = matrix_threads((long int) S->nnz*nrhs, CSR_PARALLEL_NNZ);
+  if(nthreads > S->rows) nthreads = S->rows > 0 ? S->rows : 1;
+
+  /* Split the rows so that every thread gets about the same number of
+     non-zero elements */
+  int first = 0;
+  for(int t = 0; t < nthreads; ++t) {
+    long int target = (long int) S->nnz*(t + 1)/nthreads;
+    int lo = first, hi = S->rows;
+    while(lo < hi) {
+      int mid = lo + (hi - lo)/2;
+      if(S->row_ptr[mid] < target) lo = mid + 1; else hi = mid;
+    }
+    if(t == nthreads - 1) lo = S->rows;
+    task[t] = (struct csr_task) {S, x, ldx, y, nrhs, first, lo};
+    first = lo;
+  }
+
+  for(int t = 1; t < nthreads; ++t)
+    if(pthread_create(&thread[t], NULL, csr_task_run, &task[t])) {
+      csr_task_run(&task[t]); /* Could not start a thread: do it ourselves */
+      thread[t] = pthread_self();
+    }
+  csr_task_run(&task[0]);
+  for(int t = 1; t < nthreads; ++t)
+    if(!pthread_equal(thread[t], pthread_self())) pthread_join(thread[t], NULL);
+
+  return;
+}
+
+/* Sparse matrix times dense vector on raw arrays: y = S x */
+void csr_spmv(const void * _S, const real * x, real * y)
+{
+  const struct csr_matrix * S = _S;
+  if(inherits_from(S, csr_matrix)) csr_multiply(S, x, 1, y, 1);
+  return;
+}
+
+/* Sparse matrix times vector or dense matrix */
+void * csr_dot(const void * _S, const void * _B)
+{
+  const struct csr_matrix * S = _S;
+  const struct matrix * B = _B;
+  const struct vector * u = _B;
+
+  if(!inherits_from(S, csr_matrix)) return NULL;
+  if(inherits_from(B, matrix) && B->rows == S->cols) {
+    new(M, matrix);
+    matrix_set_dim(M, S->rows, B->cols);
+    csr_multiply(S, B->dat, B->ld, M->dat, B->cols);
+    return M;
+  } else if(inherits_from(u, vector) && u->dim == S->cols) {
+    new(v, vector);
+    vector_set_dim(v, S->rows);
+    csr_multiply(S, u->dat, 1, v->dat, 1);
+    return v;
+  }
+
+  return NULL;
+}
+
+/* Dense matrix times sparse matrix */
+void * matrix_csr_dot(const void * _A, const void * _S)
+{
+  const struct matrix * A = _A;
+  const struct csr_matrix * S = _S;
+  if(inherits_from(A, matrix) && inherits_from(S, csr_matrix)
+     && A->cols == S->rows) {
+    new(M, matrix);
+    matrix_set_dim(M, A->rows, S->cols);
+    for(int i = 0; i < A->rows; ++i)
+      for(int k = 0; k < A->cols; ++k) {
+        const real a = A->dat[A->ld*i + k];
+        if(a == 0) continue;
+        for(int p = S->row_ptr[k]; p < S->row_ptr[k + 1]; ++p)
+          M->dat[M->cols*i + S->col[p]] += a*S->val[p];
+      }
     return M;
   }
   return NULL;
@@ -4,6 +4,7 @@
 # include <stdio.h>
 # include <stdlib.h>
 # include <stdarg.h>
+# include <stdint.h>
 
 # define VA_ARGS(...) , ##__VA_ARGS__
 # define new(varname, vartype, ...) \
@@ -104,6 +105,7 @@ struct abstract_object {
   int (* differs) (void * self, void * b);
   void * (* clone) (const void * self);
   void * (* display) (const void * self, FILE * fp);
+  size_t (* hash) (const void * self);
 };
 
 static void * abstract_object_constructor(void * _self, va_list * args);
@@ -111,6 +113,7 @@ static void * abstract_object_destructor(void * _self);
 int abstract_object_differs(void * _a, void * _b);
 static void * abstract_object_clone(const void * _self);
 void * abstract_object_display(const void * _self, FILE * fp);
+size_t abstract_object_hash(const void * _self);
 void * vector_cross(const void * _v, const void * _w);
 
 static const Class _abstract_object
@@ -126,6 +129,7 @@ static void * abstract_object_constructor(void * _self, va_list * args)
   self->differs = abstract_object_differs;
   self->clone = abstract_object_clone;
   self->display = abstract_object_display;
+  self->hash = abstract_object_hash;
   return _self;
 }
 
@@ -167,6 +171,30 @@ void * abstract_object_display(const void * _self, FILE * fp)
 
   return (void *) _self;
 }
+
+/* Scramble the bits of a 64-bit number */
+size_t hash_mix(uint64_t x)
+{
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return (size_t) x;
+}
+
+/* Hash of an address */
+size_t pointer_hash(const void * p)
+{
+  return hash_mix((uintptr_t) p);
+}
+
+/* An abstract object only equals itself */
+size_t abstract_object_hash(const void * _self)
+{
+  return pointer_hash(_self);
+}
+
 /* Display object */
 void * display(const void * _self, FILE * fp)
 {
@@ -198,4 +226,14 @@ int differs(void * _self, void * b)
   }
   return 1;
 }
+
+/* Hash value of an instance */
+size_t hash(const void * _self)
+{
+  const struct abstract_object * self = _self;
+  if(inherits_from(self, abstract_object)) {
+    if(self->hash) return self->hash(self);
+  }
+  return pointer_hash(_self);
+}
 # endif
@@ -0,0 +1,677 @@
+# ifndef ORDERED_SET_H
+# define ORDERED_SET_H
+# include <stdint.h>
+# include <string.h>
+# include "set.h"
+# include "iterator.h"
+
+/*** Ordered set definition ***/
+# ifndef ORDERED_SET_ORDER
+# define ORDERED_SET_ORDER 32 /* Maximum number of entries in a node */
+# endif
+# define ORDERED_SET_MIN (ORDERED_SET_ORDER/2) /* Except for the root */
+
+struct ordered_entry {
+  double key;
+  const void * element;
+};
+
+struct btree_node {
+  int n; /* Number of entries (leaves) or children (internal nodes) */
+  int leaf;
+  struct btree_node * prev, * next; /* Neighbouring leaves */
+  struct ordered_entry entry[ORDERED_SET_ORDER]; /* entry[i] is the separator
+                                                   for child[i] (i > 0) */
+  struct btree_node * child[ORDERED_SET_ORDER]; /* Internal nodes only */
+};
+
+struct ordered_set {
+  const struct set _; /* This item must come first */
+  double (* key)(const void * element);
+  int (* compare)(const void * a, const void * b);
+  struct btree_node * root;
+  struct btree_node * first, * last; /* Leftmost and rightmost leaves */
+  int height; /* Number of levels below the root */
+};
+
+static void * ordered_set_constructor(void * _self, va_list * args);
+static void * ordered_set_destructor(void * _self);
+static void * ordered_set_clone(const void * _self);
+static void * ordered_set_display(const void * _self, FILE * fp);
+
+static const Class _ordered_set
+  = {sizeof(struct ordered_set), "ordered set", &_set,
+     ordered_set_constructor, ordered_set_destructor};
+
+const void * ordered_set = &_ordered_set;
+
+/*** Ordered set overrides ***/
+int ordered_set_find(const void * _self, const void * _element);
+void ordered_set_insert(void * _self, const void * _element);
+void ordered_set_drop(void * _self, const void * _element);
+int ordered_set_equal(const void * _A, const void * _B);
+void * ordered_set_snapshot(const void * _self);
+
+/*** Ordered set operations ***/
+void * ordered_set_min(const void * _self);
+void * ordered_set_max(const void * _self);
+void * ordered_set_predecessor(const void * _self, const void * _element);
+void * ordered_set_successor(const void * _self, const void * _element);
+void ordered_set_load(void * _self, void * const * element, int n);
+
+/*** Range iterator definition ***/
+struct range_iterator {
+  const struct iterator _; /* This item must come first */
+  const struct ordered_set * S;
+  const struct btree_node * leaf; /* Current position */
+  int index;
+  struct ordered_entry lo, hi; /* Limits of the range */
+  int has_lo, has_hi;
+};
+
+static void * range_iterator_constructor(void * _self, va_list * args);
+
+static const Class _range_iterator
+  = {sizeof(struct range_iterator), "range iterator", &_iterator,
+     range_iterator_constructor, NULL};
+
+const void * range_iterator = &_range_iterator;
+
+union iterator_value range_iterator_next(void * _self);
+union iterator_value range_iterator_prev(void * _self);
+union iterator_value range_iterator_put(void * _self, union iterator_value val);
+void * ordered_set_key_range(const void * _S, double lo, double hi);
+
+/*** Ordered set function implementations ***/
+struct btree_node * btree_node_new(int leaf)
+{
+  struct btree_node * node = malloc(sizeof(struct btree_node));
+  node->n = 0;
+  node->leaf = leaf;
+  node->prev = node->next = NULL;
+  return node;
+}
+
+void btree_node_free(struct btree_node * node)
+{
+  if(!node->leaf)
+    for(int i = 0; i < node->n; ++i) btree_node_free(node->child[i]);
+  free(node);
+  return;
+}
+
+static void * ordered_set_constructor(void * _self, va_list * args)
+{
+  set_constructor(_self, args);
+  struct abstract_object * obj = _self;
+  obj->clone = ordered_set_clone;
+  obj->display = ordered_set_display;
+  struct set * sself = _self;
+  sself->find = ordered_set_find;
+  sself->insert = ordered_set_insert;
+  sself->drop = ordered_set_drop;
+  sself->equal = ordered_set_equal;
+  sself->snapshot = ordered_set_snapshot;
+  struct ordered_set * self = _self;
+  self->key = va_arg(*args, double (*)(const void *));
+  self->compare = NULL;
+  if(!self->key) self->compare = va_arg(*args, int (*)(const void *,
+                                                        const void *));
+  self->root = self->first = self->last = btree_node_new(1);
+  self->height = 0;
+  return _self;
+}
+
+static void * ordered_set_destructor(void * _self)
+{
+  struct ordered_set * self = _self;
+  btree_node_free(self->root);
+  return set_destructor(_self);
+}
+
+/* Clone an ordered set (the elements are shared, as for sets) */
+static void * ordered_set_clone(const void * _self)
+{
+  if(inherits_from(_self, ordered_set)) {
+    const struct ordered_set * self = _self;
+    const struct set * sself = _self;
+    struct ordered_set * A = new_object(ordered_set, self->key, self->compare);
+    A->compare = self->compare;
+    void ** element = malloc((sself->nelements + 1)*sizeof(void *));
+    int n = 0;
+    for(const struct btree_node * leaf = self->first; leaf; leaf = leaf->next)
+      for(int i = 0; i < leaf->n; ++i)
+        element[n++] = (void *) leaf->entry[i].element;
+    ordered_set_load(A, element, n);
+    free(element);
+    return A;
+  }
+  return NULL;
+}
+
+static void * ordered_set_display(const void * _self, FILE * fp)
+{
+  set_display(_self, fp);
+
+  if(inherits_from(_self, ordered_set)) {
+    const struct ordered_set * self = _self;
+    fprintf(fp, "Order: %s\n", self->key ? "by key" :
+                               self->compare ? "by comparison" : "by address");
+    fprintf(fp, "Tree height: %d\n", self->height + 1);
+  }
+  return NULL;
+}
+
+/* Compare two entries: negative, zero or positive */
+int ordered_compare(const struct ordered_set * self,
+                    const struct ordered_entry * a,
+                    const struct ordered_entry * b)
+{
+  if(self->key) {
+    if(a->key != b->key) return a->key < b->key ? -1 : 1;
+  } else if(self->compare) return self->compare(a->element, b->element);
+  uintptr_t x = (uintptr_t) a->element, y = (uintptr_t) b->element;
+  return (x > y) - (x < y);
+}
+
+struct ordered_entry ordered_entry_of(const struct ordered_set * self,
+                                      const void * element)
+{
+  struct ordered_entry e = {self->key ? self->key(element) : 0.0, element};
+  return e;
+}
+
+/* First entry of a leaf not smaller than e (n if there is none) */
+int btree_lower_bound(const struct ordered_set * self,
+                      const struct btree_node * leaf,
+                      const struct ordered_entry * e)
+{
+  int lo = 0, hi = leaf->n;
+  while(lo < hi) {
+    int mid = (lo + hi)/2;
+    if(ordered_compare(self, &leaf->entry[mid], e) < 0) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+/* Child of an internal node that could hold e */
+int btree_child_index(const struct ordered_set * self,
+                      const struct btree_node * node,
+                      const struct ordered_entry * e)
+{
+  int lo = 1, hi = node->n;
+  while(lo < hi) {
+    int mid = (lo + hi)/2;
+    if(ordered_compare(self, &node->entry[mid], e) <= 0) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo - 1;
+}
+
+/* Leaf that could hold e */
+struct btree_node * btree_leaf_of(const struct ordered_set * self,
+                                  const struct ordered_entry * e)
+{
+  struct btree_node * node = self->root;
+  while(!node->leaf) node = node->child[btree_child_index(self, node, e)];
+  return node;
+}
+
+int ordered_set_find(const void * _self, const void * _element)
+{
+  const struct ordered_set * self = _self;
+  struct ordered_entry e = ordered_entry_of(self, _element);
+  const struct btree_node * leaf = btree_leaf_of(self, &e);
+  int i = btree_lower_bound(self, leaf, &e);
+  if(i < leaf->n && ordered_compare(self, &leaf->entry[i], &e) == 0) return i;
+  return -1;
+}
+
+/* Put the entry e and the child c at position i of a node */
+void btree_node_put(struct btree_node * node, int i, struct ordered_entry e,
+                    struct btree_node * c)
+{
+  memmove(node->entry + i + 1, node->entry + i,
+          (node->n - i)*sizeof(struct ordered_entry));
+  node->entry[i] = e;
+  if(!node->leaf) {
+    memmove(node->child + i + 1, node->child + i,
+            (node->n - i)*sizeof(struct btree_node *));
+    node->child[i] = c;
+  }
+  node->n++;
+  return;
+}
+
+/* Insert e below node. If the node splits, return the new node to its right
+   and store the separator for it in sep */
+struct btree_node * btree_insert(struct ordered_set * self,
+                                 struct btree_node * node,
+                                 struct ordered_entry e,
+                                 struct ordered_entry * sep, int * inserted)
+{
+  int i;
+  struct btree_node * c = NULL;
+  if(node->leaf) {
+    i = btree_lower_bound(self, node, &e);
+    if(i < node->n && ordered_compare(self, &node->entry[i], &e) == 0)
+      return NULL;
+    *inserted = 1;
+  } else {
+    struct ordered_entry child_sep;
+    int k = btree_child_index(self, node, &e);
+    c = btree_insert(self, node->child[k], e, &child_sep, inserted);
+    if(!c) return NULL;
+    e = child_sep;
+    i = k + 1;
+  }
+  if(node->n < ORDERED_SET_ORDER) {
+    btree_node_put(node, i, e, c);
+    return NULL;
+  }
+
+  /* Split: the right half moves to a new node */
+  struct btree_node * right = btree_node_new(node->leaf);
+  const int half = ORDERED_SET_ORDER/2;
+  right->n = ORDERED_SET_ORDER - half;
+  memcpy(right->entry, node->entry + half,
+         right->n*sizeof(struct ordered_entry));
+  if(!node->leaf)
+    memcpy(right->child, node->child + half,
+           right->n*sizeof(struct btree_node *));
+  node->n = half;
+  if(node->leaf) {
+    right->prev = node;
+    right->next = node->next;
+    if(node->next) node->next->prev = right;
+    else self->last = right;
+    node->next = right;
+  }
+  if(i <= half) btree_node_put(node, i, e, c);
+  else btree_node_put(right, i - half, e, c);
+  *sep = right->entry[0];
+  return right;
+}
+
+void ordered_set_insert(void * _self, const void * _element)
+{
+  struct ordered_set * self = _self;
+  struct set * sself = _self;
+  struct ordered_entry sep;
+  int inserted = 0;
+  struct btree_node * right
+    = btree_insert(self, self->root, ordered_entry_of(self, _element), &sep,
+                   &inserted);
+  if(right) {
+    struct btree_node * root = btree_node_new(0);
+    root->n = 2;
+    root->child[0] = self->root;
+    root->child[1] = right;
+    root->entry[1] = sep;
+    self->root = root;
+    self->height++;
+  }
+  sself->nelements += inserted;
+  return;
+}
+
+/* Remove entry and child i from a node */
+void btree_node_remove(struct btree_node * node, int i)
+{
+  memmove(node->entry + i, node->entry + i + 1,
+          (node->n - i - 1)*sizeof(struct ordered_entry));
+  if(!node->leaf)
+    memmove(node->child + i, node->child + i + 1,
+            (node->n - i - 1)*sizeof(struct btree_node *));
+  node->n--;
+  return;
+}
+
+/* Merge child i + 1 of node into child i */
+void btree_merge(struct ordered_set * self, struct btree_node * node, int i)
+{
+  struct btree_node * L = node->child[i];
+  struct btree_node * R = node->child[i + 1];
+  if(L->leaf) {
+    memcpy(L->entry + L->n, R->entry, R->n*sizeof(struct ordered_entry));
+    L->next = R->next;
+    if(R->next) R->next->prev = L;
+    else self->last = L;
+  } else {
+    memcpy(L->entry + L->n, R->entry, R->n*sizeof(struct ordered_entry));
+    memcpy(L->child + L->n, R->child, R->n*sizeof(struct btree_node *));
+    L->entry[L->n] = node->entry[i + 1];
+  }
+  L->n += R->n;
+  free(R);
+  btree_node_remove(node, i + 1);
+  return;
+}
+
+/* Give child i of node at least ORDERED_SET_MIN entries */
+void btree_fix(struct ordered_set * self, struct btree_node * node, int i)
+{
+  struct btree_node * c = node->child[i];
+  struct btree_node * left = i > 0 ? node->child[i - 1] : NULL;
+  struct btree_node * right = i < node->n - 1 ? node->child[i + 1] : NULL;
+  if(left && left->n > ORDERED_SET_MIN) {
+    /* Move the last entry (and child) of the left sibling over */
+    struct ordered_entry e = left->entry[left->n - 1];
+    if(c->leaf) {
+      btree_node_put(c, 0, e, NULL);
+      node->entry[i] = e;
+    } else {
+      btree_node_put(c, 0, e, left->child[left->n - 1]);
+      c->entry[1] = node->entry[i];
+      node->entry[i] = e;
+    }
+    left->n--;
+  } else if(right && right->n > ORDERED_SET_MIN) {
+    /* Move the first entry (and child) of the right sibling over */
+    if(c->leaf) {
+      c->entry[c->n++] = right->entry[0];
+      btree_node_remove(right, 0);
+      node->entry[i + 1] = right->entry[0];
+    } else {
+      c->entry[c->n] = node->entry[i + 1];
+      c->child[c->n++] = right->child[0];
+      node->entry[i + 1] = right->entry[1];
+      btree_node_remove(right, 0);
+    }
+  } else if(left) btree_merge(self, node, i - 1);
+  else btree_merge(self, node, i);
+  return;
+}
+
+/* Drop e from below node (return 1 if it was there) */
+int btree_drop(struct ordered_set * self, struct btree_node * node,
+               const struct ordered_entry * e)
+{
+  if(node->leaf) {
+    int i = btree_lower_bound(self, node, e);
+    if(i == node->n || ordered_compare(self, &node->entry[i], e) != 0)
+      return 0;
+    btree_node_remove(node, i);
+    return 1;
+  }
+  int i = btree_child_index(self, node, e);
+  if(!btree_drop(self, node->child[i], e)) return 0;
+  if(node->child[i]->n < ORDERED_SET_MIN) btree_fix(self, node, i);
+  return 1;
+}
+
+void ordered_set_drop(void * _self, const void * _element)
+{
+  struct ordered_set * self = _self;
+  struct set * sself = _self;
+  struct ordered_entry e = ordered_entry_of(self, _element);
+  if(!btree_drop(self, self->root, &e)) return;
+  sself->nelements--;
+  if(!self->root->leaf && self->root->n == 1) {
+    struct btree_node * root = self->root;
+    self->root = root->child[0];
+    free(root);
+    self->height--;
+  }
+  return;
+}
+
+void ordered_set_load(void * _self, void * const * element, int n)
+{
+  if(!inherits_from(_self, ordered_set)) return;
+  struct ordered_set * self = _self;
+  struct set * sself = _self;
+  struct ordered_entry * e = malloc((n + 1)*sizeof(struct ordered_entry));
+  int sorted = sself->nelements == 0;
+  for(int i = 0; i < n; ++i) {
+    e[i] = ordered_entry_of(self, element[i]);
+    if(i > 0 && ordered_compare(self, &e[i - 1], &e[i]) >= 0) sorted = 0;
+  }
+  if(!sorted || n == 0) {
+    for(int i = 0; i < n; ++i) insert(_self, element[i]);
+    free(e);
+    return;
+  }
+
+  /* Leaves */
+  btree_node_free(self->root);
+  int count = (n + ORDERED_SET_ORDER - 1)/ORDERED_SET_ORDER;
+  struct btree_node ** level = malloc(count*sizeof(struct btree_node *));
+  struct ordered_entry * min = malloc(count*sizeof(struct ordered_entry));
+  for(int j = 0; j < count; ++j) {
+    int begin = (long) n*j/count, end = (long) n*(j + 1)/count;
+    struct btree_node * leaf = level[j] = btree_node_new(1);
+    leaf->n = end - begin;
+    memcpy(leaf->entry, e + begin, leaf->n*sizeof(struct ordered_entry));
+    min[j] = e[begin];
+    if(j > 0) {
+      leaf->prev = level[j - 1];
+      level[j - 1]->next = leaf;
+    }
+  }
+  self->first = level[0];
+  self->last = level[count - 1];
+
+  /* Internal levels */
+  self->height = 0;
+  while(count > 1) {
+    int up = (count + ORDERED_SET_ORDER - 1)/ORDERED_SET_ORDER;
+    for(int j = 0; j < up; ++j) {
+      int begin = (long) count*j/up, end = (long) count*(j + 1)/up;
+      struct btree_node * node = btree_node_new(0);
+      node->n = end - begin;
+      memcpy(node->child, level + begin, node->n*sizeof(struct btree_node *));
+      memcpy(node->entry, min + begin, node->n*sizeof(struct ordered_entry));
+      level[j] = node;
+      min[j] = min[begin];
+    }
+    count = up;
+    self->height++;
+  }
+  self->root = level[0];
+  sself->nelements = n;
+  free(level);
+  free(min);
+  free(e);
+  return;
+}
+
+void * ordered_set_min(const void * _self)
+{
+  if(!inherits_from(_self, ordered_set)) return NULL;
+  const struct ordered_set * self = _self;
+  if(self->first->n == 0) return NULL;
+  return (void *) self->first->entry[0].element;
+}
+
+void * ordered_set_max(const void * _self)
+{
+  if(!inherits_from(_self, ordered_set)) return NULL;
+  const struct ordered_set * self = _self;
+  if(self->last->n == 0) return NULL;
+  return (void *) self->last->entry[self->last->n - 1].element;
+}
+
+void * ordered_set_predecessor(const void * _self, const void * _element)
+{
+  if(!inherits_from(_self, ordered_set)) return NULL;
+  const struct ordered_set * self = _self;
+  struct ordered_entry e = ordered_entry_of(self, _element);
+  const struct btree_node * leaf = btree_leaf_of(self, &e);
+  int i = btree_lower_bound(self, leaf, &e) - 1;
+  if(i < 0) {
+    leaf = leaf->prev;
+    if(!leaf) return NULL;
+    i = leaf->n - 1;
+  }
+  return (void *) leaf->entry[i].element;
+}
+
+void * ordered_set_successor(const void * _self, const void * _element)
+{
+  if(!inherits_from(_self, ordered_set)) return NULL;
+  const struct ordered_set * self = _self;
+  struct ordered_entry e = ordered_entry_of(self, _element);
+  const struct btree_node * leaf = btree_leaf_of(self, &e);
+  int i = btree_lower_bound(self, leaf, &e);
+  if(i < leaf->n && ordered_compare(self, &leaf->entry[i], &e) == 0) i++;
+  if(i == leaf->n) {
+    leaf = leaf->next;
+    if(!leaf) return NULL;
+    i = 0;
+  }
+  return (void *) leaf->entry[i].element;
+}
+
+void * ordered_set_snapshot(const void * _self)
+{
+  const struct ordered_set * self = _self;
+  const struct set * sself = _self;
+  void * S = new_object(hash_set, NULL);
+  hash_set_reserve(S, sself->nelements);
+  for(const struct btree_node * leaf = self->first; leaf; leaf = leaf->next)
+    for(int i = 0; i < leaf->n; ++i) insert(S, leaf->entry[i].element);
+  return S;
+}
+
+int ordered_set_equal(const void * _A, const void * _B)
+{
+  const struct ordered_set * A = _A;
+  const struct ordered_set * B = _B;
+  const struct set * sA = _A;
+  const struct set * sB = _B;
+  if(sA->nelements != sB->nelements) return 0;
+  if(inherits_from(_B, ordered_set) && A->key == B->key
+     && A->compare == B->compare) {
+    const struct btree_node * a = A->first, * b = B->first;
+    int i = 0, j = 0;
+    while(a && b) {
+      if(i == a->n) {a = a->next; i = 0; continue;}
+      if(j == b->n) {b = b->next; j = 0; continue;}
+      if(a->entry[i++].element != b->entry[j++].element) return 0;
+    }
+    return 1;
+  }
+  void * S = ordered_set_snapshot(_A);
+  int result = equal(S, _B);
+  delete(S);
+  return result;
+}
+
+/*** Range iterator function implementations ***/
+/* Current element, or NULL if we are out of the range */
+union iterator_value range_iterator_update(struct range_iterator * self)
+{
+  struct iterator * it = (struct iterator *) self;
+  it->val.p = NULL;
+  if(self->leaf && self->index >= 0 && self->index < self->leaf->n) {
+    const struct ordered_entry * e = &self->leaf->entry[self->index];
+    if((!self->has_lo || ordered_compare(self->S, e, &self->lo) >= 0)
+       && (!self->has_hi || ordered_compare(self->S, e, &self->hi) <= 0))
+      it->val.p = (void *) e->element;
+  }
+  return it->val;
+}
+
+/* Move to the first entry not smaller than e */
+void range_iterator_seek(struct range_iterator * self,
+                         const struct ordered_entry * e)
+{
+  self->leaf = btree_leaf_of(self->S, e);
+  self->index = btree_lower_bound(self->S, self->leaf, e);
+  if(self->index == self->leaf->n && self->leaf->next) {
+    self->leaf = self->leaf->next;
+    self->index = 0;
+  }
+  return;
+}
+
+static void * range_iterator_constructor(void * _self, va_list * args)
+{
+  struct abstract_object * obj = abstract_object_constructor(_self, args);
+  obj->clone = NULL;
+  struct iterator * it = _self;
+  it->val_type = POINTER;
+  it->next = range_iterator_next;
+  it->prev = range_iterator_prev;
+  it->set = range_iterator_put;
+  it->get = iterator_get;
+  struct range_iterator * self = _self;
+  self->S = va_arg(*args, const struct ordered_set *);
+  self->leaf = NULL;
+  self->has_lo = self->has_hi = 0;
+  if(!self->S || !inherits_from(self->S, ordered_set)) {
+    self->S = NULL;
+    it->val.p = NULL;
+    return _self;
+  }
+  const void * lo = va_arg(*args, const void *);
+  const void * hi = va_arg(*args, const void *);
+  if(lo) {
+    self->lo = ordered_entry_of(self->S, lo);
+    self->has_lo = 1;
+    range_iterator_seek(self, &self->lo);
+  } else {
+    self->leaf = self->S->first;
+    self->index = 0;
+  }
+  if(hi) {
+    self->hi = ordered_entry_of(self->S, hi);
+    self->has_hi = 1;
+  }
+  range_iterator_update(self);
+  return _self;
+}
+
+union iterator_value range_iterator_next(void * _self)
+{
+  struct range_iterator * self = _self;
+  if(self->leaf && self->index < self->leaf->n) {
+    if(++self->index == self->leaf->n && self->leaf->next) {
+      self->leaf = self->leaf->next;
+      self->index = 0;
+    }
+  }
+  return range_iterator_update(self);
+}
+
+union iterator_value range_iterator_prev(void * _self)
+{
+  struct range_iterator * self = _self;
+  if(self->leaf && self->index >= 0) {
+    if(--self->index < 0 && self->leaf->prev) {
+      self->leaf = self->leaf->prev;
+      self->index = self->leaf->n - 1;
+    }
+  }
+  return range_iterator_update(self);
+}
+
+union iterator_value range_iterator_put(void * _self, union iterator_value val)
+{
+  struct range_iterator * self = _self;
+  if(self->S && val.p) {
+    struct ordered_entry e = ordered_entry_of(self->S, val.p);
+    range_iterator_seek(self, &e);
+  }
+  return range_iterator_update(self);
+}
+
+/* Iterator over the elements with keys from lo to hi */
+void * ordered_set_key_range(const void * _S, double lo, double hi)
+{
+  const struct ordered_set * S = _S;
+  if(!inherits_from(_S, ordered_set) || !S->key) return NULL;
+  struct range_iterator * it = new_object(range_iterator, NULL);
+  it->S = S;
+  /* The smallest and largest addresses with each key */
+  it->lo = (struct ordered_entry) {lo, NULL};
+  it->hi = (struct ordered_entry) {hi, (const void *) UINTPTR_MAX};
+  it->has_lo = it->has_hi = 1;
+  range_iterator_seek(it, &it->lo);
+  range_iterator_update(it);
+  return it;
+}
+
+# endif
@@ -1,22 +1,57 @@
 # ifndef SET_H
 # define SET_H
+# include <string.h>
+# include <math.h>
+# include <pthread.h>
+# ifdef __SSE2__
+# include <emmintrin.h>
+# endif
 # include "object.h"
+# include "iterator.h"
+# include "list.h" /* For sets made from lists */
+
+/*** Bloom filter definition ***/
+# define BLOOM_FILTER_MIN_CAPACITY 1024
+# define BLOOM_BLOCK_WORDS 8 /* 512 bits */
+
+struct bloom_filter {
+  uint64_t * bits; /* nblocks blocks of BLOOM_BLOCK_WORDS words */
+  long nblocks;
+  int k; /* Number of bits per element */
+  double rate; /* False positive rate we are after */
+  int capacity; /* Number of elements the filter was built for */
+  int count; /* Number of elements added since it was built */
+  size_t (* key_hash)(const void * element);
+  long hits, misses, false_positives, rebuilds;
+};
+
+struct bloom_filter * bloom_filter_new(int capacity, double rate,
+                                       size_t (* key_hash)(const void *));
+void bloom_filter_free(struct bloom_filter * f);
+void bloom_filter_add(struct bloom_filter * f, size_t key);
+int bloom_filter_may_contain(const struct bloom_filter * f, size_t key);
+void bloom_filter_display(const struct bloom_filter * f, FILE * fp);
 
 /*** Set definition ***/
 struct set {
   const struct abstract_object _; /* This item must come first */
   int nelements; /* Number of elements in the set */
   void * element;
+  int element_capacity; /* Number of elements the element array has room for */
   int (* find)(const void * _self, const void * _element);
   void (* insert)(void * _self, const void * _element);
   void (* drop)(void * _self, const void * element);
   int (* equal)(const void * _A, const void * _B);
+  void * (* snapshot)(const void * _self); /* For sets without element array */
+  struct bloom_filter * filter; /* Optional, see set_attach_filter */
 };
 
 static void * set_constructor(void * _self, va_list * args);
 static void * set_destructor(void * _self);
 static void * set_clone(const void * _self);
 static void * set_display(const void * _self, FILE * fp);
+int set_differs(void * _a, void * _b);
+size_t set_hash(const void * _self);
 
 static const Class _set
   = {sizeof(struct set), "set", &_abstract_object,
@@ -31,26 +66,180 @@ void insert(void * _self, const void * _element);
 void drop(void * _self, const void * element);
 int equal(const void * _A, const void * _B);
 
+/*** Bloom filter front-end ***/
+void set_attach_filter(void * _self, double rate,
+                       size_t (* key_hash)(const void * element));
+void set_detach_filter(void * _self);
+int set_filtered_find(const void * _self, const void * _element);
+void set_filter_add(void * _self, const void * _element);
+
+/*** Bulk construction ***/
+void set_reserve(void * _self, int n);
+void set_shrink(void * _self);
+void set_insert_many(void * _self, void * const * objects, int count);
+void * set_from_array(const void * class, void * const * objects, int count);
+void * set_from_list(const void * class, const struct obj_list * list);
+
 /*** specialised overrides ***/
 int set_find(const void * self, const void * _element);
 void set_insert(void * _self, const void * _element);
 void set_drop(void * _self, const void * element);
 int set_equal(const void * _A, const void * _B);
 
+/*** Hash set definition ***/
+# ifndef HASH_SET_INLINE
+# define HASH_SET_INLINE 16 /* Must be a multiple of 4 */
+# endif
+
+struct hash_set {
+  const struct set _; /* This item must come first */
+  int capacity; /* Number of slots in the table (a power of two) */
+  int * slot; /* Position of an element in the element array, or -1 */
+  size_t * element_hash; /* Hash of each element in the element array */
+  size_t (* key_hash)(const void * element);
+  int (* same)(const void * a, const void * b);
+  const void * inline_element[HASH_SET_INLINE]; /* Elements of small sets */
+  size_t inline_hash[HASH_SET_INLINE]; /* and their hashes */
+};
+
+static void * hash_set_constructor(void * _self, va_list * args);
+static void * hash_set_destructor(void * _self);
+static void * hash_set_clone(const void * _self);
+static void * hash_set_display(const void * _self, FILE * fp);
+
+static const Class _hash_set
+  = {sizeof(struct hash_set), "hash set", &_set,
+     hash_set_constructor, hash_set_destructor};
+
+const void * hash_set = &_hash_set;
+
+/*** hash set overrides ***/
+int hash_set_inline_find(const struct hash_set * self, const void * element,
+                         size_t key);
+void hash_set_inline_drop(struct hash_set * self, const void * element);
+void hash_set_spill(struct hash_set * self, int n);
+void hash_set_rehash(struct hash_set * self, int capacity);
+int hash_set_find(const void * _self, const void * _element);
+void hash_set_insert(void * _self, const void * _element);
+void hash_set_drop(void * _self, const void * _element);
+int hash_set_equal(const void * _A, const void * _B);
+
+/*** Value set definition ***/
+struct value_set {
+  const struct hash_set _; /* This item must come first */
+};
+
+static void * value_set_constructor(void * _self, va_list * args);
+
+static const Class _value_set
+  = {sizeof(struct value_set), "value set", &_hash_set,
+     value_set_constructor, hash_set_destructor};
+
+const void * value_set = &_value_set;
+
+int same_value(const void * a, const void * b);
+
+/*** Concurrent set definition ***/
+# ifndef CONCURRENT_SET_SEGMENTS
+# define CONCURRENT_SET_SEGMENTS 64 /* Must be a power of two */
+# endif
+
+struct concurrent_table {
+  int capacity; /* Number of slots (a power of two) */
+  struct concurrent_table * retired; /* Next table in the list of old tables */
+  const void * slot[]; /* Element, tombstone or NULL */
+};
+
+struct concurrent_segment {
+  struct concurrent_table * table; /* Read and written atomically */
+  struct concurrent_table * retired; /* Old tables, freed with the set */
+  int used; /* Slots holding elements or tombstones */
+  pthread_mutex_t lock; /* Taken by writers only */
+};
+
+struct concurrent_set {
+  const struct set _; /* This item must come first */
+  struct concurrent_segment segment[CONCURRENT_SET_SEGMENTS];
+};
+
+static void * concurrent_set_constructor(void * _self, va_list * args);
+static void * concurrent_set_destructor(void * _self);
+static void * concurrent_set_clone(const void * _self);
+
+static const Class _concurrent_set
+  = {sizeof(struct concurrent_set), "concurrent set", &_set,
+     concurrent_set_constructor, concurrent_set_destructor};
+
+const void * concurrent_set = &_concurrent_set;
+
+/*** concurrent set overrides ***/
+int concurrent_set_find(const void * _self, const void * _element);
+void concurrent_set_insert(void * _self, const void * _element);
+void concurrent_set_drop(void * _self, const void * _element);
+int concurrent_set_equal(const void * _A, const void * _B);
+void * concurrent_set_snapshot(const void * _self);
+
+/*** Bit set definition ***/
+struct bit_set {
+  const struct set _; /* This item must come first */
+  int universe; /* Elements have IDs from 0 to universe - 1 */
+  int (* id)(const void * element);
+  uint64_t * bits; /* Bit i is set if the element with ID i is in the set */
+  int * position; /* Position in the element array of the element with ID i */
+};
+
+static void * bit_set_constructor(void * _self, va_list * args);
+static void * bit_set_destructor(void * _self);
+static void * bit_set_clone(const void * _self);
+
+static const Class _bit_set
+  = {sizeof(struct bit_set), "bit set", &_set,
+     bit_set_constructor, bit_set_destructor};
+
+const void * bit_set = &_bit_set;
+
+/*** bit set overrides ***/
+int bit_set_find(const void * _self, const void * _element);
+void bit_set_insert(void * _self, const void * _element);
+void bit_set_drop(void * _self, const void * _element);
+int bit_set_equal(const void * _A, const void * _B);
+void bit_set_keep(void * _self, const void * index, int keep);
+
+/*** Set algebra ***/
+int set_has_index(const void * _self);
+const void * set_index(const void * _self);
+void set_index_done(const void * _self, const void * index);
+const void * set_dense(const void * _self);
+void set_dense_done(const void * _self, const void * dense);
+void hash_set_reserve(void * _self, int n);
+void * set_union(const void * _A, const void * _B);
+void * set_intersection(const void * _A, const void * _B);
+void * set_difference(const void * _A, const void * _B);
+void * set_symmetric_difference(const void * _A, const void * _B);
+void set_union_in_place(void * _A, const void * _B);
+void set_intersection_in_place(void * _A, const void * _B);
+void set_difference_in_place(void * _A, const void * _B);
+void set_symmetric_difference_in_place(void * _A, const void * _B);
+
 /*** Set function implementations ***/
 /* Constructor */
 static void * set_constructor(void * _self, va_list * args)
 {
   struct abstract_object * obj =  abstract_object_constructor(_self, args);
+  obj->differs = set_differs;
+  obj->hash = set_hash;
   obj->clone = set_clone;
   obj->display = set_display;
   struct set * self = _self;
   self->nelements = 0;
   self->element = NULL;
+  self->element_capacity = 0;
   self->find = set_find;
   self->insert = set_insert;
   self->drop = set_drop;
   self->equal = set_equal;
+  self->snapshot = NULL;
+  self->filter = NULL;
   return _self;
 }
 
@@ -58,6 +247,7 @@ static void * set_constructor(void * _self, va_list * args)
 static void * set_destructor(void * _self)
 {
   struct set * self = _self;
+  bloom_filter_free(self->filter);
   free(self->element);
   return NULL;
 }
@@ -68,13 +258,10 @@ static void * set_clone(const void * _self)
   if(inherits_from(_self, set)) {
     const struct set * self = _self;
     new(A, set);
+    set_reserve(A, self->nelements);
     A->nelements = self->nelements;
-    A->element = calloc(sizeof(void *), A->nelements);
-    struct abstract_object ** A_element = A->element;
-    struct abstract_object ** self_element = self->element;
-    for(int i = 0; i < self->nelements; ++i) {
-      A_element[i] = self_element[i];
-    }
+    if(A->nelements)
+      memcpy(A->element, self->element, self->nelements*sizeof(void *));
     return A;
   }
   return NULL;
@@ -88,6 +275,7 @@ static void * set_display(const void * _self, FILE * fp)
   if(inherits_from(_self, set)){
     const struct set * self = _self;
     fprintf(fp, "Number of elements: %d\n", self->nelements);
+    if(self->filter) bloom_filter_display(self->filter, fp);
   }
   return NULL;
 }
@@ -98,6 +286,7 @@ int find(const void * _self, const void * _element)
 {
   if(inherits_from(_self, set) && inherits_from(_element, abstract_object)){
     const struct set * self = _self;
+    if(self->filter) return set_filtered_find(_self, _element);
     if(self->find) return self->find(_self, _element);
   }
   return -1;
@@ -111,7 +300,11 @@ int contains(const void * _self, const void * _element)
 void insert(void * _self, const void * _element) {
   if(inherits_from(_self, set) && inherits_from(_element, abstract_object)){
     const struct set * self = _self;
-    if(self->insert) self->insert(_self, _element);
+    if(self->insert) {
+      int n = self->nelements;
+      self->insert(_self, _element);
+      if(self->filter && self->nelements != n) set_filter_add(_self, _element);
+    }
   }
   return;
 }
@@ -151,10 +344,11 @@ void set_insert(void * _self, const void * _element)
   if(inherits_from(_self, set) && inherits_from(_element, abstract_object)){
     if(!contains(_self, _element)) {
       struct set * self = _self;
-      self->nelements++;
-      self->element = realloc(self->element, self->nelements*sizeof(void *));
+      if(self->nelements == self->element_capacity)
+        set_reserve(_self, self->element_capacity > 0 ?
+                           2*self->element_capacity : 4);
       const struct abstract_object ** self_element = self->element;
-      self_element[self->nelements - 1] = _element;
+      self_element[self->nelements++] = _element;
     }
   }
   return;
@@ -189,4 +383,1221 @@ int set_equal(const void * _A, const void * _B)
   return 0;
 }
 
+/*** Hash set function implementations ***/
+# define HASH_SET_MIN_CAPACITY 16
+
+int same_pointer(const void * a, const void * b) { return a == b; }
+
+static void * hash_set_constructor(void * _self, va_list * args)
+{
+  set_constructor(_self, args);
+  struct abstract_object * obj = _self;
+  obj->clone = hash_set_clone;
+  obj->display = hash_set_display;
+  struct set * sself = _self;
+  sself->find = hash_set_find;
+  sself->insert = hash_set_insert;
+  sself->drop = hash_set_drop;
+  sself->equal = hash_set_equal;
+  struct hash_set * self = _self;
+  self->capacity = 0;
+  self->slot = NULL;
+  sself->element_capacity = HASH_SET_INLINE;
+  sself->element = self->inline_element;
+  self->element_hash = self->inline_hash;
+  self->key_hash = pointer_hash;
+  self->same = same_pointer;
+  return _self;
+}
+
+static void * hash_set_destructor(void * _self)
+{
+  struct hash_set * self = _self;
+  if(self->slot) {
+    free(self->slot);
+    free(self->element_hash);
+  } else {
+    struct set * sself = _self;
+    sself->element = NULL; /* Not ours to free */
+  }
+  return set_destructor(_self);
+}
+
+/* Clone a hash set (the elements are shared, as for sets) */
+static void * hash_set_clone(const void * _self)
+{
+  if(inherits_from(_self, hash_set)) {
+    const struct set * sself = _self;
+    const struct hash_set * self = _self;
+    const struct Class * const * class = _self;
+    struct hash_set * A = new_object(*class, NULL);
+    struct set * sA = (struct set *) A;
+    A->key_hash = self->key_hash;
+    A->same = self->same;
+    hash_set_reserve(A, sself->nelements);
+    sA->nelements = sself->nelements;
+    memcpy(sA->element, sself->element, sself->nelements*sizeof(void *));
+    memcpy(A->element_hash, self->element_hash,
+           sself->nelements*sizeof(size_t));
+    if(A->slot) hash_set_rehash(A, A->capacity);
+    return A;
+  }
+  return NULL;
+}
+
+static void * hash_set_display(const void * _self, FILE * fp)
+{
+  set_display(_self, fp);
+
+  if(inherits_from(_self, hash_set)) {
+    const struct hash_set * self = _self;
+    if(self->slot) fprintf(fp, "Table slots: %d\n", self->capacity);
+    else fprintf(fp, "Table slots: none (small set)\n");
+  }
+  return NULL;
+}
+
+/* First of the pointers e[0], ..., e[n - 1] equal to p (or -1), where the
+   entries after them, up to a multiple of 4, are NULL */
+int hash_set_scan_pointers(const void * const * e, int n, const void * p)
+{
+  for(int b = 0; b < n; b += 4) {
+    const int mask = (e[b] == p) | (e[b + 1] == p) << 1
+                     | (e[b + 2] == p) << 2 | (e[b + 3] == p) << 3;
+    if(mask) return b + __builtin_ctz(mask);
+  }
+  return -1;
+}
+
+# if defined(__SSE2__) && SIZE_MAX == UINT64_MAX
+/* First of the hashes w[start], ..., w[n - 1] equal to key (or -1) */
+int hash_set_scan(const size_t * w, int n, size_t key, int start)
+{
+  const __m128i k = _mm_set1_epi64x(key);
+  for(int b = start & ~3; b < n; b += 4) {
+    /* SSE2 compares 32-bit halves: a word matches if both halves do */
+    const __m128i * v = (const __m128i *) (w + b);
+    __m128i eq0 = _mm_cmpeq_epi32(_mm_loadu_si128(v), k);
+    __m128i eq1 = _mm_cmpeq_epi32(_mm_loadu_si128(v + 1), k);
+    eq0 = _mm_and_si128(eq0, _mm_shuffle_epi32(eq0, _MM_SHUFFLE(2, 3, 0, 1)));
+    eq1 = _mm_and_si128(eq1, _mm_shuffle_epi32(eq1, _MM_SHUFFLE(2, 3, 0, 1)));
+    int mask = _mm_movemask_pd(_mm_castsi128_pd(eq0))
+               | _mm_movemask_pd(_mm_castsi128_pd(eq1)) << 2;
+    if(b < start) mask &= ~0U << (start - b);
+    if(n - b < 4) mask &= (1 << (n - b)) - 1;
+    if(mask) return b + __builtin_ctz(mask);
+  }
+  return -1;
+}
+# else
+int hash_set_scan(const size_t * w, int n, size_t key, int start)
+{
+  for(int i = start; i < n; ++i) if(w[i] == key) return i;
+  return -1;
+}
+# endif
+
+/* Position of an element in a small set (key is its hash, needed only if
+   elements are not compared by address) */
+int hash_set_inline_find(const struct hash_set * self, const void * element,
+                         size_t key)
+{
+  const int n = ((const struct set *) self)->nelements;
+  if(self->same == same_pointer)
+    return hash_set_scan_pointers(self->inline_element, n, element);
+  if(key == 0) key = self->key_hash(element);
+  for(int i = hash_set_scan(self->inline_hash, n, key, 0); i != -1;
+      i = hash_set_scan(self->inline_hash, n, key, i + 1))
+    if(self->inline_element[i] == element
+       || self->same(self->inline_element[i], element)) return i;
+  return -1;
+}
+
+void hash_set_inline_drop(struct hash_set * self, const void * element)
+{
+  struct set * sself = (struct set *) self;
+  int i = hash_set_inline_find(self, element, 0);
+  if(i == -1) return;
+  int last = --sself->nelements;
+  self->inline_element[i] = self->inline_element[last];
+  self->inline_hash[i] = self->inline_hash[last];
+  self->inline_element[last] = NULL;
+  self->inline_hash[last] = 0;
+  return;
+}
+
+/* Move the elements of a small set to the heap, with room for n elements */
+void hash_set_spill(struct hash_set * self, int n)
+{
+  struct set * sself = (struct set *) self;
+  if(n < 2*HASH_SET_INLINE) n = 2*HASH_SET_INLINE;
+  sself->element = malloc(n*sizeof(void *));
+  self->element_hash = malloc(n*sizeof(size_t));
+  memcpy(sself->element, self->inline_element, sself->nelements*sizeof(void *));
+  memcpy(self->element_hash, self->inline_hash,
+         sself->nelements*sizeof(size_t));
+  sself->element_capacity = n;
+  int capacity = HASH_SET_MIN_CAPACITY;
+  while(4*(long) n > 3*(long) capacity) capacity *= 2;
+  hash_set_rehash(self, capacity);
+  return;
+}
+
+/* Slot of the table that holds an element with the given hash (or -1) */
+int hash_set_slot(const struct hash_set * self, const void * element,
+                  size_t key)
+{
+  const struct set * sself = (const struct set *) self;
+  const void * const * self_element = sself->element;
+  const int mask = self->capacity - 1;
+  for(int h = key & mask; self->slot[h] != -1; h = (h + 1) & mask) {
+    int i = self->slot[h];
+    if(self->element_hash[i] == key
+       && (self_element[i] == element
+           || self->same(self_element[i], element)))
+      return h;
+  }
+  return -1;
+}
+
+/* Position of an element in the element array (or -1) */
+int hash_set_find(const void * _self, const void * _element)
+{
+  const struct hash_set * self = _self;
+  if(!self->slot && self->same == same_pointer)
+    return hash_set_scan_pointers(self->inline_element,
+                                  ((const struct set *) self)->nelements,
+                                  _element);
+  if(!self->slot) return hash_set_inline_find(self, _element, 0);
+  int h = hash_set_slot(self, _element, self->key_hash(_element));
+  return h == -1 ? -1 : self->slot[h];
+}
+
+/* Rebuild the table with a new number of slots */
+void hash_set_rehash(struct hash_set * self, int capacity)
+{
+  const struct set * sself = (const struct set *) self;
+  free(self->slot);
+  self->capacity = capacity;
+  self->slot = malloc(capacity*sizeof(int));
+  for(int h = 0; h < capacity; ++h) self->slot[h] = -1;
+  const int mask = capacity - 1;
+  for(int i = 0; i < sself->nelements; ++i) {
+    int h = self->element_hash[i] & mask;
+    while(self->slot[h] != -1) h = (h + 1) & mask;
+    self->slot[h] = i;
+  }
+  return;
+}
+
+void hash_set_insert(void * _self, const void * _element)
+{
+  struct hash_set * self = _self;
+  struct set * sself = _self;
+  size_t key = self->key_hash(_element);
+  if(!self->slot) {
+    if(hash_set_inline_find(self, _element, key) != -1) return;
+    if(sself->nelements < HASH_SET_INLINE) {
+      self->inline_hash[sself->nelements] = key;
+      self->inline_element[sself->nelements++] = _element;
+      return;
+    }
+    hash_set_spill(self, 2*HASH_SET_INLINE);
+  }
+  if(hash_set_slot(self, _element, key) != -1) return;
+
+  if(sself->nelements == sself->element_capacity) {
+    sself->element_capacity = sself->element_capacity > 0 ?
+                              2*sself->element_capacity : HASH_SET_MIN_CAPACITY;
+    sself->element = realloc(sself->element,
+                             sself->element_capacity*sizeof(void *));
+    self->element_hash = realloc(self->element_hash,
+                                 sself->element_capacity*sizeof(size_t));
+  }
+  if(4*(sself->nelements + 1) > 3*self->capacity)
+    hash_set_rehash(self, 2*self->capacity);
+
+  const void ** self_element = sself->element;
+  const int mask = self->capacity - 1;
+  int h = key & mask;
+  while(self->slot[h] != -1) h = (h + 1) & mask;
+  self->slot[h] = sself->nelements;
+  self->element_hash[sself->nelements] = key;
+  self_element[sself->nelements++] = _element;
+  return;
+}
+
+void hash_set_drop(void * _self, const void * _element)
+{
+  struct hash_set * self = _self;
+  struct set * sself = _self;
+  if(!self->slot) {
+    hash_set_inline_drop(self, _element);
+    return;
+  }
+  int hole = hash_set_slot(self, _element, self->key_hash(_element));
+  if(hole == -1) return;
+  const void ** self_element = sself->element;
+  const int i = self->slot[hole];
+  const int mask = self->capacity - 1;
+
+  /* Backward shift: move later elements of the cluster into the hole if
+     their home slot is not between the hole and their current slot */
+  for(int h = (hole + 1) & mask; self->slot[h] != -1; h = (h + 1) & mask) {
+    int home = self->element_hash[self->slot[h]] & mask;
+    if(((h - home) & mask) >= ((h - hole) & mask)) {
+      self->slot[hole] = self->slot[h];
+      hole = h;
+    }
+  }
+  self->slot[hole] = -1;
+
+  /* Move the last element into position i */
+  const int last = sself->nelements - 1;
+  if(i != last) {
+    int h = self->element_hash[last] & mask;
+    while(self->slot[h] != last) h = (h + 1) & mask;
+    self->slot[h] = i;
+    self_element[i] = self_element[last];
+    self->element_hash[i] = self->element_hash[last];
+  }
+  self_element[last] = NULL;
+  sself->nelements--;
+  return;
+}
+
+/* Equal sets: same size and every element of one is in the other, which we
+   check with lookups in whichever of the two sets has a hash table */
+int hash_set_equal(const void * _A, const void * _B)
+{
+  const struct set * A = _A;
+  const struct set * B = _B;
+  if(A->nelements != B->nelements) return 0;
+  if(!set_has_index(B)) {
+    const struct set * tmp = A;
+    A = B;
+    B = tmp;
+  }
+  const void * const * A_element = A->element;
+  for(int i = 0; i < A->nelements; ++i)
+    if(find(B, A_element[i]) == -1) return 0;
+  return 1;
+}
+
+/*** Value set function implementations ***/
+static void * value_set_constructor(void * _self, va_list * args)
+{
+  hash_set_constructor(_self, args);
+  struct hash_set * self = _self;
+  self->key_hash = hash;
+  self->same = same_value;
+  return _self;
+}
+
+int same_value(const void * a, const void * b)
+{
+  return !differs((void *) a, (void *) b);
+}
+
+/*** Set differs and hash ***/
+int set_differs(void * _a, void * _b)
+{
+  if(_a == _b) return 0;
+  if(inherits_from(_a, set) && inherits_from(_b, set)) return !equal(_a, _b);
+  return 1;
+}
+
+size_t set_hash(const void * _self)
+{
+  const struct set * self = _self;
+  if(self->snapshot) {
+    void * S = self->snapshot(_self);
+    size_t h = set_hash(S);
+    delete(S);
+    return h;
+  }
+  const void * const * self_element = self->element;
+  size_t h = 0;
+  for(int i = 0; i < self->nelements; ++i)
+    if(self_element[i] != _self) h += hash_mix(hash(self_element[i]));
+  return h;
+}
+
+/*** Set algebra ***/
+/* Make room for n elements in a hash set */
+void hash_set_reserve(void * _self, int n)
+{
+  if(!inherits_from(_self, hash_set)) return;
+  struct hash_set * self = _self;
+  struct set * sself = _self;
+  if(!self->slot) {
+    if(n > HASH_SET_INLINE) hash_set_spill(self, n);
+    return;
+  }
+  if(n > sself->element_capacity) {
+    sself->element_capacity = n;
+    sself->element = realloc(sself->element, n*sizeof(void *));
+    self->element_hash = realloc(self->element_hash, n*sizeof(size_t));
+  }
+  int capacity = self->capacity;
+  while(4*(long) n > 3*(long) capacity) capacity *= 2;
+  if(capacity != self->capacity) hash_set_rehash(self, capacity);
+  return;
+}
+
+/* Does a set find its elements in constant time? */
+int set_has_index(const void * _self)
+{
+  return inherits_from(_self, hash_set) || inherits_from(_self, concurrent_set)
+         || inherits_from(_self, bit_set);
+}
+
+/* Set with a hash table holding the elements of _self */
+const void * set_index(const void * _self)
+{
+  if(set_has_index(_self)) return _self;
+  const struct set * self = set_dense(_self);
+  const void * const * self_element = self->element;
+  void * index = new_object(hash_set, NULL);
+  hash_set_reserve(index, self->nelements);
+  for(int i = 0; i < self->nelements; ++i) insert(index, self_element[i]);
+  set_dense_done(_self, self);
+  return index;
+}
+
+void set_index_done(const void * _self, const void * index)
+{
+  if(index != _self) delete((void *) index);
+  return;
+}
+
+/* Set with an element array holding the elements of _self */
+const void * set_dense(const void * _self)
+{
+  const struct set * self = _self;
+  if(self->snapshot) return self->snapshot(_self);
+  return _self;
+}
+
+void set_dense_done(const void * _self, const void * dense)
+{
+  set_index_done(_self, dense);
+  return;
+}
+
+/* Empty set of the class we use for results */
+void * set_result(const void * _A, int n)
+{
+  const struct Class * const * class = _A;
+  void * R = new_object(inherits_from(_A, hash_set) ? *class : hash_set, NULL);
+  hash_set_reserve(R, n);
+  return R;
+}
+
+/* Keep the elements of A that are (keep = 1) or are not (keep = 0) in index */
+void set_keep(void * _A, const void * index, int keep)
+{
+  struct set * A = _A;
+  if(A->snapshot) {
+    /* No element array: drop the elements one by one */
+    struct set * S = A->snapshot(_A);
+    const void * const * S_element = S->element;
+    for(int i = 0; i < S->nelements; ++i)
+      if((find(index, S_element[i]) != -1) != keep) drop(_A, S_element[i]);
+    delete(S);
+    return;
+  }
+  if(inherits_from(_A, bit_set)) {
+    bit_set_keep(_A, index, keep);
+    return;
+  }
+  void ** A_element = A->element;
+  struct hash_set * hA = inherits_from(_A, hash_set) ? _A : NULL;
+  int n = 0;
+  for(int i = 0; i < A->nelements; ++i) {
+    if((find(index, A_element[i]) != -1) == keep) {
+      if(hA) hA->element_hash[n] = hA->element_hash[i];
+      A_element[n++] = A_element[i];
+    }
+  }
+  for(int i = n; i < A->nelements; ++i) {
+    A_element[i] = NULL;
+    if(hA) hA->element_hash[i] = 0;
+  }
+  A->nelements = n;
+  if(hA && hA->slot) hash_set_rehash(hA, hA->capacity);
+  return;
+}
+
+/* Add the elements of B that are not in A (whose index is given, or NULL if
+   no element of B is in A) */
+void set_append_missing(void * _A, const void * indexA, const void * _B)
+{
+  struct set * A = _A;
+  const struct set * B = set_dense(_B);
+  const void * const * B_element = B->element;
+  if(set_has_index(_A) || A->snapshot) {
+    hash_set_reserve(_A, A->nelements + B->nelements);
+    for(int i = 0; i < B->nelements; ++i) insert(_A, B_element[i]);
+  } else {
+    set_reserve(_A, A->nelements + B->nelements);
+    const void ** A_element = A->element;
+    for(int i = 0; i < B->nelements; ++i)
+      if(!indexA || find(indexA, B_element[i]) == -1) {
+        A_element[A->nelements++] = B_element[i];
+        if(A->filter) set_filter_add(_A, B_element[i]);
+      }
+  }
+  set_dense_done(_B, B);
+  return;
+}
+
+/* A u B */
+void * set_union(const void * _A, const void * _B)
+{
+  if(!inherits_from(_A, set) || !inherits_from(_B, set)) return NULL;
+  const struct set * A = set_dense(_A);
+  const struct set * B = set_dense(_B);
+  void * R = set_result(_A, A->nelements + B->nelements);
+  const void * const * A_element = A->element;
+  const void * const * B_element = B->element;
+  for(int i = 0; i < A->nelements; ++i) insert(R, A_element[i]);
+  for(int i = 0; i < B->nelements; ++i) insert(R, B_element[i]);
+  set_dense_done(_A, A);
+  set_dense_done(_B, B);
+  return R;
+}
+
+/* Elements of A that are (keep = 1) or are not (keep = 0) in B */
+void * set_select(const void * _A, const void * _B, int keep)
+{
+  if(!inherits_from(_A, set) || !inherits_from(_B, set)) return NULL;
+  const struct set * A = set_dense(_A);
+  const void * const * A_element = A->element;
+  const void * indexB = set_index(_B);
+  void * R = set_result(_A, A->nelements);
+  for(int i = 0; i < A->nelements; ++i)
+    if((find(indexB, A_element[i]) != -1) == keep) insert(R, A_element[i]);
+  set_index_done(_B, indexB);
+  set_dense_done(_A, A);
+  return R;
+}
+
+/* A n B */
+void * set_intersection(const void * _A, const void * _B)
+{
+  return set_select(_A, _B, 1);
+}
+
+/* A - B */
+void * set_difference(const void * _A, const void * _B)
+{
+  return set_select(_A, _B, 0);
+}
+
+/* (A - B) u (B - A) */
+void * set_symmetric_difference(const void * _A, const void * _B)
+{
+  if(!inherits_from(_A, set) || !inherits_from(_B, set)) return NULL;
+  const struct set * A = set_dense(_A);
+  const struct set * B = set_dense(_B);
+  const void * const * A_element = A->element;
+  const void * const * B_element = B->element;
+  const void * indexA = set_index(_A);
+  const void * indexB = set_index(_B);
+  void * R = set_result(_A, A->nelements + B->nelements);
+  for(int i = 0; i < A->nelements; ++i)
+    if(find(indexB, A_element[i]) == -1) insert(R, A_element[i]);
+  for(int i = 0; i < B->nelements; ++i)
+    if(find(indexA, B_element[i]) == -1) insert(R, B_element[i]);
+  set_index_done(_A, indexA);
+  set_index_done(_B, indexB);
+  set_dense_done(_A, A);
+  set_dense_done(_B, B);
+  return R;
+}
+
+/* A = A u B */
+void set_union_in_place(void * _A, const void * _B)
+{
+  if(!inherits_from(_A, set) || !inherits_from(_B, set) || _A == _B) return;
+  const void * indexA = set_index(_A);
+  set_append_missing(_A, indexA, _B);
+  set_index_done(_A, indexA);
+  return;
+}
+
+/* A = A n B */
+void set_intersection_in_place(void * _A, const void * _B)
+{
+  if(!inherits_from(_A, set) || !inherits_from(_B, set) || _A == _B) return;
+  const void * indexB = set_index(_B);
+  set_keep(_A, indexB, 1);
+  set_index_done(_B, indexB);
+  return;
+}
+
+/* A = A - B */
+void set_difference_in_place(void * _A, const void * _B)
+{
+  if(!inherits_from(_A, set) || !inherits_from(_B, set)) return;
+  if(_A == _B) {
+    void * empty = new_object(hash_set, NULL);
+    set_keep(_A, empty, 1);
+    delete(empty);
+    return;
+  }
+  const void * indexB = set_index(_B);
+  set_keep(_A, indexB, 0);
+  set_index_done(_B, indexB);
+  return;
+}
+
+/* A = (A - B) u (B - A) */
+void set_symmetric_difference_in_place(void * _A, const void * _B)
+{
+  if(!inherits_from(_A, set) || !inherits_from(_B, set)) return;
+  if(_A == _B) {
+    set_difference_in_place(_A, _B);
+    return;
+  }
+  /* The elements of B that are not in A, found before A changes */
+  void * B_only = set_difference(_B, _A);
+  const void * indexB = set_index(_B);
+  set_keep(_A, indexB, 0);
+  set_index_done(_B, indexB);
+  set_append_missing(_A, NULL, B_only);
+  delete(B_only);
+  return;
+}
+
+/*** Concurrent set function implementations ***/
+# define CONCURRENT_SET_MIN_CAPACITY 16
+
+static const char concurrent_set_tombstone = 0;
+# define TOMBSTONE ((const void *) &concurrent_set_tombstone)
+
+struct concurrent_table * concurrent_table_new(int capacity)
+{
+  struct concurrent_table * t
+    = calloc(1, sizeof(struct concurrent_table) + capacity*sizeof(void *));
+  t->capacity = capacity;
+  return t;
+}
+
+static void * concurrent_set_constructor(void * _self, va_list * args)
+{
+  set_constructor(_self, args);
+  struct abstract_object * obj = _self;
+  obj->clone = concurrent_set_clone;
+  struct set * sself = _self;
+  sself->find = concurrent_set_find;
+  sself->insert = concurrent_set_insert;
+  sself->drop = concurrent_set_drop;
+  sself->equal = concurrent_set_equal;
+  sself->snapshot = concurrent_set_snapshot;
+  struct concurrent_set * self = _self;
+  for(int s = 0; s < CONCURRENT_SET_SEGMENTS; ++s) {
+    self->segment[s].table = concurrent_table_new(CONCURRENT_SET_MIN_CAPACITY);
+    self->segment[s].retired = NULL;
+    self->segment[s].used = 0;
+    pthread_mutex_init(&self->segment[s].lock, NULL);
+  }
+  return _self;
+}
+
+static void * concurrent_set_destructor(void * _self)
+{
+  struct concurrent_set * self = _self;
+  for(int s = 0; s < CONCURRENT_SET_SEGMENTS; ++s) {
+    struct concurrent_table * t = self->segment[s].retired;
+    while(t) {
+      struct concurrent_table * next = t->retired;
+      free(t);
+      t = next;
+    }
+    free(self->segment[s].table);
+    pthread_mutex_destroy(&self->segment[s].lock);
+  }
+  return set_destructor(_self);
+}
+
+/* Clone a concurrent set (the elements are shared, as for sets) */
+static void * concurrent_set_clone(const void * _self)
+{
+  if(inherits_from(_self, concurrent_set)) {
+    const struct concurrent_set * self = _self;
+    void * A = new_object(concurrent_set, NULL);
+    for(int s = 0; s < CONCURRENT_SET_SEGMENTS; ++s) {
+      const struct concurrent_table * t
+        = __atomic_load_n(&self->segment[s].table, __ATOMIC_ACQUIRE);
+      for(int i = 0; i < t->capacity; ++i) {
+        const void * e = __atomic_load_n(&t->slot[i], __ATOMIC_ACQUIRE);
+        if(e && e != TOMBSTONE) insert(A, e);
+      }
+    }
+    return A;
+  }
+  return NULL;
+}
+
+struct concurrent_segment * concurrent_segment_of(const void * _self,
+                                                  size_t key)
+{
+  const struct concurrent_set * self = _self;
+  int s = (key ^ key >> 16 ^ key >> 24) & (CONCURRENT_SET_SEGMENTS - 1);
+  return (struct concurrent_segment *) &self->segment[s];
+}
+
+/* Slot of an element in a table (or -1) */
+int concurrent_table_slot(const struct concurrent_table * t,
+                          const void * element, size_t key)
+{
+  const int mask = t->capacity - 1;
+  for(int n = 0, h = key & mask; n < t->capacity; ++n, h = (h + 1) & mask) {
+    const void * e = __atomic_load_n(&t->slot[h], __ATOMIC_ACQUIRE);
+    if(e == element) return h;
+    if(e == NULL) return -1;
+  }
+  return -1;
+}
+
+/* Lock-free lookup */
+int concurrent_set_find(const void * _self, const void * _element)
+{
+  size_t key = pointer_hash(_element);
+  const struct concurrent_segment * seg = concurrent_segment_of(_self, key);
+  const struct concurrent_table * t
+    = __atomic_load_n(&seg->table, __ATOMIC_ACQUIRE);
+  return concurrent_table_slot(t, _element, key);
+}
+
+/* Copy the elements of a segment to a new table (with the lock taken) */
+void concurrent_segment_rebuild(struct concurrent_segment * seg)
+{
+  struct concurrent_table * t = seg->table;
+  int live = 0;
+  for(int i = 0; i < t->capacity; ++i)
+    if(t->slot[i] && t->slot[i] != TOMBSTONE) live++;
+  int capacity = 4*live > t->capacity ? 2*t->capacity : t->capacity;
+  struct concurrent_table * u = concurrent_table_new(capacity);
+  const int mask = capacity - 1;
+  for(int i = 0; i < t->capacity; ++i) {
+    const void * e = t->slot[i];
+    if(e && e != TOMBSTONE) {
+      int h = pointer_hash(e) & mask;
+      while(u->slot[h]) h = (h + 1) & mask;
+      u->slot[h] = e;
+    }
+  }
+  seg->used = live;
+  __atomic_store_n(&seg->table, u, __ATOMIC_RELEASE);
+  t->retired = seg->retired;
+  seg->retired = t;
+  return;
+}
+
+void concurrent_set_insert(void * _self, const void * _element)
+{
+  size_t key = pointer_hash(_element);
+  struct concurrent_segment * seg = concurrent_segment_of(_self, key);
+  pthread_mutex_lock(&seg->lock);
+  if(4*(seg->used + 1) > 3*seg->table->capacity)
+    concurrent_segment_rebuild(seg);
+  struct concurrent_table * t = seg->table;
+  const int mask = t->capacity - 1;
+  int h = key & mask, free_slot = -1;
+  for(; t->slot[h]; h = (h + 1) & mask) {
+    if(t->slot[h] == _element) {
+      pthread_mutex_unlock(&seg->lock);
+      return;
+    }
+    if(t->slot[h] == TOMBSTONE && free_slot == -1) free_slot = h;
+  }
+  if(free_slot == -1) {
+    free_slot = h;
+    seg->used++;
+  }
+  __atomic_store_n(&t->slot[free_slot], _element, __ATOMIC_RELEASE);
+  struct set * sself = _self;
+  __atomic_fetch_add(&sself->nelements, 1, __ATOMIC_RELAXED);
+  pthread_mutex_unlock(&seg->lock);
+  return;
+}
+
+void concurrent_set_drop(void * _self, const void * _element)
+{
+  size_t key = pointer_hash(_element);
+  struct concurrent_segment * seg = concurrent_segment_of(_self, key);
+  pthread_mutex_lock(&seg->lock);
+  int h = concurrent_table_slot(seg->table, _element, key);
+  if(h != -1) {
+    __atomic_store_n(&seg->table->slot[h], TOMBSTONE, __ATOMIC_RELEASE);
+    struct set * sself = _self;
+    __atomic_fetch_sub(&sself->nelements, 1, __ATOMIC_RELAXED);
+  }
+  pthread_mutex_unlock(&seg->lock);
+  return;
+}
+
+/* Hash set with the elements found in the tables */
+void * concurrent_set_snapshot(const void * _self)
+{
+  if(!inherits_from(_self, concurrent_set)) return NULL;
+  const struct concurrent_set * self = _self;
+  const struct set * sself = _self;
+  void * S = new_object(hash_set, NULL);
+  hash_set_reserve(S, __atomic_load_n(&sself->nelements, __ATOMIC_RELAXED));
+  for(int s = 0; s < CONCURRENT_SET_SEGMENTS; ++s) {
+    const struct concurrent_table * t
+      = __atomic_load_n(&self->segment[s].table, __ATOMIC_ACQUIRE);
+    for(int i = 0; i < t->capacity; ++i) {
+      const void * e = __atomic_load_n(&t->slot[i], __ATOMIC_ACQUIRE);
+      if(e && e != TOMBSTONE) insert(S, e);
+    }
+  }
+  return S;
+}
+
+int concurrent_set_equal(const void * _A, const void * _B)
+{
+  void * S = concurrent_set_snapshot(_A);
+  int result = equal(S, _B);
+  delete(S);
+  return result;
+}
+
+/*** Bit set function implementations ***/
+static void * bit_set_constructor(void * _self, va_list * args)
+{
+  set_constructor(_self, args);
+  struct abstract_object * obj = _self;
+  obj->clone = bit_set_clone;
+  struct set * sself = _self;
+  sself->find = bit_set_find;
+  sself->insert = bit_set_insert;
+  sself->drop = bit_set_drop;
+  sself->equal = bit_set_equal;
+  struct bit_set * self = _self;
+  self->universe = va_arg(*args, int);
+  self->id = va_arg(*args, int (*)(const void *));
+  if(self->universe < 0) self->universe = 0;
+  self->bits = calloc(self->universe/64 + 1, sizeof(uint64_t));
+  self->position = malloc((self->universe + 1)*sizeof(int));
+  sself->element_capacity = 0;
+  return _self;
+}
+
+static void * bit_set_destructor(void * _self)
+{
+  struct bit_set * self = _self;
+  free(self->bits);
+  free(self->position);
+  return set_destructor(_self);
+}
+
+/* Clone a bit set (the elements are shared, as for sets) */
+static void * bit_set_clone(const void * _self)
+{
+  if(inherits_from(_self, bit_set)) {
+    const struct bit_set * self = _self;
+    const struct set * sself = _self;
+    void * A = new_object(bit_set, self->universe, self->id);
+    const void * const * self_element = sself->element;
+    for(int i = 0; i < sself->nelements; ++i) insert(A, self_element[i]);
+    return A;
+  }
+  return NULL;
+}
+
+int bit_set_find(const void * _self, const void * _element)
+{
+  const struct bit_set * self = _self;
+  unsigned int i = self->id(_element);
+  if(i >= (unsigned int) self->universe
+     || !(self->bits[i/64] >> (i % 64) & 1)) return -1;
+  return self->position[i];
+}
+
+void bit_set_insert(void * _self, const void * _element)
+{
+  struct bit_set * self = _self;
+  struct set * sself = _self;
+  unsigned int i = self->id(_element);
+  if(i >= (unsigned int) self->universe
+     || self->bits[i/64] >> (i % 64) & 1) return;
+  if(sself->nelements == sself->element_capacity) {
+    sself->element_capacity = sself->element_capacity > 0 ?
+                              2*sself->element_capacity : 16;
+    if(sself->element_capacity > self->universe)
+      sself->element_capacity = self->universe;
+    sself->element = realloc(sself->element,
+                             sself->element_capacity*sizeof(void *));
+  }
+  const void ** self_element = sself->element;
+  self->bits[i/64] |= (uint64_t) 1 << (i % 64);
+  self->position[i] = sself->nelements;
+  self_element[sself->nelements++] = _element;
+  return;
+}
+
+void bit_set_drop(void * _self, const void * _element)
+{
+  struct bit_set * self = _self;
+  struct set * sself = _self;
+  int p = bit_set_find(_self, _element);
+  if(p == -1) return;
+  const void ** self_element = sself->element;
+  unsigned int i = self->id(_element);
+  self->bits[i/64] &= ~((uint64_t) 1 << (i % 64));
+  const int last = --sself->nelements;
+  if(p != last) {
+    self_element[p] = self_element[last];
+    self->position[self->id(self_element[p])] = p;
+  }
+  self_element[last] = NULL;
+  return;
+}
+
+int bit_set_equal(const void * _A, const void * _B)
+{
+  const struct bit_set * A = _A;
+  const struct bit_set * B = _B;
+  if(inherits_from(_B, bit_set) && A->universe == B->universe
+     && A->id == B->id) {
+    for(int w = 0; w <= A->universe/64; ++w)
+      if(A->bits[w] != B->bits[w]) return 0;
+    return 1;
+  }
+  return set_equal(_A, _B);
+}
+
+/* Drop the elements that are not (keep = 1) or are (keep = 0) in index */
+void bit_set_keep(void * _self, const void * index, int keep)
+{
+  struct bit_set * self = _self;
+  struct set * sself = _self;
+  const void ** self_element = sself->element;
+  int n = 0;
+  for(int k = 0; k < sself->nelements; ++k) {
+    unsigned int i = self->id(self_element[k]);
+    if((find(index, self_element[k]) != -1) == keep) {
+      self->position[i] = n;
+      self_element[n++] = self_element[k];
+    } else self->bits[i/64] &= ~((uint64_t) 1 << (i % 64));
+  }
+  for(int k = n; k < sself->nelements; ++k) self_element[k] = NULL;
+  sself->nelements = n;
+  return;
+}
+
+/*** Bloom filter function implementations ***/
+struct bloom_filter * bloom_filter_new(int capacity, double rate,
+                                       size_t (* key_hash)(const void *))
+{
+  if(!(rate > 0.0 && rate < 1.0)) rate = 0.01;
+  if(capacity < BLOOM_FILTER_MIN_CAPACITY) capacity = BLOOM_FILTER_MIN_CAPACITY;
+  double bits = 1.2*(-log(rate)/(M_LN2*M_LN2));
+  struct bloom_filter * f = malloc(sizeof(struct bloom_filter));
+  f->k = (int) (bits*M_LN2/1.2 + 0.5);
+  if(f->k < 1) f->k = 1;
+  if(f->k > 16) f->k = 16;
+  f->nblocks = (long) ceil(capacity*bits/(64*BLOOM_BLOCK_WORDS));
+  size_t size = f->nblocks*BLOOM_BLOCK_WORDS*sizeof(uint64_t);
+  f->bits = aligned_alloc(BLOOM_BLOCK_WORDS*sizeof(uint64_t), size);
+  memset(f->bits, 0, size);
+  f->rate = rate;
+  f->capacity = capacity;
+  f->count = 0;
+  f->key_hash = key_hash;
+  f->hits = f->misses = f->false_positives = f->rebuilds = 0;
+  return f;
+}
+
+void bloom_filter_free(struct bloom_filter * f)
+{
+  if(f) free(f->bits);
+  free(f);
+  return;
+}
+
+/* Block of the filter for a scrambled key */
+uint64_t * bloom_filter_block(const struct bloom_filter * f, uint64_t h)
+{
+  return f->bits + BLOOM_BLOCK_WORDS*(long) (((h >> 32)*f->nblocks) >> 32);
+}
+
+void bloom_filter_add(struct bloom_filter * f, size_t key)
+{
+  uint64_t h = hash_mix(key);
+  uint64_t * block = bloom_filter_block(f, h);
+  unsigned a = h & 511, b = ((h >> 9) & 511) | 1;
+  for(int i = 0; i < f->k; ++i, a = (a + b) & 511)
+    block[a/64] |= (uint64_t) 1 << (a % 64);
+  f->count++;
+  return;
+}
+
+/* 0 if the element with this key was never added, 1 if it may have been */
+int bloom_filter_may_contain(const struct bloom_filter * f, size_t key)
+{
+  uint64_t h = hash_mix(key);
+  const uint64_t * block = bloom_filter_block(f, h);
+  unsigned a = h & 511, b = ((h >> 9) & 511) | 1;
+  for(int i = 0; i < f->k; ++i, a = (a + b) & 511)
+    if(!((block[a/64] >> (a % 64)) & 1)) return 0;
+  return 1;
+}
+
+void bloom_filter_display(const struct bloom_filter * f, FILE * fp)
+{
+  fprintf(fp, "Filter: %ld blocks, %d bits per element, built for %d "
+          "elements\n", f->nblocks, f->k, f->capacity);
+  fprintf(fp, "Filter hits: %ld, misses: %ld, false positives: %ld, "
+          "rebuilds: %ld\n", f->hits, f->misses, f->false_positives,
+          f->rebuilds);
+  return;
+}
+
+void set_filter_rebuild(void * _self)
+{
+  struct set * self = _self;
+  struct bloom_filter * old = self->filter;
+  struct bloom_filter * f = bloom_filter_new(2*self->nelements, old->rate,
+                                             old->key_hash);
+  f->hits = old->hits;
+  f->misses = old->misses;
+  f->false_positives = old->false_positives;
+  f->rebuilds = old->rebuilds + 1;
+  const struct set * dense = set_dense(_self);
+  const void * const * element = dense->element;
+  for(int i = 0; i < dense->nelements; ++i)
+    bloom_filter_add(f, f->key_hash(element[i]));
+  set_dense_done(_self, dense);
+  bloom_filter_free(old);
+  self->filter = f;
+  return;
+}
+
+/* Give a set a Bloom filter with the given false positive rate */
+void set_attach_filter(void * _self, double rate,
+                       size_t (* key_hash)(const void * element))
+{
+  if(!inherits_from(_self, set)) return;
+  struct set * self = _self;
+  if(!key_hash) {
+    if(inherits_from(_self, hash_set)) {
+      struct hash_set * hself = _self;
+      key_hash = hself->key_hash;
+    } else key_hash = pointer_hash;
+  }
+  bloom_filter_free(self->filter);
+  self->filter = bloom_filter_new(0, rate, key_hash);
+  self->filter->rebuilds = -1; /* The first build does not count */
+  set_filter_rebuild(_self);
+  return;
+}
+
+void set_detach_filter(void * _self)
+{
+  if(!inherits_from(_self, set)) return;
+  struct set * self = _self;
+  bloom_filter_free(self->filter);
+  self->filter = NULL;
+  return;
+}
+
+/* find for sets with a filter */
+int set_filtered_find(const void * _self, const void * _element)
+{
+  const struct set * self = _self;
+  struct bloom_filter * f = self->filter;
+  if(!bloom_filter_may_contain(f, f->key_hash(_element))) {
+    f->misses++;
+    return -1;
+  }
+  int i = self->find ? self->find(_self, _element) : -1;
+  if(i == -1) f->false_positives++;
+  else f->hits++;
+  return i;
+}
+
+/* Add a new element of a set to its filter (rebuilding it if it is full) */
+void set_filter_add(void * _self, const void * _element)
+{
+  struct set * self = _self;
+  struct bloom_filter * f = self->filter;
+  bloom_filter_add(f, f->key_hash(_element));
+  if(f->count > f->capacity) set_filter_rebuild(_self);
+  return;
+}
+
+/*** Bulk construction ***/
+/* Make room for n elements in a set */
+void set_reserve(void * _self, int n)
+{
+  if(!inherits_from(_self, set)) return;
+  struct set * self = _self;
+  if(inherits_from(_self, hash_set)) hash_set_reserve(_self, n);
+  else if(!self->snapshot && n > self->element_capacity) {
+    self->element = realloc(self->element, n*sizeof(void *));
+    self->element_capacity = n;
+  }
+  return;
+}
+
+/* Give back the memory that a hash set does not use */
+void hash_set_shrink(struct hash_set * self)
+{
+  struct set * sself = (struct set *) self;
+  if(!self->slot) return;
+  if(sself->nelements <= HASH_SET_INLINE) {
+    memcpy(self->inline_element, sself->element,
+           sself->nelements*sizeof(void *));
+    memcpy(self->inline_hash, self->element_hash,
+           sself->nelements*sizeof(size_t));
+    for(int i = sself->nelements; i < HASH_SET_INLINE; ++i) {
+      self->inline_element[i] = NULL;
+      self->inline_hash[i] = 0;
+    }
+    free(sself->element);
+    free(self->element_hash);
+    free(self->slot);
+    sself->element = self->inline_element;
+    self->element_hash = self->inline_hash;
+    sself->element_capacity = HASH_SET_INLINE;
+    self->slot = NULL;
+    self->capacity = 0;
+    return;
+  }
+  sself->element_capacity = sself->nelements;
+  sself->element = realloc(sself->element, sself->nelements*sizeof(void *));
+  self->element_hash = realloc(self->element_hash,
+                               sself->nelements*sizeof(size_t));
+  int capacity = HASH_SET_MIN_CAPACITY;
+  while(4*(long) sself->nelements > 3*(long) capacity) capacity *= 2;
+  if(capacity != self->capacity) hash_set_rehash(self, capacity);
+  return;
+}
+
+/* Give back the memory that a set does not use */
+void set_shrink(void * _self)
+{
+  if(!inherits_from(_self, set)) return;
+  struct set * self = _self;
+  if(inherits_from(_self, hash_set)) hash_set_shrink(_self);
+  else if(!self->snapshot && self->element_capacity > self->nelements) {
+    if(self->nelements == 0) {
+      free(self->element);
+      self->element = NULL;
+    } else
+      self->element = realloc(self->element, self->nelements*sizeof(void *));
+    self->element_capacity = self->nelements;
+  }
+  return;
+}
+
+/* Put p in a table of pointers (return 0 if it was there already) */
+int pointer_table_put(const void ** table, size_t mask, const void * p)
+{
+  size_t h = pointer_hash(p) & mask;
+  while(table[h]) {
+    if(table[h] == p) return 0;
+    h = (h + 1) & mask;
+  }
+  table[h] = p;
+  return 1;
+}
+
+/* Insert count objects into a set */
+void set_insert_many(void * _self, void * const * objects, int count)
+{
+  if(!inherits_from(_self, set) || count <= 0) return;
+  struct set * self = _self;
+  if(set_has_index(_self) || self->snapshot || self->insert != set_insert) {
+    set_reserve(_self, self->nelements + count);
+    for(int i = 0; i < count; ++i) insert(_self, objects[i]);
+    return;
+  }
+
+  /* Plain sets: a table with the elements we have so far */
+  size_t capacity = 16;
+  while(capacity < 2*((size_t) self->nelements + count)) capacity *= 2;
+  const void ** table = calloc(capacity, sizeof(void *));
+  const void ** self_element = self->element;
+  for(int i = 0; i < self->nelements; ++i)
+    pointer_table_put(table, capacity - 1, self_element[i]);
+  set_reserve(_self, self->nelements + count);
+  self_element = self->element;
+  for(int i = 0; i < count; ++i)
+    if(inherits_from(objects[i], abstract_object)
+       && pointer_table_put(table, capacity - 1, objects[i])) {
+      self_element[self->nelements++] = objects[i];
+      if(self->filter) set_filter_add(_self, objects[i]);
+    }
+  free(table);
+  return;
+}
+
+/* New set of some class with the given objects */
+void * set_from_array(const void * class, void * const * objects, int count)
+{
+  /* Only classes whose constructors take no arguments */
+  if(class != set && class != hash_set && class != value_set
+     && class != concurrent_set) return NULL;
+  void * S = new_object(class, NULL);
+  set_insert_many(S, objects, count);
+  return S;
+}
+
+/* New set of some class with the elements of a list (in any mode) */
+void * set_from_list(const void * class, const struct obj_list * list)
+{
+  int start[2], count[2];
+  list_runs(list, start, count);
+  void * S = set_from_array(class, list->element + start[0], count[0]);
+  if(S) set_insert_many(S, list->element + start[1], count[1]);
+  return S;
+}
+
+/*** Set iterator ***/
+struct set_iterator {
+  const struct array_iterator _; /* This item must come first */
+  const void * S;
+  const struct set * dense; /* S, or a snapshot of it */
+};
+
+static void * set_iterator_constructor(void * _self, va_list * args);
+static void * set_iterator_destructor(void * _self);
+
+static const Class _set_iterator
+  = {sizeof(struct set_iterator), "set iterator", &_array_iterator,
+     set_iterator_constructor, set_iterator_destructor};
+
+const void * set_iterator = &_set_iterator;
+
+static void * set_iterator_constructor(void * _self, va_list * args)
+{
+  array_iterator_constructor(_self, args);
+  struct set_iterator * self = _self;
+  struct array_iterator * aself = _self;
+  aself->indirect = 1;
+  self->S = va_arg(*args, const void *);
+  self->dense = NULL;
+  if(self->S && inherits_from(self->S, set)) {
+    self->dense = set_dense(self->S);
+    const int n = self->dense->nelements;
+    array_iterator_runs(_self, self->dense->element, sizeof(void *), n, 0, 1,
+                        n);
+  }
+  return _self;
+}
+
+static void * set_iterator_destructor(void * _self)
+{
+  struct set_iterator * self = _self;
+  if(self->dense) set_dense_done(self->S, self->dense);
+  return NULL;
+}
+
 # endif
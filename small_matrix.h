@@ -0,0 +1,407 @@
+# ifndef SMALL_MATRIX_H
+# define SMALL_MATRIX_H
+# include <stdio.h>
+# include <stdlib.h>
+# include <stdarg.h>
+# include <string.h>
+# include <math.h>
+# include "object.h"
+# include "vector.h"
+
+/*** Matrix batch object definition ***/
+typedef enum {SMALL_MATRIX_CONTIGUOUS = 0, SMALL_MATRIX_INTERLEAVED}
+  small_matrix_layout;
+
+struct matrix_batch {
+  const struct abstract_object _; /* This item must come first */
+  int n; /* Every matrix is n x n */
+  int count; /* Number of matrices */
+  small_matrix_layout layout;
+  real * dat;
+};
+
+static void * matrix_batch_constructor(void * _self, va_list * args);
+static void * matrix_batch_destructor(void * _self);
+static void * matrix_batch_clone(const void * _self);
+static void * matrix_batch_display(const void * _self, FILE * fp);
+
+static const Class _matrix_batch
+  = {sizeof(struct matrix_batch), "matrix batch", &_abstract_object,
+     matrix_batch_constructor, matrix_batch_destructor};
+
+const void * matrix_batch = &_matrix_batch;
+
+/*** Matrix batch operations ***/
+real * batch_element(const void * _A, int b, int i, int j);
+void * batch_dot(const void * _A, const void * _B);
+void batch_matvec(const void * _A, const real * x, real * y);
+void * batch_transpose(const void * _A);
+void * batch_inverse(const void * _A);
+void batch_determinant(const void * _A, real * det);
+
+/*** Function definitions ***/
+int small_matrix_size_ok(int n) {return n == 2 || n == 3 || n == 4 || n == 6;}
+
+static void * matrix_batch_constructor(void * _self, va_list * args)
+{
+  struct abstract_object * obj = abstract_object_constructor(_self, args);
+  obj->clone = matrix_batch_clone;
+  obj->display = matrix_batch_display;
+  struct matrix_batch * self = _self;
+  self->n = 0;
+  self->count = 0;
+  self->layout = SMALL_MATRIX_CONTIGUOUS;
+  self->dat = NULL;
+
+  int n = va_arg(*args, int);
+  if(small_matrix_size_ok(n)) {
+    int count = va_arg(*args, int);
+    small_matrix_layout layout = va_arg(*args, small_matrix_layout);
+    if(count > 0) {
+      self->n = n;
+      self->count = count;
+      self->layout = layout == SMALL_MATRIX_INTERLEAVED ?
+                     SMALL_MATRIX_INTERLEAVED : SMALL_MATRIX_CONTIGUOUS;
+      self->dat = calloc((size_t) n*n*count, sizeof(real));
+    }
+  }
+
+  return _self;
+}
+
+static void * matrix_batch_destructor(void * _self)
+{
+  struct matrix_batch * self = _self;
+  free(self->dat);
+  return NULL;
+}
+
+static void * matrix_batch_clone(const void * _self)
+{
+  if(inherits_from(_self, matrix_batch)) {
+    const struct matrix_batch * self = _self;
+    new(A, matrix_batch, self->n, self->count, self->layout);
+    if(self->dat)
+      memcpy(A->dat, self->dat,
+             (size_t) self->n*self->n*self->count*sizeof(real));
+    return A;
+  }
+  return NULL;
+}
+
+static void * matrix_batch_display(const void * _self, FILE * fp)
+{
+  abstract_object_display(_self, fp);
+
+  if(inherits_from(_self, matrix_batch)) {
+    const struct matrix_batch * self = _self;
+    fprintf(fp, "Matrices: %d (%d x %d, %s)\n", self->count, self->n, self->n,
+            self->layout == SMALL_MATRIX_INTERLEAVED ? "interleaved"
+                                                    : "contiguous");
+  }
+  return NULL;
+}
+
+/* Address of element (i, j) of matrix b */
+real * batch_element(const void * _A, int b, int i, int j)
+{
+  const struct matrix_batch * A = _A;
+  if(inherits_from(A, matrix_batch) && b >= 0 && b < A->count
+     && i >= 0 && i < A->n && j >= 0 && j < A->n) {
+    if(A->layout == SMALL_MATRIX_INTERLEAVED)
+      return A->dat + (long int) A->count*(A->n*i + j) + b;
+    return A->dat + (long int) A->n*A->n*b + A->n*i + j;
+  }
+  return NULL;
+}
+
+# ifndef SMALL_MATRIX_CHUNK
+# define SMALL_MATRIX_CHUNK 256
+# endif
+
+# define SMALL_MATRIX_KERNELS(N) \
+void small_dot_##N(int count, const real * restrict A, \
+                   const real * restrict B, real * restrict C) \
+{ \
+  for(long int b = 0; b < count; ++b) { \
+    const real * a = A + N*N*b; \
+    const real * x = B + N*N*b; \
+    real * c = C + N*N*b; \
+    for(int i = 0; i < N; ++i) \
+      for(int j = 0; j < N; ++j) { \
+        real sum = 0; \
+        for(int k = 0; k < N; ++k) sum += a[N*i + k]*x[N*k + j]; \
+        c[N*i + j] = sum; \
+      } \
+  } \
+} \
+\
+void small_dot_interleaved_##N(int count, const real * restrict A, \
+                               const real * restrict B, real * restrict C) \
+{ \
+  for(int b0 = 0; b0 < count; b0 += SMALL_MATRIX_CHUNK) { \
+    const int nb = count - b0 < SMALL_MATRIX_CHUNK ? \
+                   count - b0 : SMALL_MATRIX_CHUNK; \
+    for(int i = 0; i < N; ++i) \
+      for(int j = 0; j < N; ++j) { \
+        real * restrict c = C + (long int) count*(N*i + j) + b0; \
+        for(int b = 0; b < nb; ++b) c[b] = 0; \
+        for(int k = 0; k < N; ++k) { \
+          const real * restrict a = A + (long int) count*(N*i + k) + b0; \
+          const real * restrict x = B + (long int) count*(N*k + j) + b0; \
+          for(int b = 0; b < nb; ++b) c[b] += a[b]*x[b]; \
+        } \
+      } \
+  } \
+} \
+\
+void small_matvec_##N(int count, const real * restrict A, \
+                      const real * restrict x, real * restrict y) \
+{ \
+  for(long int b = 0; b < count; ++b) { \
+    const real * a = A + N*N*b; \
+    for(int i = 0; i < N; ++i) { \
+      real sum = 0; \
+      for(int j = 0; j < N; ++j) sum += a[N*i + j]*x[N*b + j]; \
+      y[N*b + i] = sum; \
+    } \
+  } \
+} \
+\
+void small_matvec_interleaved_##N(int count, const real * restrict A, \
+                                  const real * restrict x, \
+                                  real * restrict y) \
+{ \
+  for(int b0 = 0; b0 < count; b0 += SMALL_MATRIX_CHUNK) { \
+    const int nb = count - b0 < SMALL_MATRIX_CHUNK ? \
+                   count - b0 : SMALL_MATRIX_CHUNK; \
+    for(int i = 0; i < N; ++i) { \
+      real * restrict yi = y + (long int) count*i + b0; \
+      for(int b = 0; b < nb; ++b) yi[b] = 0; \
+      for(int j = 0; j < N; ++j) { \
+        const real * restrict a = A + (long int) count*(N*i + j) + b0; \
+        const real * restrict xj = x + (long int) count*j + b0; \
+        for(int b = 0; b < nb; ++b) yi[b] += a[b]*xj[b]; \
+      } \
+    } \
+  } \
+} \
+\
+void small_transpose_##N(const real * a, real * t, long int s) \
+{ \
+  for(int i = 0; i < N; ++i) \
+    for(int j = 0; j < N; ++j) t[s*(N*i + j)] = a[s*(N*j + i)]; \
+}
+
+/* Closed formulas for 2 x 2 and 3 x 3 matrices */
+real small_det_2(const real * a, long int s)
+{
+  return a[0]*a[3*s] - a[s]*a[2*s];
+}
+
+real small_det_3(const real * a, long int s)
+{
+  return a[0]*(a[4*s]*a[8*s] - a[5*s]*a[7*s])
+       - a[s]*(a[3*s]*a[8*s] - a[5*s]*a[6*s])
+       + a[2*s]*(a[3*s]*a[7*s] - a[4*s]*a[6*s]);
+}
+
+void small_inverse_2(const real * a, real * inv, long int s)
+{
+  const real det = small_det_2(a, s);
+  if(det == 0) {
+    for(int i = 0; i < 4; ++i) inv[s*i] = NAN;
+    return;
+  }
+  const real a0 = a[0], a1 = a[s], a2 = a[2*s], a3 = a[3*s];
+  inv[0] = a3/det; inv[s] = -a1/det;
+  inv[2*s] = -a2/det; inv[3*s] = a0/det;
+  return;
+}
+
+void small_inverse_3(const real * a, real * inv, long int s)
+{
+  const real det = small_det_3(a, s);
+  if(det == 0) {
+    for(int i = 0; i < 9; ++i) inv[s*i] = NAN;
+    return;
+  }
+  real m[9];
+  for(int i = 0; i < 9; ++i) m[i] = a[s*i];
+  inv[0]   = (m[4]*m[8] - m[5]*m[7])/det;
+  inv[s]   = (m[2]*m[7] - m[1]*m[8])/det;
+  inv[2*s] = (m[1]*m[5] - m[2]*m[4])/det;
+  inv[3*s] = (m[5]*m[6] - m[3]*m[8])/det;
+  inv[4*s] = (m[0]*m[8] - m[2]*m[6])/det;
+  inv[5*s] = (m[2]*m[3] - m[0]*m[5])/det;
+  inv[6*s] = (m[3]*m[7] - m[4]*m[6])/det;
+  inv[7*s] = (m[1]*m[6] - m[0]*m[7])/det;
+  inv[8*s] = (m[0]*m[4] - m[1]*m[3])/det;
+  return;
+}
+
+/* Elimination for the larger sizes */
+# define SMALL_MATRIX_ELIMINATION(N) \
+real small_det_##N(const real * a, long int s) \
+{ \
+  real m[N*N]; \
+  for(int i = 0; i < N*N; ++i) m[i] = a[s*i]; \
+  real det = 1; \
+  for(int c = 0; c < N; ++c) { \
+    int p = c; \
+    for(int r = c + 1; r < N; ++r) \
+      if(fabs(m[N*r + c]) > fabs(m[N*p + c])) p = r; \
+    if(m[N*p + c] == 0) return 0; \
+    if(p != c) { \
+      det = -det; \
+      for(int j = c; j < N; ++j) { \
+        real tmp = m[N*c + j]; m[N*c + j] = m[N*p + j]; m[N*p + j] = tmp; \
+      } \
+    } \
+    det *= m[N*c + c]; \
+    for(int r = c + 1; r < N; ++r) { \
+      const real l = m[N*r + c]/m[N*c + c]; \
+      for(int j = c + 1; j < N; ++j) m[N*r + j] -= l*m[N*c + j]; \
+    } \
+  } \
+  return det; \
+} \
+\
+void small_inverse_##N(const real * a, real * inv, long int s) \
+{ \
+  /* Gauss-Jordan elimination on [m | x], with x starting as the identity */ \
+  real m[N*N], x[N*N]; \
+  for(int i = 0; i < N*N; ++i) {m[i] = a[s*i]; x[i] = 0;} \
+  for(int i = 0; i < N; ++i) x[N*i + i] = 1; \
+  for(int c = 0; c < N; ++c) { \
+    int p = c; \
+    for(int r = c + 1; r < N; ++r) \
+      if(fabs(m[N*r + c]) > fabs(m[N*p + c])) p = r; \
+    if(m[N*p + c] == 0) { \
+      for(int i = 0; i < N*N; ++i) inv[s*i] = NAN; \
+      return; \
+    } \
+    if(p != c) \
+      for(int j = 0; j < N; ++j) { \
+        real tmp = m[N*c + j]; m[N*c + j] = m[N*p + j]; m[N*p + j] = tmp; \
+        tmp = x[N*c + j]; x[N*c + j] = x[N*p + j]; x[N*p + j] = tmp; \
+      } \
+    const real d = m[N*c + c]; \
+    for(int j = 0; j < N; ++j) {m[N*c + j] /= d; x[N*c + j] /= d;} \
+    for(int r = 0; r < N; ++r) \
+      if(r != c) { \
+        const real l = m[N*r + c]; \
+        for(int j = 0; j < N; ++j) { \
+          m[N*r + j] -= l*m[N*c + j]; \
+          x[N*r + j] -= l*x[N*c + j]; \
+        } \
+      } \
+  } \
+  for(int i = 0; i < N*N; ++i) inv[s*i] = x[i]; \
+}
+
+SMALL_MATRIX_KERNELS(2)
+SMALL_MATRIX_KERNELS(3)
+SMALL_MATRIX_KERNELS(4)
+SMALL_MATRIX_KERNELS(6)
+SMALL_MATRIX_ELIMINATION(4)
+SMALL_MATRIX_ELIMINATION(6)
+
+/* Kernel tables, indexed by size */
+typedef void (* small_product_fn)(int count, const real * restrict A,
+                                      const real * restrict B,
+                                      real * restrict C);
+typedef void (* small_matrix_fn)(const real * a, real * t, long int s);
+typedef real (* small_det_fn)(const real * a, long int s);
+
+static const small_product_fn small_dot_kernel[2][7]
+  = {{NULL, NULL, small_dot_2, small_dot_3, small_dot_4, NULL, small_dot_6},
+     {NULL, NULL, small_dot_interleaved_2, small_dot_interleaved_3,
+      small_dot_interleaved_4, NULL, small_dot_interleaved_6}};
+static const small_product_fn small_matvec_kernel[2][7]
+  = {{NULL, NULL, small_matvec_2, small_matvec_3, small_matvec_4, NULL,
+      small_matvec_6},
+     {NULL, NULL, small_matvec_interleaved_2, small_matvec_interleaved_3,
+      small_matvec_interleaved_4, NULL, small_matvec_interleaved_6}};
+static const small_matrix_fn small_transpose_kernel[7]
+  = {NULL, NULL, small_transpose_2, small_transpose_3, small_transpose_4, NULL,
+     small_transpose_6};
+static const small_matrix_fn small_inverse_kernel[7]
+  = {NULL, NULL, small_inverse_2, small_inverse_3, small_inverse_4, NULL,
+     small_inverse_6};
+static const small_det_fn small_det_kernel[7]
+  = {NULL, NULL, small_det_2, small_det_3, small_det_4, NULL, small_det_6};
+
+int batch_match(const struct matrix_batch * A, const struct matrix_batch * B)
+{
+  return inherits_from(A, matrix_batch) && inherits_from(B, matrix_batch)
+         && A->dat && A->n == B->n && A->count == B->count
+         && A->layout == B->layout;
+}
+
+/* Matrix products C[b] = A[b] B[b] */
+void * batch_dot(const void * _A, const void * _B)
+{
+  const struct matrix_batch * A = _A;
+  const struct matrix_batch * B = _B;
+  if(batch_match(A, B)) {
+    new(C, matrix_batch, A->n, A->count, A->layout);
+    small_dot_kernel[A->layout][A->n](A->count, A->dat, B->dat, C->dat);
+    return C;
+  }
+  return NULL;
+}
+
+/* Matrix times vector y[b] = A[b] x[b] */
+void batch_matvec(const void * _A, const real * x, real * y)
+{
+  const struct matrix_batch * A = _A;
+  if(inherits_from(A, matrix_batch) && A->dat)
+    small_matvec_kernel[A->layout][A->n](A->count, A->dat, x, y);
+  return;
+}
+
+/* Apply a per-matrix kernel to every matrix of the batch */
+void * batch_apply(const struct matrix_batch * A,
+                   small_matrix_fn kernel)
+{
+  new(T, matrix_batch, A->n, A->count, A->layout);
+  const int interleaved = A->layout == SMALL_MATRIX_INTERLEAVED;
+  const long int s = interleaved ? A->count : 1;
+  for(long int b = 0; b < A->count; ++b) {
+    const long int first = interleaved ? b : (long int) A->n*A->n*b;
+    kernel(A->dat + first, T->dat + first, s);
+  }
+  return T;
+}
+
+void * batch_transpose(const void * _A)
+{
+  const struct matrix_batch * A = _A;
+  if(inherits_from(A, matrix_batch) && A->dat)
+    return batch_apply(A, small_transpose_kernel[A->n]);
+  return NULL;
+}
+
+void * batch_inverse(const void * _A)
+{
+  const struct matrix_batch * A = _A;
+  if(inherits_from(A, matrix_batch) && A->dat)
+    return batch_apply(A, small_inverse_kernel[A->n]);
+  return NULL;
+}
+
+/* Determinants of all the matrices, written to det[0] ... det[count - 1] */
+void batch_determinant(const void * _A, real * det)
+{
+  const struct matrix_batch * A = _A;
+  if(inherits_from(A, matrix_batch) && A->dat) {
+    const int interleaved = A->layout == SMALL_MATRIX_INTERLEAVED;
+    const long int s = interleaved ? A->count : 1;
+    for(long int b = 0; b < A->count; ++b)
+      det[b] = small_det_kernel[A->n](A->dat + (interleaved ? b
+                                                : (long int) A->n*A->n*b), s);
+  }
+  return;
+}
+# endif
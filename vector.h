@@ -3,8 +3,10 @@
 # include <stdio.h>
 # include <stdlib.h>
 # include <stdarg.h>
+# include <string.h>
 # include <math.h>
 # include "object.h"
+# include "iterator.h"
 
 # ifndef REAL
 # define REAL DOUBLE
@@ -22,6 +24,9 @@ static void * vector_constructor(void * _self, va_list * args);
 static void * vector_destructor(void * _self);
 static void * vector_clone(const void * _self);
 static void * vector_display(const void * _self, FILE * fp);
+int vector_differs(void * _a, void * _b);
+size_t vector_hash(const void * _self);
+size_t real_hash(size_t h, const real * x, int n);
 
 static const Class _vector
   = {sizeof(struct vector), "vector", &_abstract_object,
@@ -42,6 +47,8 @@ real vector_norm(const void * _v);
 static void * vector_constructor(void * _self, va_list * args)
 {
   struct abstract_object * obj =  abstract_object_constructor(_self, args);
+  obj->differs = vector_differs;
+  obj->hash = vector_hash;
   obj->clone = vector_clone;
   obj->display = vector_display;
   struct vector * self = _self;
@@ -82,17 +89,101 @@ static void * vector_display(const void * _self, FILE * fp)
   return NULL;
 }
 
+/* Two vectors are the same if they have the same components */
+int vector_differs(void * _a, void * _b)
+{
+  const struct vector * a = _a;
+  const struct vector * b = _b;
+  if(a == b) return 0;
+  if(!inherits_from(a, vector) || !inherits_from(b, vector)) return 1;
+  if(a->dim != b->dim) return 1;
+  for(int i = 0; i < a->dim; ++i)
+    if(a->dat[i] != b->dat[i]) return 1;
+  return 0;
+}
+
+/* Fold n real numbers into the hash h (adding 0 turns -0 into 0, which
+   compares equal to it) */
+size_t real_hash(size_t h, const real * x, int n)
+{
+  for(int i = 0; i < n; ++i) {
+    real xi = x[i] + real_val(0.0);
+    uint64_t bits = 0;
+    memcpy(&bits, &xi, sizeof(real));
+    h = hash_mix(h ^ bits);
+  }
+  return h;
+}
+
+size_t vector_hash(const void * _self)
+{
+  const struct vector * self = _self;
+  return real_hash(hash_mix(self->dim), self->dat, self->dim);
+}
+
+struct vector_view {
+  const struct vector _; /* This item must come first */
+};
+
+static void * vector_view_constructor(void * _self, va_list * args);
+static void * vector_view_destructor(void * _self);
+
+static const Class _vector_view
+  = {sizeof(struct vector_view), "vector view", &_vector,
+     vector_view_constructor, vector_view_destructor};
+
+const void * vector_view = &_vector_view;
+
+static void * vector_view_constructor(void * _self, va_list * args)
+{
+  vector_constructor(_self, args);
+  struct vector * self = _self;
+  real * dat = va_arg(*args, real *);
+  if(dat) {
+    self->dat = dat;
+    self->dim = va_arg(*args, int);
+  }
+  return _self;
+}
+
+/* The elements belong to someone else */
+static void * vector_view_destructor(void * _self)
+{
+  return NULL;
+}
+
+struct vector_iterator {
+  const struct array_iterator _; /* This item must come first */
+};
+
+static void * vector_iterator_constructor(void * _self, va_list * args);
+
+static const Class _vector_iterator
+  = {sizeof(struct vector_iterator), "vector iterator", &_array_iterator,
+     vector_iterator_constructor, NULL};
+
+const void * vector_iterator = &_vector_iterator;
+
+static void * vector_iterator_constructor(void * _self, va_list * args)
+{
+  array_iterator_constructor(_self, args);
+  const struct vector * v = va_arg(*args, const struct vector *);
+  if(v && inherits_from(v, vector))
+    array_iterator_runs(_self, v->dat, sizeof(real), v->dim, 0, 1, v->dim);
+  return _self;
+}
+
 
 /* Set vector dimensionality */
 void vector_set_dim(void * _self, int dim)
 {
   struct vector * self = _self;
-  if(inherits_from(self, vector)) {
+  if(inherits_from(self, vector) && !inherits_from(self, vector_view)) {
     self->dim = dim;
     if(self->dat == NULL)
       self->dat = (real *) calloc(dim, sizeof(real));
     else
-      self->dat = (real *) realloc(self, dim);
+      self->dat = (real *) realloc(self->dat, dim*sizeof(real));
   }
 
   return;